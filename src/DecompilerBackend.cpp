@@ -0,0 +1,378 @@
+////////////////////////////////////////////////////////////////////////////////
+/// @file DecompilerBackend.cpp
+///     Access to the disassembler and decompiler used for source generation.
+/// @par Purpose:
+///     Implements backends which do not need IDA: a stub, and recording and
+///     replaying of answers given by another backend.
+/// @par  Copying and copyrights:
+///     This program is free software; you can redistribute it and/or modify
+///     it under the terms of the GNU General Public License as published by
+///     the Free Software Foundation; either version 2 of the License, or
+///     (at your option) any later version.
+////////////////////////////////////////////////////////////////////////////////
+
+#include  "DecompilerBackend.h"
+
+#include  <cstdio>
+#include  <cstdlib>
+#include  <fstream>
+#include  <thread>
+
+namespace {
+
+unsigned hardwareThreads()
+{
+    const unsigned numCores = std::thread::hardware_concurrency();
+    return (numCores > 0) ? numCores : 1;
+}
+
+int hexDigitValue(char c)
+{
+    if ((c >= '0') && (c <= '9'))
+        return c - '0';
+    if ((c >= 'A') && (c <= 'F'))
+        return c - 'A' + 10;
+    if ((c >= 'a') && (c <= 'f'))
+        return c - 'a' + 10;
+    return -1;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Reads hexadecimal numbers of a recording line.
+/// @return True if all numbers were read, and nothing follows them
+////////////////////////////////////////////////////////////////////////////////
+bool readRecordNumbers(const char * p, unsigned long long * values, size_t count)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        char * pEnd;
+        values[i] = std::strtoull(p, &pEnd, 16);
+        if (pEnd == p)
+            return false;
+        p = pEnd;
+    }
+    return (*p == '\0');
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Reads bytes of a recording line, given as pairs of hex digits.
+////////////////////////////////////////////////////////////////////////////////
+bool readRecordBytes(const char * p, std::vector<unsigned char> &bytes)
+{
+    bytes.clear();
+    for (; p[0] != '\0'; p += 2)
+    {
+        const int hi = hexDigitValue(p[0]);
+        const int lo = hexDigitValue(p[1]);
+        if ((hi < 0) || (lo < 0))
+            return false;
+        bytes.push_back((unsigned char)((hi << 4) | lo));
+    }
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Writes a recording line with bytes, as pairs of hex digits.
+////////////////////////////////////////////////////////////////////////////////
+void writeRecordBytes(std::ofstream &file, char type, unsigned long long ea, const std::vector<unsigned char> &bytes)
+{
+    static const char HEX_DIGITS[] = "0123456789ABCDEF";
+    char buf[32];
+    snprintf(buf, sizeof(buf), "%c %llX ", type, ea);
+    std::string line = buf;
+    for (unsigned char byte : bytes)
+    {
+        line += HEX_DIGITS[byte >> 4];
+        line += HEX_DIGITS[byte & 0xF];
+    }
+    file << line << "\n";
+}
+
+} // namespace
+
+unsigned SourceGen::StubBackend::getMaxThreads() const
+{
+    return hardwareThreads();
+}
+
+bool SourceGen::StubBackend::getSegmentStart(unsigned long seg, unsigned long long &startEa)
+{
+    startEa = (unsigned long long)seg << 32;
+    return true;
+}
+
+bool SourceGen::StubBackend::findFunction(unsigned long long ea, unsigned long long &startEa, unsigned long long &endEa)
+{
+    startEa = ea;
+    endEa = ea + 1;
+    return true;
+}
+
+bool SourceGen::StubBackend::readBytes(unsigned long long ea, size_t size, std::vector<unsigned char> &bytes)
+{
+    bytes.resize(size);
+    for (size_t i = 0; i < size; i++)
+        bytes[i] = (unsigned char)(ea + i);
+    return true;
+}
+
+std::string SourceGen::StubBackend::getSettings() const
+{
+    return "stub";
+}
+
+bool SourceGen::StubBackend::readNormalizedCode(unsigned long long ea, size_t size, std::vector<unsigned char> &code)
+{
+    readBytes(ea, size, code);
+    for (size_t i = 0; i < sizeof(ea); i++)
+        code.push_back((unsigned char)(ea >> (8 * i)));
+    return true;
+}
+
+void SourceGen::StubBackend::decompileBatch(const SourceGen::FunctionWork * funcs, size_t count, SourceGen::Pseudocode * results)
+{
+    char buf[64];
+    for (size_t i = 0; i < count; i++)
+    {
+        SourceGen::Pseudocode &code = results[i];
+        code.clear();
+        snprintf(buf, sizeof(buf), "void __cdecl sub_%llX()", funcs[i].ea);
+        code.push_back(buf);
+        code.push_back("{");
+        code.push_back("  ;");
+        code.push_back("}");
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Reads a recording saved by RecordingBackend::save().
+/// @param fileName Name of the recording file
+/// @return False if the file could not be read, or is not a recording
+////////////////////////////////////////////////////////////////////////////////
+bool SourceGen::ReplayBackend::load(const char * fileName)
+{
+    segments.clear();
+    functions.clear();
+    pseudocode.clear();
+    code.clear();
+    normalized.clear();
+    settings.clear();
+    std::ifstream file(fileName, std::ios::in | std::ios::binary);
+    if (!file.is_open())
+        return false;
+
+    std::string line;
+    SourceGen::Pseudocode * lines = nullptr;
+    unsigned long long values[3];
+    while (std::getline(file, line))
+    {
+        if (!line.empty() && (line.back() == '\r'))
+            line.pop_back();
+        if (line.empty())
+            continue;
+        if ((line.size() < 2) || (line[1] != ' '))
+            return false;
+        const char * pArgs = line.c_str() + 2;
+        switch (line[0])
+        {
+        case 'S':
+            if (!readRecordNumbers(pArgs, values, 2))
+                return false;
+            segments[(unsigned long)values[0]] = values[1];
+            break;
+        case 'F':
+            if (!readRecordNumbers(pArgs, values, 3))
+                return false;
+            functions[values[0]] = std::make_pair(values[1], values[2]);
+            break;
+        case 'V':
+            settings = pArgs;
+            break;
+        case 'B':
+        case 'N':
+        {
+            char * pHex;
+            const unsigned long long ea = std::strtoull(pArgs, &pHex, 16);
+            std::vector<unsigned char> &bytes = (line[0] == 'B') ? code[ea] : normalized[ea];
+            if ((pHex == pArgs) || (*pHex != ' ') || !readRecordBytes(pHex + 1, bytes))
+                return false;
+            break;
+        }
+        case 'D':
+            if (!readRecordNumbers(pArgs, values, 1))
+                return false;
+            lines = &pseudocode[values[0]];
+            lines->clear();
+            break;
+        case 'L':
+            if (lines == nullptr)
+                return false;
+            lines->emplace_back(pArgs);
+            break;
+        default:
+            return false;
+        }
+    }
+    return true;
+}
+
+unsigned SourceGen::ReplayBackend::getMaxThreads() const
+{
+    return hardwareThreads();
+}
+
+bool SourceGen::ReplayBackend::getSegmentStart(unsigned long seg, unsigned long long &startEa)
+{
+    auto found = segments.find(seg);
+    if (found == segments.end())
+        return false;
+    startEa = found->second;
+    return true;
+}
+
+bool SourceGen::ReplayBackend::findFunction(unsigned long long ea, unsigned long long &startEa, unsigned long long &endEa)
+{
+    auto found = functions.find(ea);
+    if (found == functions.end())
+        return false;
+    startEa = found->second.first;
+    endEa = found->second.second;
+    return true;
+}
+
+bool SourceGen::ReplayBackend::readBytes(unsigned long long ea, size_t size, std::vector<unsigned char> &bytes)
+{
+    auto found = code.find(ea);
+    if ((found == code.end()) || (found->second.size() < size))
+        return false;
+    bytes.assign(found->second.begin(), found->second.begin() + size);
+    return true;
+}
+
+std::string SourceGen::ReplayBackend::getSettings() const
+{
+    return settings;
+}
+
+bool SourceGen::ReplayBackend::readNormalizedCode(unsigned long long ea, size_t, std::vector<unsigned char> &code)
+{
+    auto found = normalized.find(ea);
+    if (found == normalized.end())
+        return false;
+    code = found->second;
+    return true;
+}
+
+void SourceGen::ReplayBackend::decompileBatch(const SourceGen::FunctionWork * funcs, size_t count, SourceGen::Pseudocode * results)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        auto found = pseudocode.find(funcs[i].ea);
+        if (found != pseudocode.end())
+            results[i] = found->second;
+        else
+            results[i].clear();
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Writes answers given so far into a recording file.
+///     Entries are sorted by address, so the same answers always give
+///     the same file.
+/// @param fileName Name of the recording file
+/// @return False if the file could not be written
+////////////////////////////////////////////////////////////////////////////////
+bool SourceGen::RecordingBackend::save(const char * fileName) const
+{
+    std::ofstream file(fileName, std::ios::out | std::ios::binary);
+    if (!file.is_open())
+        return false;
+
+    char buf[80];
+    file << "V " << backend.getSettings() << "\n";
+    for (const auto &segment : segments)
+    {
+        snprintf(buf, sizeof(buf), "S %lX %llX\n", segment.first, segment.second);
+        file << buf;
+    }
+    for (const auto &function : functions)
+    {
+        snprintf(buf, sizeof(buf), "F %llX %llX %llX\n", function.first, function.second.first, function.second.second);
+        file << buf;
+    }
+    for (const auto &bytes : code)
+        writeRecordBytes(file, 'B', bytes.first, bytes.second);
+    std::lock_guard<std::mutex> guard(lock);
+    for (const auto &bytes : normalized)
+        writeRecordBytes(file, 'N', bytes.first, bytes.second);
+    for (const auto &lines : pseudocode)
+    {
+        snprintf(buf, sizeof(buf), "D %llX\n", lines.first);
+        file << buf;
+        for (const std::string &line : lines.second)
+            file << "L " << line << "\n";
+    }
+    file.close();
+    return !file.fail();
+}
+
+unsigned SourceGen::RecordingBackend::getMaxThreads() const
+{
+    return backend.getMaxThreads();
+}
+
+bool SourceGen::RecordingBackend::getSegmentStart(unsigned long seg, unsigned long long &startEa)
+{
+    if (!backend.getSegmentStart(seg, startEa))
+        return false;
+    segments[seg] = startEa;
+    return true;
+}
+
+bool SourceGen::RecordingBackend::findFunction(unsigned long long ea, unsigned long long &startEa, unsigned long long &endEa)
+{
+    if (!backend.findFunction(ea, startEa, endEa))
+        return false;
+    functions[ea] = std::make_pair(startEa, endEa);
+    return true;
+}
+
+bool SourceGen::RecordingBackend::readBytes(unsigned long long ea, size_t size, std::vector<unsigned char> &bytes)
+{
+    if (!backend.readBytes(ea, size, bytes))
+        return false;
+    std::vector<unsigned char> &recorded = code[ea];
+    if (recorded.size() < bytes.size())
+        recorded = bytes;
+    return true;
+}
+
+std::string SourceGen::RecordingBackend::getSettings() const
+{
+    return backend.getSettings();
+}
+
+bool SourceGen::RecordingBackend::readNormalizedCode(unsigned long long ea, size_t size, std::vector<unsigned char> &code)
+{
+    if (!backend.readNormalizedCode(ea, size, code))
+        return false;
+    std::lock_guard<std::mutex> guard(lock);
+    normalized[ea] = code;
+    return true;
+}
+
+void SourceGen::RecordingBackend::decompileBatch(const SourceGen::FunctionWork * funcs, size_t count, SourceGen::Pseudocode * results)
+{
+    backend.decompileBatch(funcs, count, results);
+    // Normalized code is recorded too, so the replay may use a cache
+    std::vector<unsigned char> code;
+    for (size_t i = 0; i < count; i++)
+    {
+        const bool hasCode = backend.readNormalizedCode(funcs[i].ea, (size_t)funcs[i].size, code);
+        std::lock_guard<std::mutex> guard(lock);
+        pseudocode[funcs[i].ea] = results[i];
+        if (hasCode)
+            normalized[funcs[i].ea] = code;
+    }
+}
+////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,169 @@
+////////////////////////////////////////////////////////////////////////////////
+/// @file DecompilerBackend.h
+///     Access to the disassembler and decompiler used for source generation.
+/// @par Purpose:
+///     Declares the interface through which source generation finds segments
+///     and functions, and gets their pseudocode; with implementations which
+///     do not need IDA, for running the generation anywhere.
+/// @par  Copying and copyrights:
+///     This program is free software; you can redistribute it and/or modify
+///     it under the terms of the GNU General Public License as published by
+///     the Free Software Foundation; either version 2 of the License, or
+///     (at your option) any later version.
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef DECOMPILERBACKEND_H_
+#define DECOMPILERBACKEND_H_
+
+#include  <map>
+#include  <mutex>
+#include  <string>
+#include  <unordered_map>
+#include  <vector>
+
+namespace SourceGen {
+
+/// Function to be written into the source tree.
+typedef struct {
+    /// Address of the function entry in the decompiled program
+    unsigned long long ea = 0;
+    /// Output file, as index into file names given to runPipeline()
+    unsigned fileId = 0;
+    /// Comment line written before the function, like "// file.c:12"; may be empty
+    std::string marker;
+    /// Size of the function code, from the entry to function end
+    unsigned long long size = 0;
+    /// Hash of the normalized function code, symbol name and marker
+    unsigned long long hash = 0;
+    /// Whether text from earlier generation is used instead of decompiling
+    bool reused = false;
+    /// Text from earlier generation, as written into the file; empty if it failed
+    std::string text;
+} FunctionWork;
+
+/// Lines of a decompiled function, without tags and EOLs; empty on failure
+typedef std::vector<std::string> Pseudocode;
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Disassembler and decompiler used by source generation.
+///     Segments and functions are looked up only from the thread which runs
+///     the generation; decompileBatch() may be called from as many threads
+///     as getMaxThreads() allows.
+////////////////////////////////////////////////////////////////////////////////
+class DecompilerBackend {
+public:
+    virtual ~DecompilerBackend() {}
+
+    /// Amount of threads which may call decompileBatch() at the same time;
+    /// with 1, it is only called from the thread which runs the pipeline
+    virtual unsigned getMaxThreads() const = 0;
+
+    /// Gets linear address of a segment, numbered like in the MAP file but 0-based
+    virtual bool getSegmentStart(unsigned long seg, unsigned long long &startEa) = 0;
+
+    /// Finds function containing an address, creating it there if there is none;
+    /// endEa is the address after the function
+    virtual bool findFunction(unsigned long long ea, unsigned long long &startEa, unsigned long long &endEa) = 0;
+
+    /// Reads program bytes; false if some of them are not loaded
+    virtual bool readBytes(unsigned long long ea, size_t size, std::vector<unsigned char> &bytes) = 0;
+
+    /// Gets text identifying decompiler version and options, and anything
+    /// else of the database which changes all pseudocode; output made with
+    /// other settings is not reused
+    virtual std::string getSettings() const = 0;
+
+    /// Reads function code in a form which does not depend on where it was
+    /// linked: operands referring to other addresses are replaced by names and
+    /// types of their targets, and the function name and type are included.
+    /// Same result means same pseudocode, in any database. May be called
+    /// from decompiling threads
+    virtual bool readNormalizedCode(unsigned long long ea, size_t size, std::vector<unsigned char> &code) = 0;
+
+    /// Decompiles functions; results has an entry for each of them
+    virtual void decompileBatch(const SourceGen::FunctionWork * funcs, size_t count, SourceGen::Pseudocode * results) = 0;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Stand-in for hosts without a decompiler.
+///     Segment N starts at N<<32, every address is the start of a one byte
+///     function whose code is the low byte of its address, and each function
+///     gets an empty body named after its address; the normalized code is
+///     that byte followed by the address. Good for running and timing the
+///     pipeline anywhere.
+////////////////////////////////////////////////////////////////////////////////
+class StubBackend : public DecompilerBackend {
+public:
+    unsigned getMaxThreads() const override;
+    bool getSegmentStart(unsigned long seg, unsigned long long &startEa) override;
+    bool findFunction(unsigned long long ea, unsigned long long &startEa, unsigned long long &endEa) override;
+    bool readBytes(unsigned long long ea, size_t size, std::vector<unsigned char> &bytes) override;
+    std::string getSettings() const override;
+    bool readNormalizedCode(unsigned long long ea, size_t size, std::vector<unsigned char> &code) override;
+    void decompileBatch(const SourceGen::FunctionWork * funcs, size_t count, SourceGen::Pseudocode * results) override;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Backend which replays answers saved by RecordingBackend.
+///     Gives the same segments, functions and pseudocode as the recorded
+///     run did, so source generation can be repeated without IDA.
+////////////////////////////////////////////////////////////////////////////////
+class ReplayBackend : public DecompilerBackend {
+public:
+    bool load(const char * fileName);
+
+    unsigned getMaxThreads() const override;
+    bool getSegmentStart(unsigned long seg, unsigned long long &startEa) override;
+    bool findFunction(unsigned long long ea, unsigned long long &startEa, unsigned long long &endEa) override;
+    bool readBytes(unsigned long long ea, size_t size, std::vector<unsigned char> &bytes) override;
+    std::string getSettings() const override;
+    bool readNormalizedCode(unsigned long long ea, size_t size, std::vector<unsigned char> &code) override;
+    void decompileBatch(const SourceGen::FunctionWork * funcs, size_t count, SourceGen::Pseudocode * results) override;
+
+private:
+    std::unordered_map<unsigned long, unsigned long long> segments;
+    std::unordered_map<unsigned long long, std::pair<unsigned long long, unsigned long long>> functions;
+    std::unordered_map<unsigned long long, SourceGen::Pseudocode> pseudocode;
+    std::unordered_map<unsigned long long, std::vector<unsigned char>> code;
+    std::unordered_map<unsigned long long, std::vector<unsigned char>> normalized;
+    std::string settings;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Backend which passes calls to another one and remembers answers.
+///     The recording is a text file of lines:
+///     "V settings" for decompiler settings,
+///     "S seg start" for segments, "F ea start end" for functions,
+///     "B ea bytes" for program bytes read, as a string of hex digits,
+///     "N ea bytes" for normalized code, in the same form,
+///     "D ea" for a decompiled function, followed by "L text" for each line
+///     of its pseudocode. Numbers are hexadecimal.
+////////////////////////////////////////////////////////////////////////////////
+class RecordingBackend : public DecompilerBackend {
+public:
+    explicit RecordingBackend(SourceGen::DecompilerBackend &backend) : backend(backend) {}
+
+    bool save(const char * fileName) const;
+
+    unsigned getMaxThreads() const override;
+    bool getSegmentStart(unsigned long seg, unsigned long long &startEa) override;
+    bool findFunction(unsigned long long ea, unsigned long long &startEa, unsigned long long &endEa) override;
+    bool readBytes(unsigned long long ea, size_t size, std::vector<unsigned char> &bytes) override;
+    std::string getSettings() const override;
+    bool readNormalizedCode(unsigned long long ea, size_t size, std::vector<unsigned char> &code) override;
+    void decompileBatch(const SourceGen::FunctionWork * funcs, size_t count, SourceGen::Pseudocode * results) override;
+
+private:
+    SourceGen::DecompilerBackend &backend;
+    std::map<unsigned long, unsigned long long> segments;
+    std::map<unsigned long long, std::pair<unsigned long long, unsigned long long>> functions;
+    std::map<unsigned long long, SourceGen::Pseudocode> pseudocode;
+    std::map<unsigned long long, std::vector<unsigned char>> code;
+    std::map<unsigned long long, std::vector<unsigned char>> normalized;
+    /// Guards pseudocode and normalized, which are filled from decompiling threads
+    mutable std::mutex lock;
+};
+
+};
+
+#endif // DECOMPILERBACKEND_H_
@@ -0,0 +1,187 @@
+////////////////////////////////////////////////////////////////////////////////
+/// @file MAPAddressIndex.cpp
+///     Address to symbol lookups over symbols of a MAP file.
+/// @par Purpose:
+///     Answers "which symbol contains address X" in logarithmic time, for
+///     single addresses and for large batches, like crash dump stacks.
+/// @par  Copying and copyrights:
+///     This program is free software; you can redistribute it and/or modify
+///     it under the terms of the GNU General Public License as published by
+///     the Free Software Foundation; either version 2 of the License, or
+///     (at your option) any later version.
+////////////////////////////////////////////////////////////////////////////////
+
+#include  "MAPReader.h"
+
+#include  <algorithm>
+#include  <numeric>
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Fills Eytzinger layout of a sorted array by in-order walk.
+/// @return Next position in the sorted array
+////////////////////////////////////////////////////////////////////////////////
+static size_t fillEytzinger(const std::vector<unsigned long> &sorted, std::vector<unsigned long> &eytzAddrs,
+    std::vector<size_t> &eytzRanks, size_t node, size_t rank)
+{
+    if (node >= eytzAddrs.size())
+        return rank;
+    rank = fillEytzinger(sorted, eytzAddrs, eytzRanks, 2 * node, rank);
+    eytzAddrs[node] = sorted[rank];
+    eytzRanks[node] = rank;
+    rank++;
+    return fillEytzinger(sorted, eytzAddrs, eytzRanks, 2 * node + 1, rank);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Builds the index of all symbols in a table.
+///     Symbols sharing an address are represented by the first of them.
+/// @param symbols The symbol table; indexes returned by lookups refer to it
+////////////////////////////////////////////////////////////////////////////////
+void MapFile::AddressIndex::build(const MapFile::SymbolTable &symbols)
+{
+    clear();
+    const std::vector<unsigned long> &symSegs = symbols.getSegs();
+    const std::vector<unsigned long> &symAddrs = symbols.getAddrs();
+
+    // Sort by segment, then address; stable so aliases keep file order
+    std::vector<size_t> order(symbols.size());
+    std::iota(order.begin(), order.end(), (size_t)0);
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b)
+    {
+        if (symSegs[a] != symSegs[b])
+            return symSegs[a] < symSegs[b];
+        return symAddrs[a] < symAddrs[b];
+    });
+
+    symbolSizes.assign(symbols.size(), 0);
+    for (size_t pos = 0; pos < order.size(); )
+    {
+        const unsigned long seg = symSegs[order[pos]];
+        if (seg >= segments.size())
+            segments.resize(seg + 1);
+        SegmentIndex &segIndex = segments[seg];
+
+        // Group of symbols sharing segment and address
+        size_t groupEnd = pos + 1;
+        while ((groupEnd < order.size()) && (symSegs[order[groupEnd]] == seg) &&
+            (symAddrs[order[groupEnd]] == symAddrs[order[pos]]))
+        {
+            groupEnd++;
+        }
+        const bool isLast = (groupEnd >= order.size()) || (symSegs[order[groupEnd]] != seg);
+        const unsigned long size = isLast ? 0 : symAddrs[order[groupEnd]] - symAddrs[order[pos]];
+        for (size_t i = pos; i < groupEnd; i++)
+            symbolSizes[order[i]] = size;
+
+        segIndex.addrs.push_back(symAddrs[order[pos]]);
+        segIndex.symbols.push_back(order[pos]);
+        pos = groupEnd;
+    }
+
+    for (SegmentIndex &segIndex : segments)
+    {
+        // Node 0 is unused, children of node k are 2k and 2k+1
+        segIndex.eytzAddrs.resize(segIndex.addrs.size() + 1);
+        segIndex.eytzRanks.resize(segIndex.addrs.size() + 1);
+        fillEytzinger(segIndex.addrs, segIndex.eytzAddrs, segIndex.eytzRanks, 1, 0);
+    }
+}
+
+void MapFile::AddressIndex::clear()
+{
+    segments.clear();
+    symbolSizes.clear();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Finds position of the last address not above given one.
+/// @return Position in the sorted addresses, or NO_SYMBOL if all are above
+////////////////////////////////////////////////////////////////////////////////
+size_t MapFile::AddressIndex::findRank(const SegmentIndex &segIndex, unsigned long addr) const
+{
+    const size_t numNodes = segIndex.eytzAddrs.size();
+    // Descend to a leaf, going right while the node is not above addr
+    size_t node = 1;
+    while (node < numNodes)
+        node = 2 * node + (segIndex.eytzAddrs[node] <= addr ? 1 : 0);
+    // Drop the right turns made after the last left turn; that
+    // left turn was made at the first address above addr
+    while (node & 1)
+        node >>= 1;
+    node >>= 1;
+
+    const size_t firstAbove = (node == 0) ? segIndex.addrs.size() : segIndex.eytzRanks[node];
+    return (firstAbove == 0) ? NO_SYMBOL : firstAbove - 1;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Finds the symbol which contains given address.
+///     The last symbol of a segment is assumed to contain everything after it.
+/// @param seg Segment number, as in the SymbolTable
+/// @param addr Offset within the segment
+/// @return Index of the symbol in the SymbolTable, or NO_SYMBOL
+////////////////////////////////////////////////////////////////////////////////
+size_t MapFile::AddressIndex::find(unsigned long seg, unsigned long addr) const
+{
+    if (seg >= segments.size())
+        return NO_SYMBOL;
+    const SegmentIndex &segIndex = segments[seg];
+    const size_t rank = findRank(segIndex, addr);
+    return (rank == NO_SYMBOL) ? NO_SYMBOL : segIndex.symbols[rank];
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Finds symbols containing many addresses at once.
+///     Queries are sorted and each segment is walked forward once, galloping
+///     from the previous match, so large batches cost less than separate finds.
+/// @param segs Segment numbers of the addresses
+/// @param addrs Offsets within the segments
+/// @param count Amount of addresses
+/// @param found Receives symbol index for each address, or NO_SYMBOL
+////////////////////////////////////////////////////////////////////////////////
+void MapFile::AddressIndex::findBatch(const unsigned long * segs, const unsigned long * addrs, size_t count, size_t * found) const
+{
+    std::vector<size_t> order(count);
+    std::iota(order.begin(), order.end(), (size_t)0);
+    std::sort(order.begin(), order.end(), [&](size_t a, size_t b)
+    {
+        if (segs[a] != segs[b])
+            return segs[a] < segs[b];
+        return addrs[a] < addrs[b];
+    });
+
+    size_t curSeg = (size_t)-1;
+    size_t rankEnd = 0; // first position known to be above the previous query
+    for (size_t i = 0; i < count; i++)
+    {
+        const size_t query = order[i];
+        if (segs[query] >= segments.size())
+        {
+            found[query] = NO_SYMBOL;
+            continue;
+        }
+        const SegmentIndex &segIndex = segments[segs[query]];
+        const std::vector<unsigned long> &sorted = segIndex.addrs;
+        if (segs[query] != curSeg)
+        {
+            curSeg = segs[query];
+            rankEnd = 0;
+        }
+
+        // Gallop to a range which holds the first address above the query
+        const unsigned long addr = addrs[query];
+        size_t lo = rankEnd;
+        size_t step = 1;
+        size_t hi = lo;
+        while ((hi < sorted.size()) && (sorted[hi] <= addr))
+        {
+            lo = hi + 1;
+            hi += step;
+            step *= 2;
+        }
+        if (hi > sorted.size())
+            hi = sorted.size();
+        rankEnd = (size_t)(std::upper_bound(sorted.begin() + lo, sorted.begin() + hi, addr) - sorted.begin());
+        found[query] = (rankEnd == 0) ? NO_SYMBOL : segIndex.symbols[rankEnd - 1];
+    }
+}
@@ -0,0 +1,110 @@
+////////////////////////////////////////////////////////////////////////////////
+/// @file MAPExportTable.cpp
+///     Exported symbols from "Exports" section of MSVC MAP files.
+/// @par Purpose:
+///     Parses the exports list into a table searchable by name.
+/// @par  Copying and copyrights:
+///     This program is free software; you can redistribute it and/or modify
+///     it under the terms of the GNU General Public License as published by
+///     the Free Software Foundation; either version 2 of the License, or
+///     (at your option) any later version.
+////////////////////////////////////////////////////////////////////////////////
+
+#include  "MAPReader.h"
+
+#include  <cstring>
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Adds an export; later export of the same name replaces it in lookups.
+/// @param ordinal Export ordinal number
+/// @param name Exported name, does not need to be NUL-terminated
+/// @param nameLen Length of the name
+/// @param internalName Name within the module, or NULL if same as exported one
+/// @param internalLen Length of the internal name
+////////////////////////////////////////////////////////////////////////////////
+void MapFile::ExportTable::add(unsigned long ordinal, const char * name, size_t nameLen, const char * internalName, size_t internalLen)
+{
+    const unsigned nameId = names.intern(name, nameLen);
+    const unsigned internalId = (internalName != NULL) ? names.intern(internalName, internalLen) : nameId;
+    if (exportOfName.size() < names.size())
+        exportOfName.resize(names.size(), NO_EXPORT);
+    exportOfName[nameId] = ordinals.size();
+    ordinals.push_back(ordinal);
+    nameIds.push_back(nameId);
+    internalIds.push_back(internalId);
+}
+
+void MapFile::ExportTable::clear()
+{
+    ordinals.clear();
+    nameIds.clear();
+    internalIds.clear();
+    exportOfName.clear();
+    names.clear();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Finds an export by its exported name.
+/// @return Index of the export, or NO_EXPORT
+////////////////////////////////////////////////////////////////////////////////
+size_t MapFile::ExportTable::findByName(const char * name) const
+{
+    const unsigned nameId = names.find(name, strlen(name));
+    if (nameId == MapFile::NamePool::NO_NAME)
+        return NO_EXPORT;
+    return exportOfName[nameId];
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Reads the "Exports" sections found by scanSections().
+///     Entries are lines "ordinal name", optionally followed by internal name
+///     in parentheses; other lines, like the column header, are skipped.
+/// @param  pStart Pointer to start of buffer given to scanSections()
+/// @param  pEnd Pointer to end of buffer
+/// @param sections The section directory
+/// @param table Receives the exports, replacing previous contents
+/// @return Number of exports read
+////////////////////////////////////////////////////////////////////////////////
+size_t MapFile::parseExports(const char * pStart, const char * pEnd, const std::vector<MapFile::MAPSection> &sections, MapFile::ExportTable &table)
+{
+    table.clear();
+    for (const MapFile::MAPSection &section : sections)
+    {
+        if ((section.kind != MapFile::EXPORTS_SECTION) || (section.endOffset > (size_t)(pEnd - pStart)))
+            continue;
+
+        const char * pSectionEnd = pStart + section.endOffset;
+        for (const char * pLine = pStart + section.bodyOffset; pLine < pSectionEnd; )
+        {
+            const char * pEOL = MapFile::findEOL(pLine, pSectionEnd);
+            const char * pNext = (pEOL < pSectionEnd) ? pEOL + 1 : pEOL;
+
+            const char * pFieldEnd;
+            const char * pOrdinal = MapFile::nextField(pLine, pEOL, pFieldEnd);
+            unsigned long ordinal;
+            if ((pOrdinal == NULL) || (MapFile::parseNumber(pOrdinal, pFieldEnd, 10, ordinal) != pFieldEnd))
+            {
+                pLine = pNext;
+                continue;
+            }
+            const char * pNameEnd;
+            const char * pName = MapFile::nextField(pFieldEnd, pEOL, pNameEnd);
+            if (pName == NULL)
+            {
+                pLine = pNext;
+                continue;
+            }
+            const char * pInternalEnd;
+            const char * pInternal = MapFile::nextField(pNameEnd, pEOL, pInternalEnd);
+            if ((pInternal != NULL) && (*pInternal == '(') && (pInternalEnd[-1] == ')') && (pInternalEnd - pInternal > 2))
+            {
+                table.add(ordinal, pName, (size_t)(pNameEnd - pName), pInternal + 1, (size_t)(pInternalEnd - pInternal - 2));
+            } else
+            {
+                table.add(ordinal, pName, (size_t)(pNameEnd - pName), NULL, 0);
+            }
+            pLine = pNext;
+        }
+    }
+    return table.size();
+}
@@ -0,0 +1,143 @@
+////////////////////////////////////////////////////////////////////////////////
+/// @file MAPFixupTable.cpp
+///     Relocations from "FIXUPS:" sections of MSVC MAP files.
+/// @par Purpose:
+///     Parses fixup lists into a sorted table, so locations which hold
+///     addresses can be found without scanning the MAP text again.
+/// @par  Copying and copyrights:
+///     This program is free software; you can redistribute it and/or modify
+///     it under the terms of the GNU General Public License as published by
+///     the Free Software Foundation; either version 2 of the License, or
+///     (at your option) any later version.
+////////////////////////////////////////////////////////////////////////////////
+
+#include  "MAPReader.h"
+
+#include  <algorithm>
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Sorts fixup addresses and stores them, replacing previous contents.
+///     Duplicates and addresses which do not fit in 32 bits are dropped.
+/// @param fixupRvas Relative virtual addresses; they are sorted in place
+////////////////////////////////////////////////////////////////////////////////
+void MapFile::FixupTable::build(std::vector<unsigned long> &fixupRvas)
+{
+    clear();
+    std::sort(fixupRvas.begin(), fixupRvas.end());
+    rvas.reserve(fixupRvas.size());
+    for (unsigned long rva : fixupRvas)
+    {
+        if (rva > UINT32_MAX)
+            break;
+        if (rvas.empty() || (rvas.back() != rva))
+            rvas.push_back((uint32_t)rva);
+    }
+    rvas.shrink_to_fit();
+}
+
+void MapFile::FixupTable::clear()
+{
+    rvas.clear();
+    segmentFirst.clear();
+    segmentLast.clear();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Finds fixups within a range of addresses.
+/// @param rvaBegin First address of the range
+/// @param rvaEnd Address after the range
+/// @param first Receives index of the first fixup in range
+/// @return Amount of fixups in range
+////////////////////////////////////////////////////////////////////////////////
+size_t MapFile::FixupTable::findRange(unsigned long rvaBegin, unsigned long rvaEnd, size_t &first) const
+{
+    auto pBegin = std::lower_bound(rvas.begin(), rvas.end(), rvaBegin,
+        [](uint32_t rva, unsigned long key) { return rva < key; });
+    auto pEnd = std::lower_bound(pBegin, rvas.end(), rvaEnd,
+        [](uint32_t rva, unsigned long key) { return rva < key; });
+    first = (size_t)(pBegin - rvas.begin());
+    return (rvaBegin < rvaEnd) ? (size_t)(pEnd - pBegin) : 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Splits the fixups between segments.
+///     The MAP file gives segments as seg:offset only, so their RVAs have to
+///     come from the caller, ie. from the loaded image.
+/// @param segStarts RVA of start of each segment, by 0-based segment number
+/// @param segSizes Size of each segment
+////////////////////////////////////////////////////////////////////////////////
+void MapFile::FixupTable::setSegments(const std::vector<unsigned long> &segStarts, const std::vector<unsigned long> &segSizes)
+{
+    segmentFirst.resize(segStarts.size());
+    segmentLast.resize(segStarts.size());
+    for (size_t seg = 0; seg < segStarts.size(); seg++)
+    {
+        const unsigned long size = (seg < segSizes.size()) ? segSizes[seg] : 0;
+        const size_t count = findRange(segStarts[seg], segStarts[seg] + size, segmentFirst[seg]);
+        segmentLast[seg] = segmentFirst[seg] + count;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Gets fixups of one segment.
+/// @param seg Segment number, 0-based
+/// @param first Receives index of the first fixup in segment
+/// @param last Receives index after the last fixup in segment
+/// @return False if segment ranges are not known
+////////////////////////////////////////////////////////////////////////////////
+bool MapFile::FixupTable::getSegmentRange(unsigned long seg, size_t &first, size_t &last) const
+{
+    if (seg >= segmentFirst.size())
+        return false;
+    first = segmentFirst[seg];
+    last = segmentLast[seg];
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Reads all "FIXUPS:" sections found by scanSections().
+///     Each section is "FIXUPS: rva delta delta ...", all in hexadecimal;
+///     every delta is added to the previous address, and may be negative.
+/// @param  pStart Pointer to start of buffer given to scanSections()
+/// @param  pEnd Pointer to end of buffer
+/// @param sections The section directory
+/// @param table Receives the fixups, replacing previous contents
+/// @return Number of fixups read, including duplicates
+////////////////////////////////////////////////////////////////////////////////
+size_t MapFile::parseFixups(const char * pStart, const char * pEnd, const std::vector<MapFile::MAPSection> &sections, MapFile::FixupTable &table)
+{
+    std::vector<unsigned long> fixupRvas;
+    for (const MapFile::MAPSection &section : sections)
+    {
+        if ((section.kind != MapFile::FIXUPS_SECTION) || (section.endOffset > (size_t)(pEnd - pStart)))
+            continue;
+
+        const char * pSectionEnd = pStart + section.endOffset;
+        const char * pFieldEnd;
+        // First field is the "FIXUPS:" header itself
+        if (MapFile::nextField(pStart + section.headerOffset, pSectionEnd, pFieldEnd) == NULL)
+            continue;
+        const char * pField;
+        bool hasBase = false;
+        unsigned long rva = 0;
+        while ((pField = MapFile::nextField(pFieldEnd, pSectionEnd, pFieldEnd)) != NULL)
+        {
+            const bool isNegative = (*pField == '-');
+            unsigned long value;
+            if (MapFile::parseNumber(isNegative ? pField + 1 : pField, pFieldEnd, 16, value) != pFieldEnd)
+                break;
+            if (!hasBase)
+                rva = value;
+            else
+            if (isNegative)
+                rva -= value;
+            else
+                rva += value;
+            hasBase = true;
+            fixupRvas.push_back(rva);
+        }
+    }
+    const size_t numFixups = fixupRvas.size();
+    table.build(fixupRvas);
+    return numFixups;
+}
@@ -0,0 +1,316 @@
+////////////////////////////////////////////////////////////////////////////////
+/// @file MAPLineTable.cpp
+///     Source line numbers from "Line numbers for" sections of MSVC MAP files.
+/// @par Purpose:
+///     Parses line number sections into a compact table, which maps code
+///     addresses back to source file and line.
+/// @par  Copying and copyrights:
+///     This program is free software; you can redistribute it and/or modify
+///     it under the terms of the GNU General Public License as published by
+///     the Free Software Foundation; either version 2 of the License, or
+///     (at your option) any later version.
+////////////////////////////////////////////////////////////////////////////////
+
+#include  "MAPReader.h"
+
+#include  <algorithm>
+#include  <cstring>
+
+namespace {
+
+const char LINE_NUMBERS_HDR[]    = "Line numbers for ";
+const char LINE_NUMBERS_SEGMENT[] = " segment ";
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Appends a number in LEB128 form, 7 bits per byte.
+////////////////////////////////////////////////////////////////////////////////
+void writeVarint(std::vector<unsigned char> &data, unsigned long long value)
+{
+    while (value >= 0x80)
+    {
+        data.push_back((unsigned char)(value | 0x80));
+        value >>= 7;
+    }
+    data.push_back((unsigned char)value);
+}
+
+unsigned long long readVarint(const unsigned char * &p)
+{
+    unsigned long long value = 0;
+    unsigned shift = 0;
+    while (*p & 0x80)
+    {
+        value |= (unsigned long long)(*p++ & 0x7F) << shift;
+        shift += 7;
+    }
+    value |= (unsigned long long)(*p++) << shift;
+    return value;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Decodes entries of one LineTable block, in address order.
+///     Each entry is: address increment shifted left by one, with the low bit
+///     set if file ID follows; then file ID if present; then line increment
+///     with sign in the lowest bit.
+////////////////////////////////////////////////////////////////////////////////
+class LineDecoder {
+public:
+    LineDecoder(const unsigned char * p, unsigned long seg, unsigned long firstAddr, size_t count)
+        : p(p), remaining(count)
+    {
+        line.seg = seg;
+        line.addr = firstAddr;
+    }
+
+    bool next()
+    {
+        if (remaining == 0)
+            return false;
+        remaining--;
+        const unsigned long long addrStep = readVarint(p);
+        line.addr += (unsigned long)(addrStep >> 1);
+        if (addrStep & 1)
+            line.fileId = (unsigned)readVarint(p);
+        const unsigned long long lineStep = readVarint(p);
+        if (lineStep & 1)
+            line.line -= (unsigned long)(lineStep >> 1);
+        else
+            line.line += (unsigned long)(lineStep >> 1);
+        return true;
+    }
+
+    MapFile::MAPLine line;
+
+private:
+    const unsigned char * p;
+    size_t remaining;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Gets name of the source file from a "Line numbers for" header.
+///     The header is "Line numbers for obj(source) segment name"; without
+///     the parentheses, the object name is used.
+////////////////////////////////////////////////////////////////////////////////
+void getSourceName(const char * pLine, const char * pEOL, const char * &pName, size_t &nameLen)
+{
+    pName = pLine + strlen(LINE_NUMBERS_HDR);
+    const char * pNameEnd = pEOL;
+    // Segment name is at the end, after the last " segment "
+    for (const char * p = pEOL - strlen(LINE_NUMBERS_SEGMENT); p >= pName; p--)
+    {
+        if (strncmp(p, LINE_NUMBERS_SEGMENT, strlen(LINE_NUMBERS_SEGMENT)) == 0)
+        {
+            pNameEnd = p;
+            break;
+        }
+    }
+    if ((pNameEnd > pName) && (pNameEnd[-1] == ')'))
+    {
+        for (const char * p = pNameEnd - 1; p > pName; p--)
+        {
+            if (*(p - 1) == '(')
+            {
+                pName = p;
+                pNameEnd--;
+                break;
+            }
+        }
+    }
+    nameLen = (size_t)(pNameEnd - pName);
+}
+
+} // namespace
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Sorts and encodes line entries, replacing previous contents.
+///     Files referenced by the entries must be already added.
+/// @param lines Entries to store; they are sorted in place
+////////////////////////////////////////////////////////////////////////////////
+void MapFile::LineTable::build(std::vector<MapFile::MAPLine> &lines)
+{
+    blocks.clear();
+    data.clear();
+    std::stable_sort(lines.begin(), lines.end(), [](const MapFile::MAPLine &a, const MapFile::MAPLine &b)
+    {
+        if (a.seg != b.seg)
+            return a.seg < b.seg;
+        return a.addr < b.addr;
+    });
+    numLines = lines.size();
+    // Typical entry takes a byte for address and line each
+    data.reserve(numLines * 2 + numLines / 8);
+
+    MapFile::MAPLine prev;
+    for (const MapFile::MAPLine &line : lines)
+    {
+        bool fileChanged = (line.fileId != prev.fileId);
+        // Entries sharing an address are kept in one block
+        if (blocks.empty() || (line.seg != prev.seg) ||
+            ((blocks.back().count >= LINE_BLOCK_ENTRIES) && (line.addr != prev.addr)))
+        {
+            Block block;
+            block.seg = line.seg;
+            block.firstAddr = line.addr;
+            block.dataOffset = data.size();
+            block.count = 0;
+            blocks.push_back(block);
+            prev = MapFile::MAPLine();
+            prev.seg = line.seg;
+            prev.addr = line.addr;
+            fileChanged = true;
+        }
+        writeVarint(data, ((unsigned long long)(line.addr - prev.addr) << 1) | (fileChanged ? 1 : 0));
+        if (fileChanged)
+            writeVarint(data, line.fileId);
+        if (line.line >= prev.line)
+            writeVarint(data, (unsigned long long)(line.line - prev.line) << 1);
+        else
+            writeVarint(data, ((unsigned long long)(prev.line - line.line) << 1) | 1);
+        blocks.back().count++;
+        prev = line;
+    }
+    data.shrink_to_fit();
+    blocks.shrink_to_fit();
+}
+
+void MapFile::LineTable::clear()
+{
+    blocks.clear();
+    data.clear();
+    files.clear();
+    numLines = 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Finds the block which would hold given address.
+/// @return Index of the last block starting at or before the address,
+///     or blocks.size() if there is none in the segment
+////////////////////////////////////////////////////////////////////////////////
+size_t MapFile::LineTable::findBlock(unsigned long seg, unsigned long addr) const
+{
+    auto found = std::upper_bound(blocks.begin(), blocks.end(), std::make_pair(seg, addr),
+        [](const std::pair<unsigned long, unsigned long> &key, const Block &block)
+    {
+        if (key.first != block.seg)
+            return key.first < block.seg;
+        return key.second < block.firstAddr;
+    });
+    if ((found == blocks.begin()) || ((found - 1)->seg != seg))
+        return blocks.size();
+    return (size_t)(found - blocks.begin()) - 1;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Finds the source line of an address.
+/// @param seg Segment number, 0-based
+/// @param addr Offset within the segment
+/// @param line Receives the last entry at or before the address
+/// @return False if there is no entry at or before the address in the segment
+////////////////////////////////////////////////////////////////////////////////
+bool MapFile::LineTable::find(unsigned long seg, unsigned long addr, MapFile::MAPLine &line) const
+{
+    const size_t blockIdx = findBlock(seg, addr);
+    if (blockIdx >= blocks.size())
+        return false;
+    const Block &block = blocks[blockIdx];
+    LineDecoder decoder(data.data() + block.dataOffset, block.seg, block.firstAddr, block.count);
+    bool found = false;
+    while (decoder.next() && (decoder.line.addr <= addr))
+    {
+        // Of entries sharing an address, the first one is kept
+        if (!found || (decoder.line.addr != line.addr))
+            line = decoder.line;
+        found = true;
+    }
+    return found;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Gets all entries within a range of addresses.
+/// @param seg Segment number, 0-based
+/// @param addrBegin First address of the range
+/// @param addrEnd Address after the range
+/// @param lines Receives the entries, sorted by address
+////////////////////////////////////////////////////////////////////////////////
+void MapFile::LineTable::findRange(unsigned long seg, unsigned long addrBegin, unsigned long addrEnd, std::vector<MapFile::MAPLine> &lines) const
+{
+    lines.clear();
+    if (addrBegin >= addrEnd)
+        return;
+    size_t blockIdx = findBlock(seg, addrBegin);
+    if (blockIdx >= blocks.size())
+    {
+        // Range may still start before the first block of the segment
+        blockIdx = findBlock(seg, addrEnd - 1);
+        if (blockIdx >= blocks.size())
+            return;
+        while ((blockIdx > 0) && (blocks[blockIdx - 1].seg == seg))
+            blockIdx--;
+    }
+    for (; (blockIdx < blocks.size()) && (blocks[blockIdx].seg == seg); blockIdx++)
+    {
+        const Block &block = blocks[blockIdx];
+        if (block.firstAddr >= addrEnd)
+            return;
+        LineDecoder decoder(data.data() + block.dataOffset, block.seg, block.firstAddr, block.count);
+        while (decoder.next())
+        {
+            if (decoder.line.addr >= addrEnd)
+                return;
+            if (decoder.line.addr >= addrBegin)
+                lines.push_back(decoder.line);
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Reads all "Line numbers for" sections found by scanSections().
+///     Section body is a list of "line seg:offset" pairs, several per text line.
+/// @param  pStart Pointer to start of buffer given to scanSections()
+/// @param  pEnd Pointer to end of buffer
+/// @param sections The section directory
+/// @param table Receives the line table, replacing previous contents
+/// @return Number of line entries read
+////////////////////////////////////////////////////////////////////////////////
+size_t MapFile::parseLineNumbers(const char * pStart, const char * pEnd, const std::vector<MapFile::MAPSection> &sections, MapFile::LineTable &table)
+{
+    table.clear();
+    std::vector<MapFile::MAPLine> lines;
+    for (const MapFile::MAPSection &section : sections)
+    {
+        if ((section.kind != MapFile::LINE_NUMBERS_SECTION) || (section.endOffset > (size_t)(pEnd - pStart)))
+            continue;
+
+        const char * pHeader = pStart + section.headerOffset;
+        const char * pName;
+        size_t nameLen;
+        getSourceName(pHeader, MapFile::findEOL(pHeader, pStart + section.bodyOffset), pName, nameLen);
+        MapFile::MAPLine entry;
+        entry.fileId = table.addFile(pName, nameLen);
+
+        const char * pBodyEnd = pStart + section.endOffset;
+        const char * pFieldEnd = pStart + section.bodyOffset;
+        const char * pField;
+        // Pairs are "line seg:offset"; anything else is skipped a field at a time
+        while ((pField = MapFile::nextField(pFieldEnd, pBodyEnd, pFieldEnd)) != NULL)
+        {
+            if (MapFile::parseNumber(pField, pFieldEnd, 10, entry.line) != pFieldEnd)
+                continue;
+            const char * pAddrEnd;
+            const char * pAddr = MapFile::nextField(pFieldEnd, pBodyEnd, pAddrEnd);
+            if (pAddr == NULL)
+                break;
+            const char * pSep = MapFile::parseNumber(pAddr, pAddrEnd, 16, entry.seg);
+            if ((pSep == NULL) || (pSep >= pAddrEnd) || (*pSep != ':') ||
+                (MapFile::parseNumber(pSep + 1, pAddrEnd, 16, entry.addr) != pAddrEnd) || (entry.seg == 0))
+            {
+                continue;
+            }
+            entry.seg--;
+            lines.push_back(entry);
+            pFieldEnd = pAddrEnd;
+        }
+    }
+    table.build(lines);
+    return lines.size();
+}
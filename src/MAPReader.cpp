@@ -1,860 +1,2160 @@
-////////////////////////////////////////////////////////////////////////////////
-/// @file MAPReader.h
-///     MAP file analysis and loading routines.
-/// @par Purpose:
-///     Library for loading MAP file entries.
-/// @author TQN <truong_quoc_ngan@yahoo.com>
-/// @author TL <mefistotelis@gmail.com>
-/// @date 2004.09.11 - 2018.11.08
-/// @par  Copying and copyrights:
-///     This program is free software; you can redistribute it and/or modify
-///     it under the terms of the GNU General Public License as published by
-///     the Free Software Foundation; either version 2 of the License, or
-///     (at your option) any later version.
-////////////////////////////////////////////////////////////////////////////////
-
-#include  "MAPReader.h"
-
-#include  <cstring>
-#include  <cctype>
-#include  <cassert>
-#include  <cstdlib>
-#include <string>
-#include <vector>
-#include <iterator>
-#include <sstream>
-#include "stdafx.h"
-
-using namespace std;
-
-namespace MapFile {
-
-/// @name Strings used to identify start of symbol table in various MAP files.
-/// @{
-const char MSVC_HDR_START[]        = "Address         Publics by Value              Rva+Base     Lib:Object";
-const char MSVC_HDR_START2[]       = "Address         Publics by Value              Rva+Base       Lib:Object";
-const char BCCL_HDR_NAME_START[]   = "Address         Publics by Name";
-const char BCCL_HDR_VALUE_START[]  = "Address         Publics by Value";
-const char WATCOM_MEMMAP_START[]   = "Address        Symbol";
-const char WATCOM_MEMMAP_SKIP[]   = "=======        ======";
-const char WATCOM_MEMMAP_COMMENT[] = "Module: ";
-const char WATCOM_END_TABLE_HDR[]  = "+----------------------+";
-const char MSVC_LINE_NUMBER[]      = "Line numbers for ";
-const char MSVC_FIXUP[]            = "FIXUPS: ";
-const char MSVC_EXPORTS[]          = " Exports";
-const char GCC_MEMMAP_START[]      = "Linker script and memory map";
-const char GCC_MEMMAP_SKIP1[]       = ".";
-const char GCC_MEMMAP_SKIP2[]       = " .";
-const char GCC_MEMMAP_SKIP3[]       = "*";
-const char GCC_MEMMAP_SKIP4[]       = " *";
-const char GCC_MEMMAP_END[]        = "OUTPUT(";
-const char GCC_MEMMAP_LOAD[]       = "LOAD ";
-
-/// @}
-
-};
-
-bool MapFile::isXboxLibraryFile(const char* filename)
-{
-  // eww.. for some reason this is the fastest method to check all these..
-    
-  /* Xbox OG libraries */
-  const char* lib_d3d8_xbox = "d3d8-xbox:";
-  const char* lib_D3D8 = "D3D8:";
-  const char* lib_D3DX8 = "D3DX8:";
-  const char* lib_D3DX8d = "D3DX8d:";
-  const char* lib_d3dx8dt = "d3dx8dt:";
-  const char* lib_d3dxof = "d3dxof:";
-  const char* lib_dxguid = "dxguid:";
-  const char* lib_winhttp5 = "winhttp5:";
-  const char* lib_xboxdbg = "xboxdbg:";
-  const char* lib_xcontent = "xcontent:";
-  const char* lib_xgraphics = "xgraphics:";
-  const char* lib_xonservr = "xonservr:";
-  const char* lib_d3d8d = "d3d8d:";
-  const char* lib_d3d8i = "d3d8i:";
-  const char* lib_d3d8ltcg = "d3d8ltcg:";
-  const char* lib_dmusic = "dmusic:";
-  const char* lib_dmusicd = "dmusicd:";
-  const char* lib_dmusici = "dmusici:";
-  const char* lib_dmusicltcg = "dmusicltcg:";
-  const char* lib_dsound = "dsound:";
-  const char* lib_dsoundd = "dsoundd:";
-  const char* lib_libc = "libc:";
-  const char* lib_libcd = "libcd:";
-  const char* lib_libcmt = "libcmt:";
-  const char* lib_libcmtd = "libcmtd:";
-  const char* lib_libcp = "libcp:";
-  const char* lib_libcpd = "libcpd:";
-  const char* lib_libcpmt = "libcpmt:";
-  const char* lib_libcpmtd = "libcpmtd:";
-  const char* lib_oldnames = "oldnames:";
-  const char* lib_uix = "uix:";
-  const char* lib_uixd = "uixd:";
-  const char* lib_uuid = "uuid:";
-  const char* lib_xacteng = "xacteng:";
-  const char* lib_xactengd = "xactengd:";
-  const char* lib_xactengi = "xactengi:";
-  const char* lib_xactengltcg = "xactengltcg:";
-  const char* lib_xapilib = "xapilib:";
-  const char* lib_xapilibd = "xapilibd:";
-  const char* lib_xbdm = "xbdm:";
-  const char* lib_xboxkrnl = "xboxkrnl:";
-  const char* lib_xgraphicsd = "xgraphicsd:";
-  const char* lib_xgraphicsltcg = "xgraphicsltcg:";
-  const char* lib_xkbd = "xkbd:";
-  const char* lib_xkbdd = "xkbdd:";
-  const char* lib_xmv = "xmv:";
-  const char* lib_xmvd = "xmvd:";
-  const char* lib_xnet = "xnet:";
-  const char* lib_xnetd = "xnetd:";
-  const char* lib_xnetn = "xnetn:";
-  const char* lib_xnetnd = "xnetnd:";
-  const char* lib_xnets = "xnets:";
-  const char* lib_xnetsd = "xnetsd:";
-  const char* lib_xonline = "xonline:";
-  const char* lib_xonlined = "xonlined:";
-  const char* lib_xonlinel = "xonlinel:";
-  const char* lib_xonlineld = "xonlineld:";
-  const char* lib_xonlinels = "xonlinels:";
-  const char* lib_xonlinelsd = "xonlinelsd:";
-  const char* lib_xonlinen = "xonlinen:";
-  const char* lib_xonlinend = "xonlinend:";
-  const char* lib_xonlines = "xonlines:";
-  const char* lib_xonlinesd = "xonlinesd:";
-  const char* lib_xperf = "xperf:";
-  const char* lib_xsndtrk = "xsndtrk:";
-  const char* lib_xsndtrkd = "xsndtrkd:";
-  const char* lib_xvoice = "xvoice:";
-  const char* lib_xvoiced = "xvoiced:";
-
-  /* Xbox 360 libraries */
-  const char* lib_d3d9 = "d3d9:";
-  const char* lib_d3d9d = "d3d9d:";
-  const char* lib_d3d9i = "d3d9i:";
-  const char* lib_d3d9ltcg = "d3d9ltcg:";
-  const char* lib_d3d9ltcgi = "d3d9ltcgi:";
-  const char* lib_d3dx9 = "d3dx9:";
-  const char* lib_d3dx9d = "d3dx9d:";
-  const char* lib_d3dx9i = "d3dx9i:";
-  const char* lib_dxerr9 = "dxerr9:";
-  const char* lib_libcMT = "libcMT:";
-  const char* lib_libcMTd = "libcMTd:";
-  const char* lib_libcpMT = "libcpMT:";
-  const char* lib_libcpMTd = "libcpMTd:";
-  const char* lib_libpmcpb = "libpmcpb:";
-  const char* lib_libpmcpbd = "libpmcpbd:";
-  const char* lib_multidisc = "multidisc:";
-  const char* lib_multidiscd = "multidiscd:";
-  const char* lib_nuiapi = "nuiapi:";
-  const char* lib_nuiapid = "nuiapid:";
-  const char* lib_NuiAudio = "NuiAudio:";
-  const char* lib_NuiAudiod = "NuiAudiod:";
-  const char* lib_nuifitnessapi = "nuifitnessapi:";
-  const char* lib_nuifitnessapid = "nuifitnessapid:";
-  const char* lib_nuihandles = "nuihandles:";
-  const char* lib_nuihandlesd = "nuihandlesd:";
-  const char* lib_nuispeech = "nuispeech:";
-  const char* lib_nuispeechd = "nuispeechd:";
-  //const char* lib_oldnames = "oldnames:";
-  const char* lib_qnetxaudio2 = "qnetxaudio2:";
-  const char* lib_qnetxaudio2d = "qnetxaudio2d:";
-  const char* lib_st = "st:";
-  const char* lib_std = "std:";
-  const char* lib_stltcg = "stltcg:";
-  const char* lib_tracerecording = "tracerecording:";
-  const char* lib_tracerecordingd = "tracerecordingd:";
-  const char* lib_vcomp = "vcomp:";
-  const char* lib_vcompd = "vcompd:";
-  const char* lib_x3daudio = "x3daudio:";
-  const char* lib_x3daudiod = "x3daudiod:";
-  const char* lib_x3daudioi = "x3daudioi:";
-  const char* lib_x3daudioltcg = "x3daudioltcg:";
-  const char* lib_xact3 = "xact3:";
-  const char* lib_xact3i = "xact3i:";
-  const char* lib_xact3ltcg = "xact3ltcg:";
-  const char* lib_xacta3 = "xacta3:";
-  const char* lib_xactad3 = "xactad3:";
-  const char* lib_xactd3 = "xactd3:";
-  //const char* lib_xapilib = "xapilib:";
-  //const char* lib_xapilibd = "xapilibd:";
-  const char* lib_xapilibi = "xapilibi:";
-  const char* lib_XAPOBase = "XAPOBase:";
-  const char* lib_XAPOBaseD = "XAPOBaseD:";
-  const char* lib_XAPOFX = "XAPOFX:";
-  const char* lib_XAPOFXD = "XAPOFXD:";
-  const char* lib_xaudio2 = "xaudio2:";
-  const char* lib_xaudiod2 = "xaudiod2:";
-  const char* lib_xauth = "xauth:";
-  const char* lib_xauthd = "xauthd:";
-  const char* lib_xav = "xav:";
-  const char* lib_xavatar2 = "xavatar2:";
-  const char* lib_xavatar2d = "xavatar2d:";
-  const char* lib_xavatar2ltcg = "xavatar2ltcg:";
-  const char* lib_xavd = "xavd:";
-  const char* lib_xbc = "xbc:";
-  const char* lib_xbcd = "xbcd:";
-  //const char* lib_xbdm = "xbdm:";
-  //const char* lib_xboxkrnl = "xboxkrnl:";
-  const char* lib_xcam = "xcam:";
-  const char* lib_xcamd = "xcamd:";
-  const char* lib_xffb = "xffb:";
-  const char* lib_xffbd = "xffbd:";
-  const char* lib_xgetserviceendpoint = "xgetserviceendpoint:";
-  const char* lib_xgetserviceendpointd = "xgetserviceendpointd:";
-  //const char* lib_xgraphics = "xgraphics:";
-  //const char* lib_xgraphicsd = "xgraphicsd:";
-  const char* lib_xhttp = "xhttp:";
-  const char* lib_xhttpd = "xhttpd:";
-  const char* lib_xhv2 = "xhv2:";
-  const char* lib_xhvd2 = "xhvd2:";
-  const char* lib_xime = "xime:";
-  const char* lib_ximed = "ximed:";
-  const char* lib_xinput2 = "xinput2:";
-  const char* lib_xinput2d = "xinput2d:";
-  const char* lib_xinputremap = "xinputremap:";
-  const char* lib_xinputremapd = "xinputremapd:";
-  const char* lib_xjson = "xjson:";
-  const char* lib_xjsond = "xjsond:";
-  const char* lib_xmahal = "xmahal:";
-  const char* lib_xmahald = "xmahald:";
-  const char* lib_xmahali = "xmahali:";
-  const char* lib_xmahalltcg = "xmahalltcg:";
-  const char* lib_xmcore = "xmcore:";
-  const char* lib_xmcored = "xmcored:";
-  const char* lib_xmcorei = "xmcorei:";
-  const char* lib_xmcoreltcg = "xmcoreltcg:";
-  const char* lib_xmedia2 = "xmedia2:";
-  const char* lib_xmediad2 = "xmediad2:";
-  const char* lib_xmic = "xmic:";
-  const char* lib_xmicd = "xmicd:";
-  const char* lib_xmp = "xmp:";
-  const char* lib_xmpd = "xmpd:";
-  //const char* lib_xnet = "xnet:";
-  const char* lib_xnetconfiginfo = "xnetconfiginfo:";
-  const char* lib_xnetconfiginfod = "xnetconfiginfod:";
-  //const char* lib_xnetd = "xnetd:";
-  //const char* lib_xonline = "xonline:";
-  //const char* lib_xonlined = "xonlined:";
-  const char* lib_xparty = "xparty:";
-  const char* lib_xpartyd = "xpartyd:";
-  const char* lib_xrnm = "xrnm:";
-  const char* lib_xrnmd = "xrnmd:";
-  const char* lib_xrnms = "xrnms:";
-  const char* lib_xrnmsd = "xrnmsd:";
-  const char* lib_xsim = "xsim:";
-  const char* lib_xsimd = "xsimd:";
-  const char* lib_xsocialpost = "xsocialpost:";
-  const char* lib_xsocialpostd = "xsocialpostd:";
-  const char* lib_xstudio = "xstudio:";
-  const char* lib_xtms = "xtms:";
-  const char* lib_xtmsd = "xtmsd:";
-  const char* lib_xuihtml = "xuihtml:";
-  const char* lib_xuihtmld = "xuihtmld:";
-  const char* lib_xuirender = "xuirender:";
-  const char* lib_xuirenderd = "xuirenderd:";
-  const char* lib_xuirenderltcg = "xuirenderltcg:";
-  const char* lib_xuirun = "xuirun:";
-  const char* lib_xuiruna = "xuiruna:";
-  const char* lib_xuirunad = "xuirunad:";
-  const char* lib_xuirund = "xuirund:";
-  const char* lib_xuirunltcg = "xuirunltcg:";
-  const char* lib_xuivideo = "xuivideo:";
-  const char* lib_xuivideod = "xuivideod:";
-  const char* lib_xwmadecode = "xwmadecode:";
-  const char* lib_xwmadecoded = "xwmadecoded:";
-
-  // H4 only?
-  const char* lib_retaildump = "retaildump:";
-
-  if (strchr(filename, ':') == nullptr)
-    return false;
-
-  // todo: a lot more xbox libs!
-  return (strncasecmp(filename, lib_d3d8_xbox, strlen(lib_d3d8_xbox)) == 0 ||
-    strncasecmp(filename, lib_D3D8, strlen(lib_D3D8)) == 0 ||
-    strncasecmp(filename, lib_D3DX8, strlen(lib_D3DX8)) == 0 ||
-    strncasecmp(filename, lib_D3DX8d, strlen(lib_D3DX8d)) == 0 ||
-    strncasecmp(filename, lib_d3dx8dt, strlen(lib_d3dx8dt)) == 0 ||
-    strncasecmp(filename, lib_d3dxof, strlen(lib_d3dxof)) == 0 ||
-    strncasecmp(filename, lib_dxguid, strlen(lib_dxguid)) == 0 ||
-    strncasecmp(filename, lib_winhttp5, strlen(lib_winhttp5)) == 0 ||
-    strncasecmp(filename, lib_xboxdbg, strlen(lib_xboxdbg)) == 0 ||
-    strncasecmp(filename, lib_xcontent, strlen(lib_xcontent)) == 0 ||
-    strncasecmp(filename, lib_xgraphics, strlen(lib_xgraphics)) == 0 ||
-    strncasecmp(filename, lib_xonservr, strlen(lib_xonservr)) == 0 ||
-    strncasecmp(filename, lib_d3d8d, strlen(lib_d3d8d)) == 0 ||
-    strncasecmp(filename, lib_d3d8i, strlen(lib_d3d8i)) == 0 ||
-    strncasecmp(filename, lib_d3d8ltcg, strlen(lib_d3d8ltcg)) == 0 ||
-    strncasecmp(filename, lib_dmusic, strlen(lib_dmusic)) == 0 ||
-    strncasecmp(filename, lib_dmusicd, strlen(lib_dmusicd)) == 0 ||
-    strncasecmp(filename, lib_dmusici, strlen(lib_dmusici)) == 0 ||
-    strncasecmp(filename, lib_dmusicltcg, strlen(lib_dmusicltcg)) == 0 ||
-    strncasecmp(filename, lib_dsound, strlen(lib_dsound)) == 0 ||
-    strncasecmp(filename, lib_dsoundd, strlen(lib_dsoundd)) == 0 ||
-    strncasecmp(filename, lib_libc, strlen(lib_libc)) == 0 ||
-    strncasecmp(filename, lib_libcd, strlen(lib_libcd)) == 0 ||
-    strncasecmp(filename, lib_libcmt, strlen(lib_libcmt)) == 0 ||
-    strncasecmp(filename, lib_libcmtd, strlen(lib_libcmtd)) == 0 ||
-    strncasecmp(filename, lib_libcp, strlen(lib_libcp)) == 0 ||
-    strncasecmp(filename, lib_libcpd, strlen(lib_libcpd)) == 0 ||
-    strncasecmp(filename, lib_libcpmt, strlen(lib_libcpmt)) == 0 ||
-    strncasecmp(filename, lib_libcpmtd, strlen(lib_libcpmtd)) == 0 ||
-    strncasecmp(filename, lib_oldnames, strlen(lib_oldnames)) == 0 ||
-    strncasecmp(filename, lib_uix, strlen(lib_uix)) == 0 ||
-    strncasecmp(filename, lib_uixd, strlen(lib_uixd)) == 0 ||
-    strncasecmp(filename, lib_uuid, strlen(lib_uuid)) == 0 ||
-    strncasecmp(filename, lib_xacteng, strlen(lib_xacteng)) == 0 ||
-    strncasecmp(filename, lib_xactengd, strlen(lib_xactengd)) == 0 ||
-    strncasecmp(filename, lib_xactengi, strlen(lib_xactengi)) == 0 ||
-    strncasecmp(filename, lib_xactengltcg, strlen(lib_xactengltcg)) == 0 ||
-    strncasecmp(filename, lib_xapilib, strlen(lib_xapilib)) == 0 ||
-    strncasecmp(filename, lib_xapilibd, strlen(lib_xapilibd)) == 0 ||
-    strncasecmp(filename, lib_xbdm, strlen(lib_xbdm)) == 0 ||
-    strncasecmp(filename, lib_xboxkrnl, strlen(lib_xboxkrnl)) == 0 ||
-    strncasecmp(filename, lib_xgraphicsd, strlen(lib_xgraphicsd)) == 0 ||
-    strncasecmp(filename, lib_xgraphicsltcg, strlen(lib_xgraphicsltcg)) == 0 ||
-    strncasecmp(filename, lib_xkbd, strlen(lib_xkbd)) == 0 ||
-    strncasecmp(filename, lib_xkbdd, strlen(lib_xkbdd)) == 0 ||
-    strncasecmp(filename, lib_xmv, strlen(lib_xmv)) == 0 ||
-    strncasecmp(filename, lib_xmvd, strlen(lib_xmvd)) == 0 ||
-    strncasecmp(filename, lib_xnet, strlen(lib_xnet)) == 0 ||
-    strncasecmp(filename, lib_xnetd, strlen(lib_xnetd)) == 0 ||
-    strncasecmp(filename, lib_xnetn, strlen(lib_xnetn)) == 0 ||
-    strncasecmp(filename, lib_xnetnd, strlen(lib_xnetnd)) == 0 ||
-    strncasecmp(filename, lib_xnets, strlen(lib_xnets)) == 0 ||
-    strncasecmp(filename, lib_xnetsd, strlen(lib_xnetsd)) == 0 ||
-    strncasecmp(filename, lib_xonline, strlen(lib_xonline)) == 0 ||
-    strncasecmp(filename, lib_xonlined, strlen(lib_xonlined)) == 0 ||
-    strncasecmp(filename, lib_xonlinel, strlen(lib_xonlinel)) == 0 ||
-    strncasecmp(filename, lib_xonlineld, strlen(lib_xonlineld)) == 0 ||
-    strncasecmp(filename, lib_xonlinels, strlen(lib_xonlinels)) == 0 ||
-    strncasecmp(filename, lib_xonlinelsd, strlen(lib_xonlinelsd)) == 0 ||
-    strncasecmp(filename, lib_xonlinen, strlen(lib_xonlinen)) == 0 ||
-    strncasecmp(filename, lib_xonlinend, strlen(lib_xonlinend)) == 0 ||
-    strncasecmp(filename, lib_xonlines, strlen(lib_xonlines)) == 0 ||
-    strncasecmp(filename, lib_xonlinesd, strlen(lib_xonlinesd)) == 0 ||
-    strncasecmp(filename, lib_xperf, strlen(lib_xperf)) == 0 ||
-    strncasecmp(filename, lib_xsndtrk, strlen(lib_xsndtrk)) == 0 ||
-    strncasecmp(filename, lib_xsndtrkd, strlen(lib_xsndtrkd)) == 0 ||
-    strncasecmp(filename, lib_xvoice, strlen(lib_xvoice)) == 0 ||
-    strncasecmp(filename, lib_xvoiced, strlen(lib_xvoiced)) == 0 ||
-
-    strncasecmp(filename, lib_d3d9, strlen(lib_d3d9)) == 0 ||
-    strncasecmp(filename, lib_d3d9d, strlen(lib_d3d9d)) == 0 ||
-    strncasecmp(filename, lib_d3d9i, strlen(lib_d3d9i)) == 0 ||
-    strncasecmp(filename, lib_d3d9ltcg, strlen(lib_d3d9ltcg)) == 0 ||
-    strncasecmp(filename, lib_d3d9ltcgi, strlen(lib_d3d9ltcgi)) == 0 ||
-    strncasecmp(filename, lib_d3dx9, strlen(lib_d3dx9)) == 0 ||
-    strncasecmp(filename, lib_d3dx9d, strlen(lib_d3dx9d)) == 0 ||
-    strncasecmp(filename, lib_d3dx9i, strlen(lib_d3dx9i)) == 0 ||
-    strncasecmp(filename, lib_dxerr9, strlen(lib_dxerr9)) == 0 ||
-    strncasecmp(filename, lib_libcMT, strlen(lib_libcMT)) == 0 ||
-    strncasecmp(filename, lib_libcMTd, strlen(lib_libcMTd)) == 0 ||
-    strncasecmp(filename, lib_libcpMT, strlen(lib_libcpMT)) == 0 ||
-    strncasecmp(filename, lib_libcpMTd, strlen(lib_libcpMTd)) == 0 ||
-    strncasecmp(filename, lib_libpmcpb, strlen(lib_libpmcpb)) == 0 ||
-    strncasecmp(filename, lib_libpmcpbd, strlen(lib_libpmcpbd)) == 0 ||
-    strncasecmp(filename, lib_multidisc, strlen(lib_multidisc)) == 0 ||
-    strncasecmp(filename, lib_multidiscd, strlen(lib_multidiscd)) == 0 ||
-    strncasecmp(filename, lib_nuiapi, strlen(lib_nuiapi)) == 0 ||
-    strncasecmp(filename, lib_nuiapid, strlen(lib_nuiapid)) == 0 ||
-    strncasecmp(filename, lib_NuiAudio, strlen(lib_NuiAudio)) == 0 ||
-    strncasecmp(filename, lib_NuiAudiod, strlen(lib_NuiAudiod)) == 0 ||
-    strncasecmp(filename, lib_nuifitnessapi, strlen(lib_nuifitnessapi)) == 0 ||
-    strncasecmp(filename, lib_nuifitnessapid, strlen(lib_nuifitnessapid)) == 0 ||
-    strncasecmp(filename, lib_nuihandles, strlen(lib_nuihandles)) == 0 ||
-    strncasecmp(filename, lib_nuihandlesd, strlen(lib_nuihandlesd)) == 0 ||
-    strncasecmp(filename, lib_nuispeech, strlen(lib_nuispeech)) == 0 ||
-    strncasecmp(filename, lib_nuispeechd, strlen(lib_nuispeechd)) == 0 ||
-    //strncasecmp(filename, lib_oldnames, strlen(lib_oldnames)) == 0 ||
-    strncasecmp(filename, lib_qnetxaudio2, strlen(lib_qnetxaudio2)) == 0 ||
-    strncasecmp(filename, lib_qnetxaudio2d, strlen(lib_qnetxaudio2d)) == 0 ||
-    strncasecmp(filename, lib_st, strlen(lib_st)) == 0 ||
-    strncasecmp(filename, lib_std, strlen(lib_std)) == 0 ||
-    strncasecmp(filename, lib_stltcg, strlen(lib_stltcg)) == 0 ||
-    strncasecmp(filename, lib_tracerecording, strlen(lib_tracerecording)) == 0 ||
-    strncasecmp(filename, lib_tracerecordingd, strlen(lib_tracerecordingd)) == 0 ||
-    strncasecmp(filename, lib_vcomp, strlen(lib_vcomp)) == 0 ||
-    strncasecmp(filename, lib_vcompd, strlen(lib_vcompd)) == 0 ||
-    strncasecmp(filename, lib_x3daudio, strlen(lib_x3daudio)) == 0 ||
-    strncasecmp(filename, lib_x3daudiod, strlen(lib_x3daudiod)) == 0 ||
-    strncasecmp(filename, lib_x3daudioi, strlen(lib_x3daudioi)) == 0 ||
-    strncasecmp(filename, lib_x3daudioltcg, strlen(lib_x3daudioltcg)) == 0 ||
-    strncasecmp(filename, lib_xact3, strlen(lib_xact3)) == 0 ||
-    strncasecmp(filename, lib_xact3i, strlen(lib_xact3i)) == 0 ||
-    strncasecmp(filename, lib_xact3ltcg, strlen(lib_xact3ltcg)) == 0 ||
-    strncasecmp(filename, lib_xacta3, strlen(lib_xacta3)) == 0 ||
-    strncasecmp(filename, lib_xactad3, strlen(lib_xactad3)) == 0 ||
-    strncasecmp(filename, lib_xactd3, strlen(lib_xactd3)) == 0 ||
-    //strncasecmp(filename, lib_xapilib, strlen(lib_xapilib)) == 0 ||
-    //strncasecmp(filename, lib_xapilibd, strlen(lib_xapilibd)) == 0 ||
-    strncasecmp(filename, lib_xapilibi, strlen(lib_xapilibi)) == 0 ||
-    strncasecmp(filename, lib_XAPOBase, strlen(lib_XAPOBase)) == 0 ||
-    strncasecmp(filename, lib_XAPOBaseD, strlen(lib_XAPOBaseD)) == 0 ||
-    strncasecmp(filename, lib_XAPOFX, strlen(lib_XAPOFX)) == 0 ||
-    strncasecmp(filename, lib_XAPOFXD, strlen(lib_XAPOFXD)) == 0 ||
-    strncasecmp(filename, lib_xaudio2, strlen(lib_xaudio2)) == 0 ||
-    strncasecmp(filename, lib_xaudiod2, strlen(lib_xaudiod2)) == 0 ||
-    strncasecmp(filename, lib_xauth, strlen(lib_xauth)) == 0 ||
-    strncasecmp(filename, lib_xauthd, strlen(lib_xauthd)) == 0 ||
-    strncasecmp(filename, lib_xav, strlen(lib_xav)) == 0 ||
-    strncasecmp(filename, lib_xavatar2, strlen(lib_xavatar2)) == 0 ||
-    strncasecmp(filename, lib_xavatar2d, strlen(lib_xavatar2d)) == 0 ||
-    strncasecmp(filename, lib_xavatar2ltcg, strlen(lib_xavatar2ltcg)) == 0 ||
-    strncasecmp(filename, lib_xavd, strlen(lib_xavd)) == 0 ||
-    strncasecmp(filename, lib_xbc, strlen(lib_xbc)) == 0 ||
-    strncasecmp(filename, lib_xbcd, strlen(lib_xbcd)) == 0 ||
-    //strncasecmp(filename, lib_xbdm, strlen(lib_xbdm)) == 0 ||
-    //strncasecmp(filename, lib_xboxkrnl, strlen(lib_xboxkrnl)) == 0 ||
-    strncasecmp(filename, lib_xcam, strlen(lib_xcam)) == 0 ||
-    strncasecmp(filename, lib_xcamd, strlen(lib_xcamd)) == 0 ||
-    strncasecmp(filename, lib_xffb, strlen(lib_xffb)) == 0 ||
-    strncasecmp(filename, lib_xffbd, strlen(lib_xffbd)) == 0 ||
-    strncasecmp(filename, lib_xgetserviceendpoint, strlen(lib_xgetserviceendpoint)) == 0 ||
-    strncasecmp(filename, lib_xgetserviceendpointd, strlen(lib_xgetserviceendpointd)) == 0 ||
-    //strncasecmp(filename, lib_xgraphics, strlen(lib_xgraphics)) == 0 ||
-    //strncasecmp(filename, lib_xgraphicsd, strlen(lib_xgraphicsd)) == 0 ||
-    strncasecmp(filename, lib_xhttp, strlen(lib_xhttp)) == 0 ||
-    strncasecmp(filename, lib_xhttpd, strlen(lib_xhttpd)) == 0 ||
-    strncasecmp(filename, lib_xhv2, strlen(lib_xhv2)) == 0 ||
-    strncasecmp(filename, lib_xhvd2, strlen(lib_xhvd2)) == 0 ||
-    strncasecmp(filename, lib_xime, strlen(lib_xime)) == 0 ||
-    strncasecmp(filename, lib_ximed, strlen(lib_ximed)) == 0 ||
-    strncasecmp(filename, lib_xinput2, strlen(lib_xinput2)) == 0 ||
-    strncasecmp(filename, lib_xinput2d, strlen(lib_xinput2d)) == 0 ||
-    strncasecmp(filename, lib_xinputremap, strlen(lib_xinputremap)) == 0 ||
-    strncasecmp(filename, lib_xinputremapd, strlen(lib_xinputremapd)) == 0 ||
-    strncasecmp(filename, lib_xjson, strlen(lib_xjson)) == 0 ||
-    strncasecmp(filename, lib_xjsond, strlen(lib_xjsond)) == 0 ||
-    strncasecmp(filename, lib_xmahal, strlen(lib_xmahal)) == 0 ||
-    strncasecmp(filename, lib_xmahald, strlen(lib_xmahald)) == 0 ||
-    strncasecmp(filename, lib_xmahali, strlen(lib_xmahali)) == 0 ||
-    strncasecmp(filename, lib_xmahalltcg, strlen(lib_xmahalltcg)) == 0 ||
-    strncasecmp(filename, lib_xmcore, strlen(lib_xmcore)) == 0 ||
-    strncasecmp(filename, lib_xmcored, strlen(lib_xmcored)) == 0 ||
-    strncasecmp(filename, lib_xmcorei, strlen(lib_xmcorei)) == 0 ||
-    strncasecmp(filename, lib_xmcoreltcg, strlen(lib_xmcoreltcg)) == 0 ||
-    strncasecmp(filename, lib_xmedia2, strlen(lib_xmedia2)) == 0 ||
-    strncasecmp(filename, lib_xmediad2, strlen(lib_xmediad2)) == 0 ||
-    strncasecmp(filename, lib_xmic, strlen(lib_xmic)) == 0 ||
-    strncasecmp(filename, lib_xmicd, strlen(lib_xmicd)) == 0 ||
-    strncasecmp(filename, lib_xmp, strlen(lib_xmp)) == 0 ||
-    strncasecmp(filename, lib_xmpd, strlen(lib_xmpd)) == 0 ||
-    //strncasecmp(filename, lib_xnet, strlen(lib_xnet)) == 0 ||
-    strncasecmp(filename, lib_xnetconfiginfo, strlen(lib_xnetconfiginfo)) == 0 ||
-    strncasecmp(filename, lib_xnetconfiginfod, strlen(lib_xnetconfiginfod)) == 0 ||
-    //strncasecmp(filename, lib_xnetd, strlen(lib_xnetd)) == 0 ||
-    //strncasecmp(filename, lib_xonline, strlen(lib_xonline)) == 0 ||
-    //strncasecmp(filename, lib_xonlined, strlen(lib_xonlined)) == 0 ||
-    strncasecmp(filename, lib_xparty, strlen(lib_xparty)) == 0 ||
-    strncasecmp(filename, lib_xpartyd, strlen(lib_xpartyd)) == 0 ||
-    strncasecmp(filename, lib_xrnm, strlen(lib_xrnm)) == 0 ||
-    strncasecmp(filename, lib_xrnmd, strlen(lib_xrnmd)) == 0 ||
-    strncasecmp(filename, lib_xrnms, strlen(lib_xrnms)) == 0 ||
-    strncasecmp(filename, lib_xrnmsd, strlen(lib_xrnmsd)) == 0 ||
-    strncasecmp(filename, lib_xsim, strlen(lib_xsim)) == 0 ||
-    strncasecmp(filename, lib_xsimd, strlen(lib_xsimd)) == 0 ||
-    strncasecmp(filename, lib_xsocialpost, strlen(lib_xsocialpost)) == 0 ||
-    strncasecmp(filename, lib_xsocialpostd, strlen(lib_xsocialpostd)) == 0 ||
-    strncasecmp(filename, lib_xstudio, strlen(lib_xstudio)) == 0 ||
-    strncasecmp(filename, lib_xtms, strlen(lib_xtms)) == 0 ||
-    strncasecmp(filename, lib_xtmsd, strlen(lib_xtmsd)) == 0 ||
-    strncasecmp(filename, lib_xuihtml, strlen(lib_xuihtml)) == 0 ||
-    strncasecmp(filename, lib_xuihtmld, strlen(lib_xuihtmld)) == 0 ||
-    strncasecmp(filename, lib_xuirender, strlen(lib_xuirender)) == 0 ||
-    strncasecmp(filename, lib_xuirenderd, strlen(lib_xuirenderd)) == 0 ||
-    strncasecmp(filename, lib_xuirenderltcg, strlen(lib_xuirenderltcg)) == 0 ||
-    strncasecmp(filename, lib_xuirun, strlen(lib_xuirun)) == 0 ||
-    strncasecmp(filename, lib_xuiruna, strlen(lib_xuiruna)) == 0 ||
-    strncasecmp(filename, lib_xuirunad, strlen(lib_xuirunad)) == 0 ||
-    strncasecmp(filename, lib_xuirund, strlen(lib_xuirund)) == 0 ||
-    strncasecmp(filename, lib_xuirunltcg, strlen(lib_xuirunltcg)) == 0 ||
-    strncasecmp(filename, lib_xuivideo, strlen(lib_xuivideo)) == 0 ||
-    strncasecmp(filename, lib_xuivideod, strlen(lib_xuivideod)) == 0 ||
-    strncasecmp(filename, lib_xwmadecode, strlen(lib_xwmadecode)) == 0 ||
-    strncasecmp(filename, lib_xwmadecoded, strlen(lib_xwmadecoded)) == 0 ||
-    strncasecmp(filename, lib_retaildump, strlen(lib_retaildump)) == 0);
-}
-
-////////////////////////////////////////////////////////////////////////////////
-/// @brief Open a map file and map the file content to virtual memory
-/// @param lpszFileName  Path name of file to open.
-/// @param dwSize Out variable to receive size of file.
-/// @param lpMapAddr The pointer to memory address of mapped file
-/// @return enum value of OPEN_FILE_ERROR
-/// @author TQN
-/// @date 2004.09.12
-////////////////////////////////////////////////////////////////////////////////
-MapFile::MAPResult MapFile::openMAP(const char * fileName, char * &mapAddr, size_t &dwSize)
-{
-    // Set default values for output parameters
-    mapAddr = NULL;
-    dwSize = INVALID_MAPFILE_SIZE;
-
-    // Validate all input pointer parameters
-    assert(NULL != fileName);
-    if (NULL == fileName)
-    {
-        SetLastError(ERROR_INVALID_PARAMETER);
-        return WIN32_ERROR;
-    }
-
-    // Open the file
-    HANDLE hFile = CreateFile(fileName, GENERIC_READ, FILE_SHARE_READ, NULL,
-                              OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
-    if (INVALID_HANDLE_VALUE == hFile)
-    {
-        return WIN32_ERROR;
-    }
-
-    dwSize = GetFileSize(hFile, NULL);
-    if ((INVALID_MAPFILE_SIZE == dwSize) || (0 == dwSize))
-    {
-        // File too large or empty
-        WIN32CHECK(CloseHandle(hFile));
-        return ((0 == dwSize) ? FILE_EMPTY_ERROR : WIN32_ERROR);
-    }
-
-    HANDLE hMap = CreateFileMapping(hFile, NULL, PAGE_READONLY, 0, 0, NULL);
-    if (NULL == hMap)
-    {
-        WIN32CHECK(CloseHandle(hFile));
-        return WIN32_ERROR;
-    }
-
-    // Mapping creation successful, do not need file handle anymore
-    WIN32CHECK(CloseHandle(hFile));
-
-    mapAddr = (LPSTR) MapViewOfFile(hMap, FILE_MAP_READ, 0, 0, dwSize);
-    if (NULL == mapAddr)
-    {
-        WIN32CHECK(CloseHandle(hMap));
-        return WIN32_ERROR;
-    }
-
-    // Map View successful, do not need the map handle anymore
-    WIN32CHECK(CloseHandle(hMap));
-
-    if (NULL != memchr(mapAddr, 0, dwSize))
-    {
-        // File is binary or Unicode file
-        WIN32CHECK(UnmapViewOfFile(mapAddr));
-        mapAddr = NULL;
-        return FILE_BINARY_ERROR;
-    }
-
-    return OPEN_NO_ERROR;
-}
-
-////////////////////////////////////////////////////////////////////////////////
-/// @brief Close memory map file which opened by MemMapFileOpen function.
-/// @param lpAddr: Pointer to memory return by MemMapFileOpen.
-/// @author TQN
-/// @date 2004.09.12
-////////////////////////////////////////////////////////////////////////////////
-void MapFile::closeMAP(const void * lpAddr)
-{
-    WIN32CHECK(UnmapViewOfFile(lpAddr));
-}
-
-////////////////////////////////////////////////////////////////////////////////
-/// @brief Seek to non space character at the beginning of a memory buffer.
-/// @param  lpStart Pointer to start of buffer
-/// @param  lpEnd Pointer to end of buffer
-/// @return Pointer to first non space character at the beginning of buffer
-/// @author TQN
-/// @date 2004.09.12
-////////////////////////////////////////////////////////////////////////////////
-const char * MapFile::skipSpaces(const char * pStart, const char * pEnd)
-{
-    assert(pStart != NULL);
-    assert(pEnd != NULL);
-    assert(pStart <= pEnd);
-
-    const char * p = pStart;
-    while ((p < pEnd) && isspace(*p))
-    {
-        p++;
-    }
-
-    return p;
-}
-
-////////////////////////////////////////////////////////////////////////////////
-/// @brief Find the EOL character '\r' or '\n' in a memory buffer
-/// @param  lpStart LPSTR Pointer to start of buffer
-/// @param  lpEnd LPSTR Pointer to end of buffer
-/// @return LPSTR Pointer to first EOL character in the buffer
-/// @author TQN
-/// @date 2004.09.12
-////////////////////////////////////////////////////////////////////////////////
-const char * MapFile::findEOL(const char * pStart, const char * pEnd)
-{
-    assert(pStart != NULL);
-    assert(pEnd != NULL);
-    assert(pStart <= pEnd);
-
-    const char * p = pStart;
-    while ((p < pEnd) && ('\r' != *p) && ('\n' != *p))
-    {
-        p++;
-    }
-
-    return p;
-}
-
-////////////////////////////////////////////////////////////////////////////////
-/// @brief Checks if a line is the starting line of a section to be analyzed.
-/// @param  pLine Pointer to start of buffer
-/// @param  lineLen Length of the current line
-/// @return Type of the new section, or NO_SECTION
-/// @author TL
-/// @date 2011.09.10
-////////////////////////////////////////////////////////////////////////////////
-MapFile::SectionType MapFile::recognizeSectionStart(const char *pLine, size_t lineLen)
-{
-    if (strncasecmp(pLine, MSVC_HDR_START, lineLen) == 0 || strncasecmp(pLine, MSVC_HDR_START2, lineLen) == 0)
-        return MapFile::MSVC_MAP;
-    if (strncasecmp(pLine, BCCL_HDR_NAME_START, lineLen) == 0)
-        return MapFile::BCCL_NAM_MAP;
-    if (strncasecmp(pLine, BCCL_HDR_VALUE_START, lineLen) == 0)
-        return MapFile::BCCL_VAL_MAP;
-    if (strncasecmp(pLine, WATCOM_MEMMAP_START, lineLen) == 0)
-        return MapFile::WATCOM_MAP;
-    if (strncasecmp(pLine, GCC_MEMMAP_START, lineLen) == 0)
-        return MapFile::GCC_MAP;
-    return MapFile::NO_SECTION;
-}
-
-////////////////////////////////////////////////////////////////////////////////
-/// @brief Checks if a line is the ending line of a section we analyzed.
-/// @param secType Type of the opened section.
-/// @param  pLine Pointer to start of buffer
-/// @param  lineLen Length of the current line
-/// @return Type of the new section, or value of secType if no change
-/// @author TL
-/// @date 2011.09.10
-////////////////////////////////////////////////////////////////////////////////
-MapFile::SectionType MapFile::recognizeSectionEnd(MapFile::SectionType secType, const char *pLine, size_t lineLen)
-{
-    switch (secType)
-    {
-    case MapFile::MSVC_MAP:
-        if (strncmp(pLine, MSVC_LINE_NUMBER, std::strlen(MSVC_LINE_NUMBER)) == 0)
-            return MapFile::NO_SECTION;
-        if (strncmp(pLine, MSVC_FIXUP, std::strlen(MSVC_FIXUP)) == 0)
-            return MapFile::NO_SECTION;
-        if (strncmp(pLine, MSVC_EXPORTS, std::strlen(MSVC_EXPORTS)) == 0)
-            return MapFile::NO_SECTION;
-        break;
-    case MapFile::BCCL_NAM_MAP:
-    case MapFile::BCCL_VAL_MAP:
-        break;
-    case MapFile::WATCOM_MAP:
-        if (strncmp(pLine, WATCOM_END_TABLE_HDR, std::strlen(WATCOM_END_TABLE_HDR)) == 0)
-            return MapFile::NO_SECTION;
-        break;
-    case MapFile::GCC_MAP:
-        if (strncmp(pLine, GCC_MEMMAP_END, std::strlen(GCC_MEMMAP_END)) == 0)
-            return MapFile::NO_SECTION;
-        break;
-    }
-    return secType;
-}
-
-////////////////////////////////////////////////////////////////////////////////
-/// @brief Reads one entry of Ms-like MAP file.
-/// @param sym Target  buffer for symbol data.
-/// @param  pLine Pointer to start of buffer
-/// @param  lineLen Length of the current line
-/// @param  minLineLen Minimal accepted length of line
-/// @param numOfSegs Number of segments in IDA, used to verify segment number range
-/// @return Result of the parsing
-/// @author TL
-/// @date 2011.09.10
-////////////////////////////////////////////////////////////////////////////////
-MapFile::ParseResult MapFile::parseMsSymbolLine(MapFile::MAPSymbol &sym, const char *pLine, size_t lineLen, size_t minLineLen, size_t numOfSegs)
-{
-    // Skip any entrypoint / "static symbols" lines
-    const char* testStr = "entry point at";
-    if(strncasecmp(pLine, testStr, strlen(testStr)) == 0)
-      return MapFile::SKIP_LINE;
-    const char* testStr2 = "Static symbols";
-    if (strncasecmp(pLine, testStr2, strlen(testStr2)) == 0)
-      return MapFile::STATICS_LINE;
-
-    // Get segment number, address, name, by pass spaces at beginning,
-    // between ':' character, between address and name
-    long lineCut = lineLen;
-    if (lineCut > MAXNAMELEN + minLineLen)
-        lineCut = MAXNAMELEN + minLineLen;
-    std::string testLine((const char*)pLine, lineCut);
-  /*  size_t off = std::string::npos;
-    while (off = testLine.find("  ") != std::string::npos)
-    {
-      testLine = testLine.replace(off, 2, " ");
-    }
-    if (testLine.find(' ') == 0)
-      testLine = testLine.substr(1);*/
-
-    std::istringstream iss(testLine);
-    std::vector<std::string> results((std::istream_iterator<std::string>(iss)),
-      std::istream_iterator<std::string>());
-
-    // Parse line parts
-    if(results.size() < 3)
-      return MapFile::FINISHING_LINE; // Failed, we must have parsed to end of value/name symbols table or reached EOF
-
-    auto sepIdx = results[0].find(':');
-    sym.seg = std::stoi(results[0], 0, 0x10);
-    sym.addr = std::stoi(results[0].substr(sepIdx+1), 0, 0x10);
-
-    auto& name = results[1];
-    auto& fulladdr = results[2];
-    std::string type = "";
-    if (results.size() > 3)
-      sym.type = results[3].at(0);
-    else
-      sym.type = 0;
-
-    strcpy(sym.name, name.c_str());
-
-    auto& libname = results[results.size() - 1];
-    if (libname.length())
-      strcpy(sym.libname, libname.c_str());
-
-    if ((0 == sym.seg) || (--sym.seg >= numOfSegs) ||
-            (-1 == sym.addr) || (std::strlen(sym.name) == 0) )
-    {
-        return MapFile::INVALID_LINE;
-    }
-    // Ensure name is NULL terminated
-    sym.name[MAXNAMELEN] = '\0';
-    sym.libname[260] = '\0';
-    return MapFile::SYMBOL_LINE;
-}
-
-////////////////////////////////////////////////////////////////////////////////
-/// @brief Reads one entry of Watcom-like MAP file.
-/// @param sym Target  buffer for symbol data.
-/// @param  pLine Pointer to start of buffer
-/// @param  lineLen Length of the current line
-/// @param  minLineLen Minimal accepted length of line
-/// @param numOfSegs Number of segments in IDA, used to verify segment number range
-/// @return Result of the parsing
-/// @author TL
-/// @date 2011.09.10
-////////////////////////////////////////////////////////////////////////////////
-MapFile::ParseResult MapFile::parseWatcomSymbolLine(MapFile::MAPSymbol &sym, const char *pLine, size_t lineLen, size_t minLineLen, size_t numOfSegs)
-{
-    // Get segment number, address, name, by pass spaces at beginning,
-    // between ':' character, between address and name
-    long lineCut = lineLen;
-    if (lineCut > MAXNAMELEN + minLineLen)
-        lineCut = MAXNAMELEN + minLineLen;
-    char * dupLine = (char *)std::malloc(lineCut+1);
-    strncpy(dupLine,pLine,lineCut);
-    dupLine[lineCut] = '\0';
-    if (strncasecmp(dupLine, ";", 1) == 0)
-    {
-        strncpy(sym.name,dupLine+1,MAXNAMELEN-1);
-        sym.name[MAXNAMELEN] = '\0';
-        std::free(dupLine);
-        return MapFile::COMMENT_LINE;
-    }
-    if (strncasecmp(dupLine, WATCOM_MEMMAP_SKIP, std::strlen(WATCOM_MEMMAP_SKIP)) == 0)
-    {
-        std::free(dupLine);
-        return MapFile::SKIP_LINE;
-    }
-    if (strncasecmp(dupLine, WATCOM_MEMMAP_COMMENT, std::strlen(WATCOM_MEMMAP_COMMENT)) == 0)
-    {
-        strncpy(sym.name,dupLine+std::strlen(WATCOM_MEMMAP_COMMENT),MAXNAMELEN-1);
-        sym.name[MAXNAMELEN] = '\0';
-        std::free(dupLine);
-        return MapFile::COMMENT_LINE;
-    }
-    int ret = sscanf(dupLine, " %04X : %08X%*c %[^\t\n;]", &sym.seg, &sym.addr, sym.name);
-    std::free(dupLine);
-    if (3 != ret)
-    {
-        // we have parsed to end of value/name symbols table or reached EOF
-        return MapFile::FINISHING_LINE;
-    }
-    else if ((0 == sym.seg) || (--sym.seg >= numOfSegs) ||
-            (-1 == sym.addr) || (std::strlen(sym.name) == 0) )
-    {
-        return MapFile::INVALID_LINE;
-    }
-    // Ensure name is NULL terminated
-    sym.name[MAXNAMELEN] = '\0';
-    return MapFile::SYMBOL_LINE;
-}
-
-////////////////////////////////////////////////////////////////////////////////
-/// @brief Reads one entry of GCC-like MAP file.
-/// @param sym Target  buffer for symbol data.
-/// @param  pLine Pointer to start of buffer
-/// @param  lineLen Length of the current line
-/// @param  minLineLen Minimal accepted length of line
-/// @param numOfSegs Number of segments in IDA, used to verify segment number range
-/// @return Result of the parsing
-/// @author TL
-/// @date 2012.07.18
-////////////////////////////////////////////////////////////////////////////////
-MapFile::ParseResult MapFile::parseGccSymbolLine(MapFile::MAPSymbol &sym, const char *pLine, size_t lineLen, size_t minLineLen, size_t numOfSegs)
-{
-    // Get segment number, address, name, by pass spaces at beginning,
-    // between ':' character, between address and name
-    long lineCut = lineLen;
-    if (lineCut > MAXNAMELEN + minLineLen)
-        lineCut = MAXNAMELEN + minLineLen;
-    char * dupLine = (char *)std::malloc(lineCut+1);
-    strncpy(dupLine,pLine,lineCut);
-    dupLine[lineCut] = '\0';
-    if (strncasecmp(dupLine, ";", 1) == 0)
-    {
-        strncpy(sym.name,dupLine+1,MAXNAMELEN-1);
-        sym.name[MAXNAMELEN] = '\0';
-        std::free(dupLine);
-        return MapFile::COMMENT_LINE;
-    }
-    if ( (strncasecmp(dupLine, GCC_MEMMAP_SKIP1, std::strlen(GCC_MEMMAP_SKIP1)) == 0) ||
-         (strncasecmp(dupLine, GCC_MEMMAP_SKIP2, std::strlen(GCC_MEMMAP_SKIP2)) == 0) )
-    {
-        std::free(dupLine);
-        return MapFile::SKIP_LINE;
-    }
-    if ( (strncasecmp(dupLine, GCC_MEMMAP_SKIP3, std::strlen(GCC_MEMMAP_SKIP3)) == 0) ||
-         (strncasecmp(dupLine, GCC_MEMMAP_SKIP4, std::strlen(GCC_MEMMAP_SKIP4)) == 0) )
-    {
-        std::free(dupLine);
-        return MapFile::SKIP_LINE;
-    }
-    if (strncasecmp(dupLine, GCC_MEMMAP_LOAD, std::strlen(GCC_MEMMAP_LOAD)) == 0)
-    {
-        strncpy(sym.name,dupLine,MAXNAMELEN-1);
-        sym.name[MAXNAMELEN] = '\0';
-        std::free(dupLine);
-        return MapFile::COMMENT_LINE;
-    }
-    unsigned long linear_addr;
-    int ret = sscanf(dupLine, " 0x%08X%*c %[^\t\n;]", &linear_addr, sym.name);
-    std::free(dupLine);
-    if (2 != ret)
-    {
-        // we have parsed to end of value/name symbols table or reached EOF
-        return MapFile::FINISHING_LINE;
-    }
-    linearAddressToSymbolAddr(sym, linear_addr);
-    if ((sym.seg >= numOfSegs) || (-1 == sym.addr) || (std::strlen(sym.name) == 0) )
-    {
-        return MapFile::INVALID_LINE;
-    }
-    // Ensure name is NULL terminated
-    sym.name[MAXNAMELEN] = '\0';
-    return MapFile::SYMBOL_LINE;
-}
-
-////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+/// @file MAPReader.h
+///     MAP file analysis and loading routines.
+/// @par Purpose:
+///     Library for loading MAP file entries.
+/// @author TQN <truong_quoc_ngan@yahoo.com>
+/// @author TL <mefistotelis@gmail.com>
+/// @date 2004.09.11 - 2018.11.08
+/// @par  Copying and copyrights:
+///     This program is free software; you can redistribute it and/or modify
+///     it under the terms of the GNU General Public License as published by
+///     the Free Software Foundation; either version 2 of the License, or
+///     (at your option) any later version.
+////////////////////////////////////////////////////////////////////////////////
+
+#include  "MAPReader.h"
+
+#include  <cstring>
+#include  <cctype>
+#include  <cassert>
+#include  <cstdlib>
+#include <string>
+#include <vector>
+#include <atomic>
+#include <exception>
+#include <thread>
+#include "stdafx.h"
+
+#if defined(__x86_64__) || defined(_M_X64)
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+#ifndef _WIN32
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+namespace MapFile {
+
+/// @name Strings used to identify start of symbol table in various MAP files.
+/// @{
+constexpr char MSVC_HDR_START[]        = "Address         Publics by Value              Rva+Base     Lib:Object";
+constexpr char MSVC_HDR_START2[]       = "Address         Publics by Value              Rva+Base       Lib:Object";
+constexpr char BCCL_HDR_NAME_START[]   = "Address         Publics by Name";
+constexpr char BCCL_HDR_VALUE_START[]  = "Address         Publics by Value";
+constexpr char WATCOM_MEMMAP_START[]   = "Address        Symbol";
+constexpr char WATCOM_MEMMAP_SKIP[]   = "=======        ======";
+constexpr char WATCOM_MEMMAP_COMMENT[] = "Module: ";
+constexpr char WATCOM_END_TABLE_HDR[]  = "+----------------------+";
+constexpr char MSVC_LINE_NUMBER[]      = "Line numbers for ";
+constexpr char MSVC_FIXUP[]            = "FIXUPS: ";
+constexpr char MSVC_EXPORTS[]          = " Exports";
+constexpr char MSVC_ENTRY_POINT[]      = "entry point at";
+constexpr char MSVC_STATICS[]          = "Static symbols";
+constexpr char GCC_MEMMAP_START[]      = "Linker script and memory map";
+constexpr char GCC_MEMMAP_SKIP1[]       = ".";
+constexpr char GCC_MEMMAP_SKIP2[]       = " .";
+constexpr char GCC_MEMMAP_SKIP3[]       = "*";
+constexpr char GCC_MEMMAP_SKIP4[]       = " *";
+constexpr char GCC_MEMMAP_END[]        = "OUTPUT(";
+constexpr char GCC_MEMMAP_LOAD[]       = "LOAD ";
+
+/// @}
+
+/// @name Names of Xbox SDK libraries, as in "library:object" entries of the
+///     Lib:Object column. Matched case-insensitively; add new libraries here.
+/// @{
+constexpr const char * XBOX_LIBRARY_NAMES[] = {
+    /* Xbox OG libraries */
+    "d3d8-xbox", "D3D8", "D3DX8", "D3DX8d", "d3dx8dt", "d3dxof", "dxguid",
+    "winhttp5", "xboxdbg", "xcontent", "xgraphics", "xonservr", "d3d8d", "d3d8i",
+    "d3d8ltcg", "dmusic", "dmusicd", "dmusici", "dmusicltcg", "dsound", "dsoundd",
+    "libc", "libcd", "libcmt", "libcmtd", "libcp", "libcpd", "libcpmt", "libcpmtd",
+    "oldnames", "uix", "uixd", "uuid", "xacteng", "xactengd", "xactengi",
+    "xactengltcg", "xapilib", "xapilibd", "xbdm", "xboxkrnl", "xgraphicsd",
+    "xgraphicsltcg", "xkbd", "xkbdd", "xmv", "xmvd", "xnet", "xnetd", "xnetn",
+    "xnetnd", "xnets", "xnetsd", "xonline", "xonlined", "xonlinel", "xonlineld",
+    "xonlinels", "xonlinelsd", "xonlinen", "xonlinend", "xonlines", "xonlinesd",
+    "xperf", "xsndtrk", "xsndtrkd", "xvoice", "xvoiced",
+    /* Xbox 360 libraries, not counting ones shared with the OG SDK */
+    "d3d9", "d3d9d", "d3d9i", "d3d9ltcg", "d3d9ltcgi", "d3dx9", "d3dx9d", "d3dx9i",
+    "dxerr9", "libpmcpb", "libpmcpbd", "multidisc", "multidiscd", "nuiapi",
+    "nuiapid", "NuiAudio", "NuiAudiod", "nuifitnessapi", "nuifitnessapid",
+    "nuihandles", "nuihandlesd", "nuispeech", "nuispeechd", "qnetxaudio2",
+    "qnetxaudio2d", "st", "std", "stltcg", "tracerecording", "tracerecordingd",
+    "vcomp", "vcompd", "x3daudio", "x3daudiod", "x3daudioi", "x3daudioltcg",
+    "xact3", "xact3i", "xact3ltcg", "xacta3", "xactad3", "xactd3", "xapilibi",
+    "XAPOBase", "XAPOBaseD", "XAPOFX", "XAPOFXD", "xaudio2", "xaudiod2", "xauth",
+    "xauthd", "xav", "xavatar2", "xavatar2d", "xavatar2ltcg", "xavd", "xbc",
+    "xbcd", "xcam", "xcamd", "xffb", "xffbd", "xgetserviceendpoint",
+    "xgetserviceendpointd", "xhttp", "xhttpd", "xhv2", "xhvd2", "xime", "ximed",
+    "xinput2", "xinput2d", "xinputremap", "xinputremapd", "xjson", "xjsond",
+    "xmahal", "xmahald", "xmahali", "xmahalltcg", "xmcore", "xmcored", "xmcorei",
+    "xmcoreltcg", "xmedia2", "xmediad2", "xmic", "xmicd", "xmp", "xmpd",
+    "xnetconfiginfo", "xnetconfiginfod", "xparty", "xpartyd", "xrnm", "xrnmd",
+    "xrnms", "xrnmsd", "xsim", "xsimd", "xsocialpost", "xsocialpostd", "xstudio",
+    "xtms", "xtmsd", "xuihtml", "xuihtmld", "xuirender", "xuirenderd",
+    "xuirenderltcg", "xuirun", "xuiruna", "xuirunad", "xuirund", "xuirunltcg",
+    "xuivideo", "xuivideod", "xwmadecode", "xwmadecoded",
+    /* H4 only? */
+    "retaildump",
+};
+/// @}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Hash table of XBOX_LIBRARY_NAMES, built at compile time.
+///     Uses FNV-1a of the lowercase name and linear probing.
+////////////////////////////////////////////////////////////////////////////////
+class XboxLibraryTable {
+public:
+    static constexpr size_t SLOTS = 512;
+    static constexpr size_t MAX_NAME_LEN = 32;
+
+    static constexpr char toLower(char c)
+    {
+        return ((c >= 'A') && (c <= 'Z')) ? (char)(c - 'A' + 'a') : c;
+    }
+
+    static constexpr unsigned long hashStep(unsigned long hash, char c)
+    {
+        return ((hash ^ (unsigned char)toLower(c)) * 16777619UL) & 0xffffffffUL;
+    }
+
+    static constexpr unsigned long hashName(const char * name)
+    {
+        unsigned long hash = 2166136261UL;
+        for (; *name != '\0'; name++)
+            hash = hashStep(hash, *name);
+        return hash;
+    }
+
+    constexpr XboxLibraryTable() : slots()
+    {
+        for (const char * name : XBOX_LIBRARY_NAMES)
+        {
+            size_t idx = hashName(name) % SLOTS;
+            while (slots[idx] != nullptr)
+                idx = (idx + 1) % SLOTS;
+            slots[idx] = name;
+        }
+    }
+
+    /// Checks if the part of filename before ':' is one of the library names
+    bool containsPrefixOf(const char * filename) const
+    {
+        unsigned long hash = 2166136261UL;
+        size_t len = 0;
+        for (; filename[len] != ':'; len++)
+        {
+            if ((filename[len] == '\0') || (len >= MAX_NAME_LEN))
+                return false;
+            hash = hashStep(hash, filename[len]);
+        }
+        for (size_t idx = hash % SLOTS; slots[idx] != nullptr; idx = (idx + 1) % SLOTS)
+        {
+            if ((strncasecmp(slots[idx], filename, len) == 0) && (slots[idx][len] == '\0'))
+                return true;
+        }
+        return false;
+    }
+
+private:
+    const char * slots[SLOTS];
+};
+
+static_assert(sizeof(XBOX_LIBRARY_NAMES) / sizeof(XBOX_LIBRARY_NAMES[0]) < XboxLibraryTable::SLOTS / 2,
+    "XboxLibraryTable needs more slots");
+
+constexpr XboxLibraryTable XBOX_LIBRARY_TABLE;
+
+/// How a line is compared with a section marker
+typedef enum {
+    /// Whole line is a case-insensitive prefix of the marker
+    MATCH_LINE_IS_PREFIX = 0,
+    /// Line starts with the marker, case-sensitive
+    MATCH_MARKER_IS_PREFIX,
+} MarkerMatch;
+
+struct SectionMarker {
+    const char * text;
+    /// Section in which the marker is looked for; NO_SECTION for headers
+    MapFile::SectionType inSection;
+    /// Section which the marker starts
+    MapFile::SectionType newSection;
+    MarkerMatch match;
+};
+
+/// @name Lines which start and end the analyzed sections, in priority order.
+///     Add markers of new toolchains here.
+/// @{
+constexpr SectionMarker SECTION_MARKERS[] = {
+    { MSVC_HDR_START,       NO_SECTION, MSVC_MAP,     MATCH_LINE_IS_PREFIX },
+    { MSVC_HDR_START2,      NO_SECTION, MSVC_MAP,     MATCH_LINE_IS_PREFIX },
+    { BCCL_HDR_NAME_START,  NO_SECTION, BCCL_NAM_MAP, MATCH_LINE_IS_PREFIX },
+    { BCCL_HDR_VALUE_START, NO_SECTION, BCCL_VAL_MAP, MATCH_LINE_IS_PREFIX },
+    { WATCOM_MEMMAP_START,  NO_SECTION, WATCOM_MAP,   MATCH_LINE_IS_PREFIX },
+    { GCC_MEMMAP_START,     NO_SECTION, GCC_MAP,      MATCH_LINE_IS_PREFIX },
+    { MSVC_LINE_NUMBER,     MSVC_MAP,   NO_SECTION,   MATCH_MARKER_IS_PREFIX },
+    { MSVC_FIXUP,           MSVC_MAP,   NO_SECTION,   MATCH_MARKER_IS_PREFIX },
+    { MSVC_EXPORTS,         MSVC_MAP,   NO_SECTION,   MATCH_MARKER_IS_PREFIX },
+    { WATCOM_END_TABLE_HDR, WATCOM_MAP, NO_SECTION,   MATCH_MARKER_IS_PREFIX },
+    { GCC_MEMMAP_END,       GCC_MAP,    NO_SECTION,   MATCH_MARKER_IS_PREFIX },
+};
+/// @}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Matcher of SECTION_MARKERS, built at compile time.
+///     Candidates are selected by section and first byte of the line, then
+///     all of them are compared with the line in one pass over its bytes.
+////////////////////////////////////////////////////////////////////////////////
+class SectionMarkerMatcher {
+public:
+    static constexpr size_t NUM_MARKERS = sizeof(SECTION_MARKERS) / sizeof(SECTION_MARKERS[0]);
+    static constexpr size_t NUM_SECTION_TYPES = MapFile::GCC_MAP + 1;
+
+    static constexpr char toLower(char c)
+    {
+        return ((c >= 'A') && (c <= 'Z')) ? (char)(c - 'A' + 'a') : c;
+    }
+
+    static constexpr char toUpper(char c)
+    {
+        return ((c >= 'a') && (c <= 'z')) ? (char)(c - 'a' + 'A') : c;
+    }
+
+    static constexpr size_t length(const char * text)
+    {
+        size_t len = 0;
+        while (text[len] != '\0')
+            len++;
+        return len;
+    }
+
+    constexpr SectionMarkerMatcher() : lengths(), inSection(), firstByte()
+    {
+        for (size_t i = 0; i < NUM_MARKERS; i++)
+        {
+            const SectionMarker &marker = SECTION_MARKERS[i];
+            const unsigned long bit = 1UL << i;
+            lengths[i] = length(marker.text);
+            inSection[marker.inSection] |= bit;
+            const char c = marker.text[0];
+            if (marker.match == MATCH_LINE_IS_PREFIX)
+            {
+                firstByte[(unsigned char)toLower(c)] |= bit;
+                firstByte[(unsigned char)toUpper(c)] |= bit;
+            } else
+            {
+                firstByte[(unsigned char)c] |= bit;
+            }
+        }
+    }
+
+    /// Gets section started by the first marker matching the line,
+    /// or secType if no marker of that section matches
+    MapFile::SectionType match(MapFile::SectionType secType, const char * pLine, size_t lineLen) const
+    {
+        unsigned long alive = inSection[secType];
+        size_t pos = 0;
+        if (lineLen > 0)
+        {
+            alive &= firstByte[(unsigned char)pLine[0]];
+            pos = 1;
+        }
+        unsigned long matched = 0;
+        for (; alive != 0; pos++)
+        {
+            for (size_t i = 0; i < NUM_MARKERS; i++)
+            {
+                const unsigned long bit = 1UL << i;
+                if ((alive & bit) == 0)
+                    continue;
+                const SectionMarker &marker = SECTION_MARKERS[i];
+                if (pos == lineLen)
+                {
+                    if ((marker.match == MATCH_LINE_IS_PREFIX) || (pos == lengths[i]))
+                        matched |= bit;
+                    alive &= ~bit;
+                } else
+                if (pos == lengths[i])
+                {
+                    if (marker.match == MATCH_MARKER_IS_PREFIX)
+                        matched |= bit;
+                    alive &= ~bit;
+                } else
+                if (marker.match == MATCH_LINE_IS_PREFIX ?
+                    (toLower(pLine[pos]) != toLower(marker.text[pos])) : (pLine[pos] != marker.text[pos]))
+                {
+                    alive &= ~bit;
+                }
+            }
+        }
+        for (size_t i = 0; i < NUM_MARKERS; i++)
+        {
+            if (matched & (1UL << i))
+                return SECTION_MARKERS[i].newSection;
+        }
+        return secType;
+    }
+
+private:
+    size_t lengths[NUM_MARKERS];
+    /// Bit masks of markers, indexed by section type
+    unsigned long inSection[NUM_SECTION_TYPES];
+    /// Bit masks of markers, indexed by first byte of the line
+    unsigned long firstByte[256];
+};
+
+static_assert(SectionMarkerMatcher::NUM_MARKERS <= 32, "SectionMarkerMatcher needs wider masks");
+
+constexpr SectionMarkerMatcher SECTION_MARKER_MATCHER;
+
+};
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Checks if a Lib:Object entry comes from one of Xbox SDK libraries.
+/// @param  filename Entry in "library:object" form
+/// @return True if library is listed in XBOX_LIBRARY_NAMES
+////////////////////////////////////////////////////////////////////////////////
+bool MapFile::isXboxLibraryFile(const char* filename)
+{
+    return XBOX_LIBRARY_TABLE.containsPrefixOf(filename);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Open any file and map the file content to virtual memory
+/// @param lpszFileName  Path name of file to open.
+/// @param view Out variable to receive address and size of the mapped file.
+/// @return enum value of OPEN_FILE_ERROR; FILE_BINARY_ERROR is never returned
+/// @author TQN
+/// @date 2004.09.12
+////////////////////////////////////////////////////////////////////////////////
+MapFile::MAPResult MapFile::openView(const char * fileName, MapFile::MAPView &view)
+{
+    // Set default values for output parameters
+    view.addr = NULL;
+    view.size = INVALID_MAPFILE_SIZE;
+
+    // Validate all input pointer parameters
+    assert(NULL != fileName);
+    if (NULL == fileName)
+    {
+#ifdef _WIN32
+        SetLastError(ERROR_INVALID_PARAMETER);
+#else
+        errno = EINVAL;
+#endif
+        return WIN32_ERROR;
+    }
+
+#ifdef _WIN32
+    // Open the file
+    HANDLE hFile = CreateFile(fileName, GENERIC_READ, FILE_SHARE_READ, NULL,
+                              OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (INVALID_HANDLE_VALUE == hFile)
+    {
+        return WIN32_ERROR;
+    }
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(hFile, &fileSize))
+    {
+        WIN32CHECK(CloseHandle(hFile));
+        return WIN32_ERROR;
+    }
+    if ((0 == fileSize.QuadPart) ||
+        ((unsigned long long)fileSize.QuadPart >= (unsigned long long)INVALID_MAPFILE_SIZE))
+    {
+        // File too large for the address space or empty
+        WIN32CHECK(CloseHandle(hFile));
+        return ((0 == fileSize.QuadPart) ? FILE_EMPTY_ERROR : WIN32_ERROR);
+    }
+    const size_t dwSize = (size_t)fileSize.QuadPart;
+
+    HANDLE hMap = CreateFileMapping(hFile, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (NULL == hMap)
+    {
+        WIN32CHECK(CloseHandle(hFile));
+        return WIN32_ERROR;
+    }
+
+    // Mapping creation successful, do not need file handle anymore
+    WIN32CHECK(CloseHandle(hFile));
+
+    char * mapAddr = (LPSTR) MapViewOfFile(hMap, FILE_MAP_READ, 0, 0, dwSize);
+    if (NULL == mapAddr)
+    {
+        WIN32CHECK(CloseHandle(hMap));
+        return WIN32_ERROR;
+    }
+
+    // Map View successful, do not need the map handle anymore
+    WIN32CHECK(CloseHandle(hMap));
+#else
+    int fd = open(fileName, O_RDONLY);
+    if (fd < 0)
+    {
+        return WIN32_ERROR;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0)
+    {
+        close(fd);
+        return WIN32_ERROR;
+    }
+    if ((0 == st.st_size) ||
+        ((unsigned long long)st.st_size >= (unsigned long long)INVALID_MAPFILE_SIZE))
+    {
+        // File too large for the address space or empty
+        close(fd);
+        return ((0 == st.st_size) ? FILE_EMPTY_ERROR : WIN32_ERROR);
+    }
+    const size_t dwSize = (size_t)st.st_size;
+
+    void * mapping = mmap(NULL, dwSize, PROT_READ, MAP_PRIVATE, fd, 0);
+    // The mapping keeps its own reference to the file
+    close(fd);
+    if (MAP_FAILED == mapping)
+    {
+        return WIN32_ERROR;
+    }
+    // The MAP is parsed front to back, let the kernel read ahead aggressively
+    madvise(mapping, dwSize, MADV_SEQUENTIAL);
+    char * mapAddr = (char *) mapping;
+#endif
+
+    view.addr = mapAddr;
+    view.size = dwSize;
+    return OPEN_NO_ERROR;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Open a map file and map the file content to virtual memory
+/// @param lpszFileName  Path name of file to open.
+/// @param view Out variable to receive address and size of the mapped file.
+/// @return enum value of OPEN_FILE_ERROR
+/// @author TQN
+/// @date 2004.09.12
+////////////////////////////////////////////////////////////////////////////////
+MapFile::MAPResult MapFile::openMAP(const char * fileName, MapFile::MAPView &view)
+{
+    const MapFile::MAPResult eRet = openView(fileName, view);
+    if (OPEN_NO_ERROR != eRet)
+        return eRet;
+
+    if (NULL != memchr(view.addr, 0, view.size))
+    {
+        // File is binary or Unicode file
+        closeMAP(view);
+        return FILE_BINARY_ERROR;
+    }
+
+    return OPEN_NO_ERROR;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Close memory map file which opened by openMAP or openView function.
+/// @param view: View returned by openMAP; it is reset to empty.
+/// @author TQN
+/// @date 2004.09.12
+////////////////////////////////////////////////////////////////////////////////
+void MapFile::closeMAP(MapFile::MAPView &view)
+{
+    if (NULL == view.addr)
+        return;
+#ifdef _WIN32
+    WIN32CHECK(UnmapViewOfFile(view.addr));
+#else
+    munmap(view.addr, view.size);
+#endif
+    view.addr = NULL;
+    view.size = INVALID_MAPFILE_SIZE;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Seek to non space character at the beginning of a memory buffer.
+/// @param  lpStart Pointer to start of buffer
+/// @param  lpEnd Pointer to end of buffer
+/// @return Pointer to first non space character at the beginning of buffer
+/// @author TQN
+/// @date 2004.09.12
+////////////////////////////////////////////////////////////////////////////////
+const char * MapFile::skipSpaces(const char * pStart, const char * pEnd)
+{
+    assert(pStart != NULL);
+    assert(pEnd != NULL);
+    assert(pStart <= pEnd);
+
+    const char * p = pStart;
+    while ((p < pEnd) && isspace(*p))
+    {
+        p++;
+    }
+
+    return p;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Find the EOL character '\r' or '\n' in a memory buffer
+/// @param  lpStart LPSTR Pointer to start of buffer
+/// @param  lpEnd LPSTR Pointer to end of buffer
+/// @return LPSTR Pointer to first EOL character in the buffer
+/// @author TQN
+/// @date 2004.09.12
+////////////////////////////////////////////////////////////////////////////////
+const char * MapFile::findEOL(const char * pStart, const char * pEnd)
+{
+    assert(pStart != NULL);
+    assert(pEnd != NULL);
+    assert(pStart <= pEnd);
+
+    const char * p = pStart;
+    while ((p < pEnd) && ('\r' != *p) && ('\n' != *p))
+    {
+        p++;
+    }
+
+    return p;
+}
+
+#if defined(__x86_64__) || defined(_M_X64)
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Index of the lowest set bit; mask must not be zero.
+////////////////////////////////////////////////////////////////////////////////
+static inline unsigned lowestBitIndex(unsigned mask)
+{
+#ifdef _MSC_VER
+    unsigned long idx;
+    _BitScanForward(&idx, mask);
+    return (unsigned)idx;
+#else
+    return (unsigned)__builtin_ctz(mask);
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Stores offsets of EOL characters, 16 bytes at a time.
+/// @return Offset at which the scalar tail should continue
+////////////////////////////////////////////////////////////////////////////////
+static size_t findEOLsSSE2(const char * pStart, size_t size, std::vector<size_t> &eolOffsets)
+{
+    const __m128i vecCR = _mm_set1_epi8('\r');
+    const __m128i vecLF = _mm_set1_epi8('\n');
+    size_t offs = 0;
+    for (; offs + 16 <= size; offs += 16)
+    {
+        const __m128i chunk = _mm_loadu_si128((const __m128i *)(pStart + offs));
+        unsigned mask = (unsigned)_mm_movemask_epi8(_mm_or_si128(
+            _mm_cmpeq_epi8(chunk, vecCR), _mm_cmpeq_epi8(chunk, vecLF)));
+        while (mask != 0)
+        {
+            eolOffsets.push_back(offs + lowestBitIndex(mask));
+            mask &= mask - 1;
+        }
+    }
+    return offs;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Stores offsets of EOL characters, 32 bytes at a time.
+/// @return Offset at which the scalar tail should continue
+////////////////////////////////////////////////////////////////////////////////
+#ifndef _MSC_VER
+__attribute__((target("avx2")))
+#endif
+static size_t findEOLsAVX2(const char * pStart, size_t size, std::vector<size_t> &eolOffsets)
+{
+    const __m256i vecCR = _mm256_set1_epi8('\r');
+    const __m256i vecLF = _mm256_set1_epi8('\n');
+    size_t offs = 0;
+    for (; offs + 32 <= size; offs += 32)
+    {
+        const __m256i chunk = _mm256_loadu_si256((const __m256i *)(pStart + offs));
+        unsigned mask = (unsigned)_mm256_movemask_epi8(_mm256_or_si256(
+            _mm256_cmpeq_epi8(chunk, vecCR), _mm256_cmpeq_epi8(chunk, vecLF)));
+        while (mask != 0)
+        {
+            eolOffsets.push_back(offs + lowestBitIndex(mask));
+            mask &= mask - 1;
+        }
+    }
+    return offs;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Checks if both the CPU and the OS support AVX2.
+////////////////////////////////////////////////////////////////////////////////
+static bool hasAVX2()
+{
+#ifdef _MSC_VER
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7)
+        return false;
+    __cpuid(info, 1);
+    // OSXSAVE and AVX, then check the OS saves YMM registers
+    if ((info[2] & (1 << 27)) == 0 || (info[2] & (1 << 28)) == 0)
+        return false;
+    if ((_xgetbv(0) & 0x6) != 0x6)
+        return false;
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2") != 0;
+#endif
+}
+#else
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Vector part used when there is no SIMD support; scans nothing.
+////////////////////////////////////////////////////////////////////////////////
+static size_t findEOLsNone(const char *, size_t, std::vector<size_t> &)
+{
+    return 0;
+}
+#endif
+
+typedef size_t (*EOLScanner)(const char * pStart, size_t size, std::vector<size_t> &eolOffsets);
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Chooses the widest EOL scanner the running CPU supports.
+////////////////////////////////////////////////////////////////////////////////
+static EOLScanner selectEOLScanner()
+{
+#if defined(__x86_64__) || defined(_M_X64)
+    if (hasAVX2())
+        return findEOLsAVX2;
+    return findEOLsSSE2;
+#else
+    return findEOLsNone;
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Finds all EOL characters '\r' and '\n' in a memory buffer in one pass
+/// @param  pStart Pointer to start of buffer
+/// @param  pEnd Pointer to end of buffer
+/// @param  eolOffsets Receives offsets from pStart of every EOL character, in order
+////////////////////////////////////////////////////////////////////////////////
+void MapFile::findAllEOLs(const char * pStart, const char * pEnd, std::vector<size_t> &eolOffsets)
+{
+    assert(pStart != NULL);
+    assert(pEnd != NULL);
+    assert(pStart <= pEnd);
+
+    static const EOLScanner scanner = selectEOLScanner();
+    const size_t size = (size_t)(pEnd - pStart);
+    eolOffsets.clear();
+    // Typical MAP lines are longer than 32 characters
+    eolOffsets.reserve(size / 32);
+
+    size_t offs = scanner(pStart, size, eolOffsets);
+    for (; offs < size; offs++)
+    {
+        if (('\r' == pStart[offs]) || ('\n' == pStart[offs]))
+            eolOffsets.push_back(offs);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Checks if a line is the starting line of a section to be analyzed.
+/// @param  pLine Pointer to start of buffer
+/// @param  lineLen Length of the current line
+/// @return Type of the new section, or NO_SECTION
+/// @author TL
+/// @date 2011.09.10
+////////////////////////////////////////////////////////////////////////////////
+MapFile::SectionType MapFile::recognizeSectionStart(const char *pLine, size_t lineLen)
+{
+    return SECTION_MARKER_MATCHER.match(MapFile::NO_SECTION, pLine, lineLen);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Checks if a line is the ending line of a section we analyzed.
+/// @param secType Type of the opened section.
+/// @param  pLine Pointer to start of buffer
+/// @param  lineLen Length of the current line
+/// @return Type of the new section, or value of secType if no change
+/// @author TL
+/// @date 2011.09.10
+////////////////////////////////////////////////////////////////////////////////
+MapFile::SectionType MapFile::recognizeSectionEnd(MapFile::SectionType secType, const char *pLine, size_t lineLen)
+{
+    return SECTION_MARKER_MATCHER.match(secType, pLine, lineLen);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Reads hexadecimal number from a buffer which is not NUL-terminated.
+///     Accepts optional sign and "0x" prefix, like strtoul() with base 16 does;
+///     negative numbers wrap around, as the int from std::stoi() did when
+///     stored into MAPSymbol.
+/// @param  pStart Pointer to start of the number
+/// @param  pEnd Pointer to end of buffer
+/// @param  value Out variable to receive the number
+/// @return Pointer after the last digit, or NULL if there are no digits
+////////////////////////////////////////////////////////////////////////////////
+static const char * parseHexNumber(const char * pStart, const char * pEnd, unsigned long &value)
+{
+    const char * p = pStart;
+    bool isNegative = false;
+    if ((p < pEnd) && ((*p == '+') || (*p == '-')))
+    {
+        isNegative = (*p == '-');
+        p++;
+    }
+    if ((pEnd - p > 2) && (p[0] == '0') && ((p[1] == 'x') || (p[1] == 'X')) && isxdigit((unsigned char)p[2]))
+        p += 2;
+
+    const char * pDigits = p;
+    unsigned long result = 0;
+    for (; p < pEnd; p++)
+    {
+        unsigned char c = (unsigned char)*p;
+        unsigned long digit;
+        if (c >= '0' && c <= '9')
+            digit = c - '0';
+        else if (c >= 'a' && c <= 'f')
+            digit = c - 'a' + 10;
+        else if (c >= 'A' && c <= 'F')
+            digit = c - 'A' + 10;
+        else
+            break;
+        result = (result << 4) | digit;
+    }
+    if (p == pDigits)
+        return NULL;
+    value = isNegative ? (0 - result) : result;
+    return p;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Reads unsigned number from a buffer which is not NUL-terminated.
+/// @param  pStart Pointer to start of the number
+/// @param  pEnd Pointer to end of buffer
+/// @param  base Base of the number, 10 or 16
+/// @param  value Out variable to receive the number
+/// @return Pointer after the last digit, or NULL if there are no digits
+////////////////////////////////////////////////////////////////////////////////
+const char * MapFile::parseNumber(const char * pStart, const char * pEnd, unsigned base, unsigned long &value)
+{
+    const char * p = pStart;
+    unsigned long result = 0;
+    for (; p < pEnd; p++)
+    {
+        unsigned char c = (unsigned char)*p;
+        unsigned long digit;
+        if (c >= '0' && c <= '9')
+            digit = c - '0';
+        else if (c >= 'a' && c <= 'f')
+            digit = c - 'a' + 10;
+        else if (c >= 'A' && c <= 'F')
+            digit = c - 'A' + 10;
+        else
+            break;
+        if (digit >= base)
+            break;
+        result = result * base + digit;
+    }
+    if (p == pStart)
+        return NULL;
+    value = result;
+    return p;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Finds next field of a MAP line, skipping separators before it.
+/// @param  pStart Pointer to start of buffer
+/// @param  pEnd Pointer to end of buffer
+/// @param  pFieldEnd Out variable to receive pointer after the field
+/// @return Pointer to start of the field, or NULL if there are no more fields
+////////////////////////////////////////////////////////////////////////////////
+const char * MapFile::nextField(const char * pStart, const char * pEnd, const char * &pFieldEnd)
+{
+    const char * p = pStart;
+    while ((p < pEnd) && isFieldSeparator(*p))
+        p++;
+    if (p >= pEnd)
+        return NULL;
+    const char * pField = p;
+    while ((p < pEnd) && !isFieldSeparator(*p))
+        p++;
+    pFieldEnd = p;
+    return pField;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Reads one entry of Ms-like MAP file.
+/// @param sym Target  buffer for symbol data.
+/// @param  pLine Pointer to start of buffer
+/// @param  lineLen Length of the current line
+/// @param  minLineLen Minimal accepted length of line
+/// @param numOfSegs Number of segments in IDA, used to verify segment number range
+/// @return Result of the parsing
+/// @author TL
+/// @date 2011.09.10
+////////////////////////////////////////////////////////////////////////////////
+MapFile::ParseResult MapFile::parseMsSymbolLine(MapFile::MAPSymbol &sym, const char *pLine, size_t lineLen, size_t minLineLen, size_t numOfSegs)
+{
+    // Skip any entrypoint / "static symbols" lines
+    if(strncasecmp(pLine, MSVC_ENTRY_POINT, strlen(MSVC_ENTRY_POINT)) == 0)
+      return MapFile::SKIP_LINE;
+    if (strncasecmp(pLine, MSVC_STATICS, strlen(MSVC_STATICS)) == 0)
+      return MapFile::STATICS_LINE;
+
+    // Get segment number, address, name, by pass spaces at beginning,
+    // between ':' character, between address and name
+    size_t lineCut = lineLen;
+    if (lineCut > MAXNAMELEN + minLineLen)
+        lineCut = MAXNAMELEN + minLineLen;
+    const char * pEnd = pLine + lineCut;
+
+    // Split the line into fields in place; only the first four
+    // and the last one are of interest
+    const size_t maxFields = 4;
+    const char * fieldStart[maxFields];
+    const char * fieldEnd[maxFields];
+    const char * lastStart = NULL;
+    const char * lastEnd = NULL;
+    size_t numFields = 0;
+    const char * p = pLine;
+    while (true)
+    {
+        while ((p < pEnd) && isFieldSeparator(*p))
+            p++;
+        if (p >= pEnd)
+            break;
+        lastStart = p;
+        while ((p < pEnd) && !isFieldSeparator(*p))
+            p++;
+        lastEnd = p;
+        if (numFields < maxFields)
+        {
+            fieldStart[numFields] = lastStart;
+            fieldEnd[numFields] = lastEnd;
+        }
+        numFields++;
+    }
+
+    // Parse line parts
+    if (numFields < 3)
+      return MapFile::FINISHING_LINE; // Failed, we must have parsed to end of value/name symbols table or reached EOF
+
+    // First field is "segment:address"; without ':' both are read from the whole field
+    unsigned long seg, addr;
+    const char * pSep = (const char *)memchr(fieldStart[0], ':', fieldEnd[0] - fieldStart[0]);
+    const char * pAddr = (pSep != NULL) ? pSep + 1 : fieldStart[0];
+    if ((parseHexNumber(fieldStart[0], fieldEnd[0], seg) == NULL) ||
+        (parseHexNumber(pAddr, fieldEnd[0], addr) == NULL))
+    {
+        return MapFile::INVALID_LINE;
+    }
+    sym.seg = seg;
+    sym.addr = addr;
+
+    if (numFields > 3)
+      sym.type = *fieldStart[3];
+    else
+      sym.type = 0;
+
+    size_t nameLen = fieldEnd[1] - fieldStart[1];
+    if (nameLen > MAXNAMELEN)
+        nameLen = MAXNAMELEN;
+    memcpy(sym.name, fieldStart[1], nameLen);
+    sym.name[nameLen] = '\0';
+
+    size_t libnameLen = lastEnd - lastStart;
+    if (libnameLen > sizeof(sym.libname) - 1)
+        libnameLen = sizeof(sym.libname) - 1;
+    memcpy(sym.libname, lastStart, libnameLen);
+    sym.libname[libnameLen] = '\0';
+
+    if ((0 == sym.seg) || (--sym.seg >= numOfSegs) ||
+            ((unsigned long)-1 == sym.addr) || (0 == nameLen) )
+    {
+        return MapFile::INVALID_LINE;
+    }
+    return MapFile::SYMBOL_LINE;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Reads hexadecimal field the way scanf() "%<width>X" does.
+///     Leading separators are skipped; sign and "0x" prefix count into the
+///     width. The value is truncated to 32 bits, like in an unsigned int.
+/// @param  pStart Pointer to start of buffer
+/// @param  pEnd Pointer to end of buffer
+/// @param  width Maximal amount of characters of the field
+/// @param  value Out variable to receive the number
+/// @return Pointer after the field, or NULL if there are no digits
+////////////////////////////////////////////////////////////////////////////////
+static const char * scanHexField(const char * pStart, const char * pEnd, size_t width, unsigned long &value)
+{
+    const char * p = pStart;
+    while ((p < pEnd) && MapFile::isFieldSeparator(*p))
+        p++;
+    const char * pLimit = ((size_t)(pEnd - p) > width) ? p + width : pEnd;
+    bool isNegative = false;
+    if ((p < pLimit) && ((*p == '+') || (*p == '-')))
+    {
+        isNegative = (*p == '-');
+        p++;
+    }
+    bool hasDigits = false;
+    if ((p < pLimit) && (*p == '0'))
+    {
+        // The zero counts as a digit even if no more follow the "0x"
+        hasDigits = true;
+        p++;
+        if ((p < pLimit) && ((*p == 'x') || (*p == 'X')))
+            p++;
+    }
+    unsigned long long result = 0;
+    for (; p < pLimit; p++)
+    {
+        unsigned char c = (unsigned char)*p;
+        unsigned digit;
+        if (c >= '0' && c <= '9')
+            digit = c - '0';
+        else if (c >= 'a' && c <= 'f')
+            digit = c - 'a' + 10;
+        else if (c >= 'A' && c <= 'F')
+            digit = c - 'A' + 10;
+        else
+            break;
+        result = (result << 4) | digit;
+        hasDigits = true;
+    }
+    if (!hasDigits)
+        return NULL;
+    if (isNegative)
+        result = 0 - result;
+    value = (unsigned long)(result & 0xFFFFFFFF);
+    return p;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Reads symbol name the way scanf() "%[^\t\n;]" does.
+/// @param  pStart Pointer to start of the name
+/// @param  pEnd Pointer to end of buffer
+/// @param  name Target buffer of MAXNAMELEN+1 characters
+/// @return False if the name is empty
+////////////////////////////////////////////////////////////////////////////////
+static bool scanSymbolName(const char * pStart, const char * pEnd, char * name)
+{
+    const char * p = pStart;
+    while ((p < pEnd) && (*p != '\t') && (*p != '\n') && (*p != ';'))
+        p++;
+    size_t nameLen = (size_t)(p - pStart);
+    if (nameLen == 0)
+        return false;
+    if (nameLen > MAXNAMELEN)
+        nameLen = MAXNAMELEN;
+    memcpy(name, pStart, nameLen);
+    name[nameLen] = '\0';
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Copies rest of a comment line into symbol name.
+////////////////////////////////////////////////////////////////////////////////
+static void copyCommentName(const char * pStart, const char * pEnd, char * name)
+{
+    size_t nameLen = (size_t)(pEnd - pStart);
+    if (nameLen > MAXNAMELEN - 1)
+        nameLen = MAXNAMELEN - 1;
+    memcpy(name, pStart, nameLen);
+    name[nameLen] = '\0';
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Checks if a line starts with given string, ignoring case.
+////////////////////////////////////////////////////////////////////////////////
+static inline bool hasPrefix(const char * pLine, size_t lineLen, const char * prefix)
+{
+    const size_t prefixLen = strlen(prefix);
+    return (lineLen >= prefixLen) && (strncasecmp(pLine, prefix, prefixLen) == 0);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Reads one entry of Watcom-like MAP file.
+///     Entries are "seg:addr name", possibly with a mark character after addr.
+/// @param sym Target  buffer for symbol data.
+/// @param  pLine Pointer to start of buffer
+/// @param  lineLen Length of the current line
+/// @param  minLineLen Minimal accepted length of line
+/// @param numOfSegs Number of segments in IDA, used to verify segment number range
+/// @return Result of the parsing
+/// @author TL
+/// @date 2011.09.10
+////////////////////////////////////////////////////////////////////////////////
+MapFile::ParseResult MapFile::parseWatcomSymbolLine(MapFile::MAPSymbol &sym, const char *pLine, size_t lineLen, size_t minLineLen, size_t numOfSegs)
+{
+    // Get segment number, address, name, by pass spaces at beginning,
+    // between ':' character, between address and name
+    size_t lineCut = lineLen;
+    if (lineCut > MAXNAMELEN + minLineLen)
+        lineCut = MAXNAMELEN + minLineLen;
+    const char * pEnd = pLine + lineCut;
+    if ((lineCut > 0) && (pLine[0] == ';'))
+    {
+        copyCommentName(pLine + 1, pEnd, sym.name);
+        return MapFile::COMMENT_LINE;
+    }
+    if (hasPrefix(pLine, lineCut, WATCOM_MEMMAP_SKIP))
+        return MapFile::SKIP_LINE;
+    if (hasPrefix(pLine, lineCut, WATCOM_MEMMAP_COMMENT))
+    {
+        copyCommentName(pLine + std::strlen(WATCOM_MEMMAP_COMMENT), pEnd, sym.name);
+        return MapFile::COMMENT_LINE;
+    }
+
+    // Same as sscanf(" %04X : %08X%*c %[^\t\n;]"), any mismatch ends the table
+    const char * p = scanHexField(pLine, pEnd, 4, sym.seg);
+    if (p == NULL)
+        return MapFile::FINISHING_LINE;
+    while ((p < pEnd) && isFieldSeparator(*p))
+        p++;
+    if ((p >= pEnd) || (*p != ':'))
+        return MapFile::FINISHING_LINE;
+    p = scanHexField(p + 1, pEnd, 8, sym.addr);
+    // One character after address is skipped, whatever it is
+    if ((p == NULL) || (p >= pEnd))
+        return MapFile::FINISHING_LINE;
+    p++;
+    while ((p < pEnd) && isFieldSeparator(*p))
+        p++;
+    if (!scanSymbolName(p, pEnd, sym.name))
+        return MapFile::FINISHING_LINE;
+
+    if ((0 == sym.seg) || (--sym.seg >= numOfSegs) || (0xFFFFFFFF == sym.addr))
+    {
+        return MapFile::INVALID_LINE;
+    }
+    return MapFile::SYMBOL_LINE;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Reads one entry of GCC-like MAP file.
+///     Entries are "0xaddr name", with linear address converted by the host.
+/// @param sym Target  buffer for symbol data.
+/// @param  pLine Pointer to start of buffer
+/// @param  lineLen Length of the current line
+/// @param  minLineLen Minimal accepted length of line
+/// @param numOfSegs Number of segments in IDA, used to verify segment number range
+/// @return Result of the parsing
+/// @author TL
+/// @date 2012.07.18
+////////////////////////////////////////////////////////////////////////////////
+MapFile::ParseResult MapFile::parseGccSymbolLine(MapFile::MAPSymbol &sym, const char *pLine, size_t lineLen, size_t minLineLen, size_t numOfSegs)
+{
+    // Get segment number, address, name, by pass spaces at beginning,
+    // between ':' character, between address and name
+    size_t lineCut = lineLen;
+    if (lineCut > MAXNAMELEN + minLineLen)
+        lineCut = MAXNAMELEN + minLineLen;
+    const char * pEnd = pLine + lineCut;
+    if ((lineCut > 0) && (pLine[0] == ';'))
+    {
+        copyCommentName(pLine + 1, pEnd, sym.name);
+        return MapFile::COMMENT_LINE;
+    }
+    if (hasPrefix(pLine, lineCut, GCC_MEMMAP_SKIP1) || hasPrefix(pLine, lineCut, GCC_MEMMAP_SKIP2))
+        return MapFile::SKIP_LINE;
+    if (hasPrefix(pLine, lineCut, GCC_MEMMAP_SKIP3) || hasPrefix(pLine, lineCut, GCC_MEMMAP_SKIP4))
+        return MapFile::SKIP_LINE;
+    if (hasPrefix(pLine, lineCut, GCC_MEMMAP_LOAD))
+    {
+        copyCommentName(pLine, pEnd, sym.name);
+        return MapFile::COMMENT_LINE;
+    }
+
+    // Same as sscanf(" 0x%08X%*c %[^\t\n;]"), any mismatch ends the table
+    const char * p = pLine;
+    while ((p < pEnd) && isFieldSeparator(*p))
+        p++;
+    if ((pEnd - p < 2) || (p[0] != '0') || (p[1] != 'x'))
+        return MapFile::FINISHING_LINE;
+    unsigned long linear_addr;
+    p = scanHexField(p + 2, pEnd, 8, linear_addr);
+    // One character after address is skipped, whatever it is
+    if ((p == NULL) || (p >= pEnd))
+        return MapFile::FINISHING_LINE;
+    p++;
+    while ((p < pEnd) && isFieldSeparator(*p))
+        p++;
+    if (!scanSymbolName(p, pEnd, sym.name))
+        return MapFile::FINISHING_LINE;
+
+    linearAddressToSymbolAddr(sym, linear_addr);
+    if ((sym.seg >= numOfSegs) || ((unsigned long)-1 == sym.addr))
+    {
+        return MapFile::INVALID_LINE;
+    }
+    return MapFile::SYMBOL_LINE;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Gets ID of a string, adding it to the pool if not there yet.
+/// @param  name Pointer to the string, does not need to be NUL-terminated
+/// @param  len Length of the string
+/// @return ID of the string
+////////////////////////////////////////////////////////////////////////////////
+unsigned MapFile::NamePool::intern(const char * name, size_t len)
+{
+    auto found = ids.find(std::string_view(name, len));
+    if (found != ids.end())
+        return found->second;
+    const unsigned id = (unsigned)names.size();
+    names.emplace_back(name, len);
+    ids.emplace(std::string_view(names.back()), id);
+    return id;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Gets ID of a string without adding it.
+/// @return ID of the string, or NO_NAME if it is not in the pool
+////////////////////////////////////////////////////////////////////////////////
+unsigned MapFile::NamePool::find(const char * name, size_t len) const
+{
+    auto found = ids.find(std::string_view(name, len));
+    return (found != ids.end()) ? found->second : NO_NAME;
+}
+
+void MapFile::NamePool::clear()
+{
+    ids.clear();
+    names.clear();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Adds symbol at end of the table.
+////////////////////////////////////////////////////////////////////////////////
+void MapFile::SymbolTable::append(unsigned long seg, unsigned long addr, char type,
+    const char * name, size_t nameLen, const char * libname, size_t libnameLen)
+{
+    segs.push_back(seg);
+    addrs.push_back(addr);
+    types.push_back(type);
+    nameOffsets.push_back(strings.size());
+    strings.insert(strings.end(), name, name + nameLen);
+    strings.push_back('\0');
+    // Symbols of one object are usually listed one after another
+    if (!objectIds.empty())
+    {
+        const char * prevLibname = objects.getName(objectIds.back());
+        if ((strncmp(prevLibname, libname, libnameLen) == 0) && (prevLibname[libnameLen] == '\0'))
+        {
+            objectIds.push_back(objectIds.back());
+            return;
+        }
+    }
+    objectIds.push_back(objects.intern(libname, libnameLen));
+}
+
+void MapFile::SymbolTable::append(const MapFile::MAPSymbol &sym)
+{
+    append(sym.seg, sym.addr, sym.type, sym.name, strlen(sym.name), sym.libname, strlen(sym.libname));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Adds all symbols of another table at end of this one.
+///     Object IDs of the other table are translated to IDs of this one.
+////////////////////////////////////////////////////////////////////////////////
+void MapFile::SymbolTable::append(const MapFile::SymbolTable &other)
+{
+    const size_t base = strings.size();
+    segs.insert(segs.end(), other.segs.begin(), other.segs.end());
+    addrs.insert(addrs.end(), other.addrs.begin(), other.addrs.end());
+    types.insert(types.end(), other.types.begin(), other.types.end());
+    strings.insert(strings.end(), other.strings.begin(), other.strings.end());
+    nameOffsets.reserve(nameOffsets.size() + other.nameOffsets.size());
+    for (size_t offset : other.nameOffsets)
+        nameOffsets.push_back(base + offset);
+
+    std::vector<unsigned> idMap(other.objects.size());
+    for (unsigned id = 0; id < idMap.size(); id++)
+    {
+        const char * objectName = other.objects.getName(id);
+        idMap[id] = objects.intern(objectName, strlen(objectName));
+    }
+    objectIds.reserve(objectIds.size() + other.objectIds.size());
+    for (unsigned id : other.objectIds)
+        objectIds.push_back(idMap[id]);
+}
+
+void MapFile::SymbolTable::reserve(size_t numSymbols)
+{
+    segs.reserve(numSymbols);
+    addrs.reserve(numSymbols);
+    types.reserve(numSymbols);
+    nameOffsets.reserve(numSymbols);
+    objectIds.reserve(numSymbols);
+}
+
+void MapFile::SymbolTable::clear()
+{
+    segs.clear();
+    addrs.clear();
+    types.clear();
+    nameOffsets.clear();
+    objectIds.clear();
+    strings.clear();
+    objects.clear();
+}
+
+/// @name Limits for splitting a symbol table between threads.
+/// @{
+/// Sections shorter than this are not worth starting threads for
+const size_t PARALLEL_MIN_SECTION_LINES = 16384;
+/// Smallest amount of lines handed to a worker at once
+const size_t PARALLEL_MIN_CHUNK_LINES = 4096;
+/// @}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Non blank lines of a memory buffer, located by findAllEOLs().
+////////////////////////////////////////////////////////////////////////////////
+class LineIndex {
+public:
+    LineIndex(const char * pStart, const char * pEnd) : pStart(pStart)
+    {
+        MapFile::findAllEOLs(pStart, pEnd, eolOffsets);
+        // The last line ends at the end of buffer
+        eolOffsets.push_back((size_t)(pEnd - pStart));
+    }
+
+    size_t count() const
+    {
+        return eolOffsets.size();
+    }
+
+    /// Gets line with given index, with leading spaces skipped
+    size_t line(size_t idx, const char * &pLine) const
+    {
+        const char * pEOL = pStart + eolOffsets[idx];
+        pLine = MapFile::skipSpaces((idx > 0) ? pStart + eolOffsets[idx - 1] : pStart, pEOL);
+        return (size_t)(pEOL - pLine);
+    }
+
+private:
+    const char * pStart;
+    std::vector<size_t> eolOffsets;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Symbols parsed by one worker from a part of a symbol table.
+////////////////////////////////////////////////////////////////////////////////
+struct ParsedChunk {
+    size_t firstLine = 0;
+    size_t endLine = 0;
+    MapFile::SymbolTable symbols;
+    unsigned long invalidSyms = 0;
+    /// Line at which the parser reported end of table, if any
+    size_t finishLine = (size_t)-1;
+    std::exception_ptr error;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Checks if parseMsSymbolLine() would report end of table for a line.
+///     Only counts the fields, so it is much faster than parsing the line.
+////////////////////////////////////////////////////////////////////////////////
+static bool isMsTableEnd(const char *pLine, size_t lineLen, size_t minLineLen)
+{
+    if ((strncasecmp(pLine, MapFile::MSVC_ENTRY_POINT, strlen(MapFile::MSVC_ENTRY_POINT)) == 0) ||
+        (strncasecmp(pLine, MapFile::MSVC_STATICS, strlen(MapFile::MSVC_STATICS)) == 0))
+    {
+        return false;
+    }
+    if (lineLen > MAXNAMELEN + minLineLen)
+        lineLen = MAXNAMELEN + minLineLen;
+    const char * p = pLine;
+    const char * pEnd = pLine + lineLen;
+    size_t numFields = 0;
+    while (numFields < 3)
+    {
+        while ((p < pEnd) && MapFile::isFieldSeparator(*p))
+            p++;
+        if (p >= pEnd)
+            break;
+        while ((p < pEnd) && !MapFile::isFieldSeparator(*p))
+            p++;
+        numFields++;
+    }
+    return (numFields < 3);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Reads lines of a LineIndex in order, like MAPStream::nextLine() does.
+////////////////////////////////////////////////////////////////////////////////
+class LineCursor {
+public:
+    explicit LineCursor(const LineIndex &lines) : lines(lines)
+    {
+    }
+
+    bool nextLine(const char * &pLine, size_t &lineLen)
+    {
+        if (idx >= lines.count())
+            return false;
+        lineLen = lines.line(idx++, pLine);
+        return true;
+    }
+
+    const LineIndex &lines;
+    /// Index of the next line to read
+    size_t idx = 0;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Parses one line of a symbol table with the parser of given format.
+////////////////////////////////////////////////////////////////////////////////
+template <class Format>
+static inline MapFile::ParseResult parseFormatLine(MapFile::MAPSymbol &sym,
+    const char *pLine, size_t lineLen, size_t minLineLen, size_t numOfSegs)
+{
+    sym.seg = 16;
+    sym.addr = -1;
+    sym.name[0] = '\0';
+    return Format::parseLine(sym, pLine, lineLen, minLineLen, numOfSegs);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Symbol table format of a section type.
+///     Every format gives the parser of its lines and a few properties. Loops
+///     over lines are instantiated for each format, so the format is chosen
+///     once per table, not once per line.
+///     To support another format, add its SectionType, its start and end lines
+///     to SECTION_MARKERS, a specialization here and an entry of MapFormats.
+////////////////////////////////////////////////////////////////////////////////
+template <MapFile::SectionType Type>
+struct MapFormat;
+
+/// Tables of "seg:addr name rva+base lib:object" lines, of MSVC and Borland
+struct MsMapFormat {
+    /// Large tables may be split between threads
+    static constexpr bool PARALLEL = true;
+    /// Symbols get segments of the host, see linearAddressToSymbolAddr()
+    static constexpr bool HOST_SEGMENTS = false;
+    /// Public symbols may be followed by "Static symbols" table
+    static constexpr bool HAS_STATICS = true;
+
+    static MapFile::ParseResult parseLine(MapFile::MAPSymbol &sym, const char *pLine, size_t lineLen, size_t minLineLen, size_t numOfSegs)
+    {
+        return MapFile::parseMsSymbolLine(sym, pLine, lineLen, minLineLen, numOfSegs);
+    }
+
+    /// Checks if parseLine() would report end of table for a line
+    static bool isTableEnd(MapFile::MAPSymbol &, const char *pLine, size_t lineLen, size_t minLineLen)
+    {
+        return isMsTableEnd(pLine, lineLen, minLineLen);
+    }
+};
+
+template <>
+struct MapFormat<MapFile::MSVC_MAP> : MsMapFormat {
+    static constexpr MapFile::SectionType TYPE = MapFile::MSVC_MAP;
+};
+
+template <>
+struct MapFormat<MapFile::BCCL_NAM_MAP> : MsMapFormat {
+    static constexpr MapFile::SectionType TYPE = MapFile::BCCL_NAM_MAP;
+};
+
+template <>
+struct MapFormat<MapFile::BCCL_VAL_MAP> : MsMapFormat {
+    static constexpr MapFile::SectionType TYPE = MapFile::BCCL_VAL_MAP;
+};
+
+/// Base of formats which are only read with their line parser
+template <class Format>
+struct SerialMapFormat {
+    static constexpr bool PARALLEL = false;
+    static constexpr bool HOST_SEGMENTS = false;
+    static constexpr bool HAS_STATICS = false;
+
+    static bool isTableEnd(MapFile::MAPSymbol &sym, const char *pLine, size_t lineLen, size_t minLineLen)
+    {
+        return (parseFormatLine<Format>(sym, pLine, lineLen, minLineLen, 0) == MapFile::FINISHING_LINE);
+    }
+};
+
+template <>
+struct MapFormat<MapFile::WATCOM_MAP> : SerialMapFormat<MapFormat<MapFile::WATCOM_MAP>> {
+    static constexpr MapFile::SectionType TYPE = MapFile::WATCOM_MAP;
+
+    static MapFile::ParseResult parseLine(MapFile::MAPSymbol &sym, const char *pLine, size_t lineLen, size_t minLineLen, size_t numOfSegs)
+    {
+        return MapFile::parseWatcomSymbolLine(sym, pLine, lineLen, minLineLen, numOfSegs);
+    }
+};
+
+template <>
+struct MapFormat<MapFile::GCC_MAP> : SerialMapFormat<MapFormat<MapFile::GCC_MAP>> {
+    static constexpr MapFile::SectionType TYPE = MapFile::GCC_MAP;
+    static constexpr bool HOST_SEGMENTS = true;
+
+    static MapFile::ParseResult parseLine(MapFile::MAPSymbol &sym, const char *pLine, size_t lineLen, size_t minLineLen, size_t numOfSegs)
+    {
+        return MapFile::parseGccSymbolLine(sym, pLine, lineLen, minLineLen, numOfSegs);
+    }
+};
+
+template <MapFile::SectionType... Types>
+struct MapFormatList {
+};
+
+/// All supported symbol table formats
+typedef MapFormatList<MapFile::MSVC_MAP, MapFile::BCCL_NAM_MAP, MapFile::BCCL_VAL_MAP,
+    MapFile::WATCOM_MAP, MapFile::GCC_MAP> MapFormats;
+
+template <class Visitor>
+static bool dispatchFormatOf(MapFile::SectionType, const Visitor &, MapFormatList<>)
+{
+    return false;
+}
+
+template <class Visitor, MapFile::SectionType Type, MapFile::SectionType... Types>
+static bool dispatchFormatOf(MapFile::SectionType type, const Visitor &visitor, MapFormatList<Type, Types...>)
+{
+    if (type == Type)
+    {
+        visitor(MapFormat<Type>());
+        return true;
+    }
+    return dispatchFormatOf(type, visitor, MapFormatList<Types...>());
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Calls visitor with the MapFormat of given section type.
+/// @return False if no format is registered for the type
+////////////////////////////////////////////////////////////////////////////////
+template <class Visitor>
+static bool dispatchFormat(MapFile::SectionType type, const Visitor &visitor)
+{
+    return dispatchFormatOf(type, visitor, MapFormats());
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Receiver of parsed symbols which appends them to a SymbolTable.
+///     Receivers of parsed lines all have the same methods; parsing loops are
+///     instantiated for each of them.
+////////////////////////////////////////////////////////////////////////////////
+class TableSink {
+public:
+    explicit TableSink(MapFile::SymbolTable &table) : table(table)
+    {
+    }
+
+    void sectionStart(MapFile::SectionType)
+    {
+    }
+
+    void sectionEnd(MapFile::SectionType)
+    {
+    }
+
+    void symbol(const MapFile::MAPSymbol &sym)
+    {
+        table.append(sym);
+    }
+
+    /// Receives symbols of a chunk parsed by a worker thread
+    void symbols(const MapFile::SymbolTable &chunk)
+    {
+        table.append(chunk);
+    }
+
+    void comment(const MapFile::MAPSymbol &)
+    {
+    }
+
+    /// Gets amount of symbols in the table, for ParseStats
+    size_t count() const
+    {
+        return table.size();
+    }
+
+private:
+    MapFile::SymbolTable &table;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Receiver of parsed symbols which passes them to ParserEvents.
+///     Symbols are collected into batches, so events are called once per
+///     PARSER_BATCH_SIZE symbols, not once per line.
+////////////////////////////////////////////////////////////////////////////////
+class EventSink {
+public:
+    explicit EventSink(MapFile::ParserEvents &events) : events(events)
+    {
+        batch.reserve(PARSER_BATCH_SIZE);
+    }
+
+    void sectionStart(MapFile::SectionType type)
+    {
+        events.sectionStart(type);
+    }
+
+    void sectionEnd(MapFile::SectionType type)
+    {
+        flush();
+        events.sectionEnd(type);
+    }
+
+    void symbol(const MapFile::MAPSymbol &sym)
+    {
+        batch.append(sym);
+        if (batch.size() >= PARSER_BATCH_SIZE)
+            flush();
+    }
+
+    void symbols(const MapFile::SymbolTable &chunk)
+    {
+        flush();
+        if (chunk.size() == 0)
+            return;
+        events.symbols(chunk);
+        delivered += chunk.size();
+    }
+
+    void comment(const MapFile::MAPSymbol &sym)
+    {
+        flush();
+        events.comment(sym.name);
+    }
+
+    size_t count() const
+    {
+        return delivered + batch.size();
+    }
+
+    /// Passes collected symbols to the events
+    void flush()
+    {
+        if (batch.size() == 0)
+            return;
+        events.symbols(batch);
+        delivered += batch.size();
+        batch.clear();
+    }
+
+private:
+    MapFile::ParserEvents &events;
+    MapFile::SymbolTable batch;
+    size_t delivered = 0;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Parses lines of one chunk, stopping where the table is finished.
+////////////////////////////////////////////////////////////////////////////////
+template <class Format>
+static void parseChunk(const LineIndex &lines, size_t minLineLen, size_t numOfSegs, ParsedChunk &chunk)
+{
+    try
+    {
+        MapFile::MAPSymbol sym;
+        for (size_t idx = chunk.firstLine; idx < chunk.endLine; idx++)
+        {
+            const char * pLine;
+            size_t lineLen = lines.line(idx, pLine);
+            if (lineLen < minLineLen)
+                continue;
+            MapFile::ParseResult parsed = parseFormatLine<Format>(sym, pLine, lineLen, minLineLen, numOfSegs);
+            if (parsed == MapFile::SYMBOL_LINE)
+            {
+                chunk.symbols.append(sym);
+            } else
+            if (parsed == MapFile::INVALID_LINE)
+            {
+                chunk.invalidSyms++;
+            } else
+            if (parsed == MapFile::FINISHING_LINE)
+            {
+                chunk.finishLine = idx;
+                return;
+            }
+        }
+    }
+    catch (...)
+    {
+        chunk.error = std::current_exception();
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Parses a symbol table section split into line-aligned chunks.
+///     Chunks are merged in file order; if a chunk ends the table early,
+///     the following chunks are dropped and serial parsing resumes there.
+/// @param finished Set if the parser reported end of table
+/// @return Index of line to continue serial parsing from
+////////////////////////////////////////////////////////////////////////////////
+template <class Format, class Sink>
+static size_t parseSectionParallel(const LineIndex &lines, size_t firstLine, bool &finished,
+    size_t minLineLen, size_t numOfSegs, unsigned numThreads,
+    Sink &sink, MapFile::ParseStats &stats)
+{
+    // Find where the section is closed by its terminator line
+    size_t endLine = firstLine;
+    for (; endLine < lines.count(); endLine++)
+    {
+        const char * pLine;
+        size_t lineLen = lines.line(endLine, pLine);
+        if ((lineLen >= minLineLen) && (MapFile::recognizeSectionEnd(Format::TYPE, pLine, lineLen) != Format::TYPE))
+            break;
+    }
+    const size_t numLines = endLine - firstLine;
+    if (numLines < PARALLEL_MIN_SECTION_LINES)
+        return firstLine;
+
+    size_t numChunks = 4 * (size_t)numThreads;
+    if (numChunks > numLines / PARALLEL_MIN_CHUNK_LINES)
+        numChunks = numLines / PARALLEL_MIN_CHUNK_LINES;
+    std::vector<ParsedChunk> chunks(numChunks);
+    for (size_t i = 0; i < numChunks; i++)
+    {
+        chunks[i].firstLine = firstLine + numLines * i / numChunks;
+        chunks[i].endLine = firstLine + numLines * (i + 1) / numChunks;
+    }
+
+    std::atomic<size_t> nextChunk(0);
+    auto worker = [&]()
+    {
+        for (size_t i = nextChunk++; i < numChunks; i = nextChunk++)
+            parseChunk<Format>(lines, minLineLen, numOfSegs, chunks[i]);
+    };
+    std::vector<std::thread> threads;
+    for (unsigned t = 1; t < numThreads; t++)
+        threads.emplace_back(worker);
+    worker();
+    for (std::thread &thread : threads)
+        thread.join();
+
+    for (ParsedChunk &chunk : chunks)
+    {
+        if (chunk.error)
+            std::rethrow_exception(chunk.error);
+        sink.symbols(chunk.symbols);
+        stats.invalidSyms += chunk.invalidSyms;
+        if (chunk.finishLine != (size_t)-1)
+        {
+            // we have parsed to end of value/name symbols table
+            finished = true;
+            return chunk.finishLine + 1;
+        }
+    }
+    return endLine;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Parses a symbol table from memory with worker threads, if it is large.
+/// @return True if the whole table is parsed
+////////////////////////////////////////////////////////////////////////////////
+template <class Format, class Sink>
+static bool parseTableParallel(LineCursor &cursor, size_t minLineLen, size_t numOfSegs, unsigned numThreads,
+    Sink &sink, MapFile::ParseStats &stats)
+{
+    bool finished = false;
+    cursor.idx = parseSectionParallel<Format>(cursor.lines, cursor.idx, finished,
+        minLineLen, numOfSegs, numThreads, sink, stats);
+    return finished;
+}
+
+/// Streams are read line by line, so their tables are never split
+template <class Format, class Sink>
+static bool parseTableParallel(MapFile::MAPStream &, size_t, size_t, unsigned,
+    Sink &, MapFile::ParseStats &)
+{
+    return false;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Parses lines of a symbol table which header was just read.
+///     Reading stops after the line which ends the table, or at end of input.
+/// @param source Lines of the MAP file, LineCursor or MAPStream
+/// @param sym Buffer for parsed lines; kept between tables, like the parsers expect
+/// @param sink Receiver of parsed symbols, TableSink or EventSink
+////////////////////////////////////////////////////////////////////////////////
+template <class Format, class LineSource, class Sink>
+static void parseTable(LineSource &source, MapFile::MAPSymbol &sym, size_t minLineLen, size_t numOfSegs,
+    unsigned numThreads, Sink &sink, MapFile::ParseStats &stats)
+{
+    if (Format::HOST_SEGMENTS)
+        stats.usesHostSegments = true;
+    if (Format::PARALLEL && (numThreads > 1) &&
+        parseTableParallel<Format>(source, minLineLen, numOfSegs, numThreads, sink, stats))
+    {
+        return;
+    }
+
+    const char * pLine;
+    size_t lineLen;
+    while (source.nextLine(pLine, lineLen))
+    {
+        if (lineLen < minLineLen)
+            continue;
+        if (MapFile::recognizeSectionEnd(Format::TYPE, pLine, lineLen) != Format::TYPE)
+            return;
+        MapFile::ParseResult parsed = parseFormatLine<Format>(sym, pLine, lineLen, minLineLen, numOfSegs);
+        if (parsed == MapFile::SYMBOL_LINE)
+        {
+            sink.symbol(sym);
+        } else
+        if (parsed == MapFile::INVALID_LINE)
+        {
+            stats.invalidSyms++;
+        } else
+        if (parsed == MapFile::COMMENT_LINE)
+        {
+            sink.comment(sym);
+        } else
+        if (parsed == MapFile::FINISHING_LINE)
+        {
+            // we have parsed to end of value/name symbols table or reached EOF
+            return;
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Reads lines up to the header of next symbol table.
+/// @return Format of the table, or NO_SECTION at end of input
+////////////////////////////////////////////////////////////////////////////////
+template <class LineSource>
+static MapFile::SectionType findTableStart(LineSource &source, size_t minLineLen)
+{
+    const char * pLine;
+    size_t lineLen;
+    while (source.nextLine(pLine, lineLen))
+    {
+        if (lineLen < minLineLen)
+            continue;
+        const MapFile::SectionType sectnHdr = MapFile::recognizeSectionStart(pLine, lineLen);
+        if (sectnHdr != MapFile::NO_SECTION)
+            return sectnHdr;
+    }
+    return MapFile::NO_SECTION;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Reads all symbol tables from lines of a MAP file.
+///     Used for files in memory and for streams alike; only headers of tables
+///     are looked for here, the tables are read by parseTable().
+/// @param source Lines of the MAP file, LineCursor or MAPStream
+/// @param sectnHdr Format of the table which header was just read from source,
+///     or NO_SECTION to start with looking for a header
+/// @param sink Receiver of parsed symbols, TableSink or EventSink
+////////////////////////////////////////////////////////////////////////////////
+template <class LineSource, class Sink>
+static MapFile::ParseStats parseTables(LineSource &source, MapFile::SectionType sectnHdr, size_t minLineLen,
+    size_t numOfSegs, unsigned numThreads, Sink &sink)
+{
+    MapFile::ParseStats stats;
+    MapFile::MAPSymbol sym;
+    if (sectnHdr == MapFile::NO_SECTION)
+        sectnHdr = findTableStart(source, minLineLen);
+    while (sectnHdr != MapFile::NO_SECTION)
+    {
+        stats.sections++;
+        sink.sectionStart(sectnHdr);
+        dispatchFormat(sectnHdr, [&](auto format)
+        {
+            parseTable<decltype(format)>(source, sym, minLineLen, numOfSegs, numThreads, sink, stats);
+        });
+        sink.sectionEnd(sectnHdr);
+        sectnHdr = findTableStart(source, minLineLen);
+    }
+    stats.symbols = (unsigned long)sink.count();
+    return stats;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Reads all symbol tables of a MAP file loaded into memory.
+///     Lines before the first table found by sniffDialect() are skipped.
+////////////////////////////////////////////////////////////////////////////////
+template <class Sink>
+static MapFile::ParseStats parseBuffer(const char * pStart, const char * pEnd, const MapFile::MAPDialect &dialect,
+    size_t minLineLen, size_t numOfSegs, unsigned numThreads, Sink &sink)
+{
+    if (numThreads == 0)
+        numThreads = std::thread::hardware_concurrency();
+    if (numThreads == 0)
+        numThreads = 1;
+
+    MapFile::SectionType sectnHdr = dialect.type;
+    size_t bodyOffset = dialect.bodyOffset;
+    if (bodyOffset > (size_t)(pEnd - pStart))
+    {
+        sectnHdr = MapFile::NO_SECTION;
+        bodyOffset = 0;
+    }
+    const LineIndex lines(pStart + bodyOffset, pEnd);
+    LineCursor cursor(lines);
+    return parseTables(cursor, sectnHdr, minLineLen, numOfSegs, numThreads, sink);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Finds format of a MAP file from the first SNIFF_SIZE bytes.
+///     Lines are checked in order, up to the header of first symbol table;
+///     the rest of the file is not touched, so many files can be sniffed
+///     at low cost.
+/// @param  pStart Pointer to start of buffer
+/// @param  pEnd Pointer to end of buffer
+/// @param  minLineLen Minimal accepted length of line
+/// @param dialect Receives format and position of the first symbol table
+/// @return True if a symbol table header was found
+////////////////////////////////////////////////////////////////////////////////
+bool MapFile::sniffDialect(const char * pStart, const char * pEnd, size_t minLineLen, MapFile::MAPDialect &dialect)
+{
+    dialect = MapFile::MAPDialect();
+    const char * pWindowEnd = ((size_t)(pEnd - pStart) > SNIFF_SIZE) ? pStart + SNIFF_SIZE : pEnd;
+    for (const char * pLineStart = pStart; pLineStart < pWindowEnd; )
+    {
+        const char * pEOL = MapFile::findEOL(pLineStart, pWindowEnd);
+        // Line cut by end of the window is left for parsing
+        if ((pEOL == pWindowEnd) && (pWindowEnd != pEnd))
+            break;
+        const char * pLine = MapFile::skipSpaces(pLineStart, pEOL);
+        const size_t lineLen = (size_t)(pEOL - pLine);
+        if (lineLen >= minLineLen)
+        {
+            dialect.type = MapFile::recognizeSectionStart(pLine, lineLen);
+            if (dialect.type != MapFile::NO_SECTION)
+            {
+                dialect.headerOffset = (size_t)(pLine - pStart);
+                dialect.bodyOffset = (size_t)(((pEOL < pEnd) ? pEOL + 1 : pEnd) - pStart);
+                return true;
+            }
+        }
+        pLineStart = pEOL + 1;
+    }
+    return false;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Finds format of a MAP file, reading only its first SNIFF_SIZE bytes.
+///     Compressed files are handled like MAPStream does; offsets are then
+///     within the decompressed data.
+/// @param fileName Path of the file
+/// @param  minLineLen Minimal accepted length of line
+/// @param dialect Receives format and position of the first symbol table;
+///     type is NO_SECTION if none is within SNIFF_SIZE bytes
+/// @return enum value of OPEN_FILE_ERROR
+////////////////////////////////////////////////////////////////////////////////
+MapFile::MAPResult MapFile::sniffDialect(const char * fileName, size_t minLineLen, MapFile::MAPDialect &dialect)
+{
+    dialect = MapFile::MAPDialect();
+    MapFile::MAPStream stream(SNIFF_SIZE);
+    const MapFile::MAPResult eRet = stream.open(fileName);
+    if (eRet != MapFile::OPEN_NO_ERROR)
+        return eRet;
+    size_t size;
+    const char * pData = stream.getBuffered(size);
+    MapFile::sniffDialect(pData, pData + size, minLineLen, dialect);
+    return MapFile::OPEN_NO_ERROR;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Reads all symbol tables of a MAP file loaded into memory.
+///     With more than one thread, large MSVC/Borland tables are split between
+///     worker threads; the result is the same as for a single thread.
+/// @param  pStart Pointer to start of buffer
+/// @param  pEnd Pointer to end of buffer
+/// @param  minLineLen Minimal accepted length of line
+/// @param numOfSegs Number of segments, used to verify segment number range
+/// @param symbols Receives parsed symbols, appended in file order
+/// @param numThreads Amount of threads to use, 0 for one per CPU core
+/// @return Counters of parsed sections and symbols
+////////////////////////////////////////////////////////////////////////////////
+MapFile::ParseStats MapFile::parseSymbols(const char * pStart, const char * pEnd, size_t minLineLen, size_t numOfSegs, MapFile::SymbolTable &symbols, unsigned numThreads)
+{
+    MapFile::MAPDialect dialect;
+    MapFile::sniffDialect(pStart, pEnd, minLineLen, dialect);
+    return MapFile::parseSymbols(pStart, pEnd, dialect, minLineLen, numOfSegs, symbols, numThreads);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Reads all symbol tables of a MAP file with known format.
+///     Lines before the first symbol table are skipped, and the table is read
+///     by the parser of its format right away.
+/// @param  pStart Pointer to start of buffer
+/// @param  pEnd Pointer to end of buffer
+/// @param dialect Format of the file, from sniffDialect() on the same buffer;
+///     with NO_SECTION the whole file is searched for symbol tables
+/// @param  minLineLen Minimal accepted length of line
+/// @param numOfSegs Number of segments, used to verify segment number range
+/// @param symbols Receives parsed symbols, appended in file order
+/// @param numThreads Amount of threads to use, 0 for one per CPU core
+/// @return Counters of parsed sections and symbols
+////////////////////////////////////////////////////////////////////////////////
+MapFile::ParseStats MapFile::parseSymbols(const char * pStart, const char * pEnd, const MapFile::MAPDialect &dialect,
+    size_t minLineLen, size_t numOfSegs, MapFile::SymbolTable &symbols, unsigned numThreads)
+{
+    TableSink sink(symbols);
+    return parseBuffer(pStart, pEnd, dialect, minLineLen, numOfSegs, numThreads, sink);
+}
+
+/// Amount of bytes searched for EOLs at once by scanSections()
+const size_t SCAN_BLOCK_SIZE = 4 * 1024 * 1024;
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Checks if a line starts a section which holds no symbols.
+/// @return True if the line is a header of such section
+////////////////////////////////////////////////////////////////////////////////
+static bool recognizeOtherSection(const char *pLine, size_t lineLen, MapFile::SectionKind &kind)
+{
+    if ((lineLen >= strlen(MapFile::MSVC_LINE_NUMBER)) &&
+        (strncmp(pLine, MapFile::MSVC_LINE_NUMBER, strlen(MapFile::MSVC_LINE_NUMBER)) == 0))
+    {
+        kind = MapFile::LINE_NUMBERS_SECTION;
+        return true;
+    }
+    if ((lineLen >= strlen(MapFile::MSVC_FIXUP)) &&
+        (strncmp(pLine, MapFile::MSVC_FIXUP, strlen(MapFile::MSVC_FIXUP)) == 0))
+    {
+        kind = MapFile::FIXUPS_SECTION;
+        return true;
+    }
+    // Leading space of the header is already skipped
+    const char * exportsHdr = MapFile::MSVC_EXPORTS + 1;
+    if ((lineLen == strlen(exportsHdr)) && (strncmp(pLine, exportsHdr, lineLen) == 0))
+    {
+        kind = MapFile::EXPORTS_SECTION;
+        return true;
+    }
+    return false;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Builds a section directory, following sections like parseSymbols().
+////////////////////////////////////////////////////////////////////////////////
+class SectionScanner {
+public:
+    SectionScanner(const char * pStart, size_t minLineLen, std::vector<MapFile::MAPSection> &sections)
+        : pStart(pStart), minLineLen(minLineLen), sections(sections)
+    {
+    }
+
+    /// Processes one line; pNext points after its EOL
+    void line(const char * pLine, size_t lineLen, const char * pNext)
+    {
+        if (sectnHdr == MapFile::NO_SECTION)
+        {
+            // Only headers are of interest outside of symbol tables,
+            // and all of them start with a letter
+            if ((lineLen == 0) || !isalpha((unsigned char)*pLine))
+                return;
+            if (lineLen >= minLineLen)
+            {
+                sectnHdr = MapFile::recognizeSectionStart(pLine, lineLen);
+                if (sectnHdr != MapFile::NO_SECTION)
+                {
+                    open(MapFile::PUBLICS_SECTION, sectnHdr, pLine, pNext);
+                    return;
+                }
+            }
+            MapFile::SectionKind kind;
+            if (recognizeOtherSection(pLine, lineLen, kind))
+                open(kind, MapFile::NO_SECTION, pLine, pNext);
+            return;
+        }
+
+        if (lineLen < minLineLen)
+            return;
+        sectnHdr = MapFile::recognizeSectionEnd(sectnHdr, pLine, lineLen);
+        if (sectnHdr == MapFile::NO_SECTION)
+        {
+            closeAt(pLine);
+            MapFile::SectionKind kind;
+            if (recognizeOtherSection(pLine, lineLen, kind))
+                open(kind, MapFile::NO_SECTION, pLine, pNext);
+            return;
+        }
+        const MapFile::SectionType type = sectnHdr;
+        dispatchFormat(type, [&](auto format)
+        {
+            typedef decltype(format) Format;
+            if (Format::HAS_STATICS &&
+                (strncasecmp(pLine, MapFile::MSVC_STATICS, strlen(MapFile::MSVC_STATICS)) == 0))
+            {
+                closeAt(pLine);
+                open(MapFile::STATICS_SECTION, type, pLine, pNext);
+                return;
+            }
+            if (Format::isTableEnd(sym, pLine, lineLen, minLineLen))
+                finishAt(pLine);
+        });
+    }
+
+    /// Closes the last section at end of file
+    void finish(const char * pEnd)
+    {
+        closeAt(pEnd);
+    }
+
+private:
+    void open(MapFile::SectionKind kind, MapFile::SectionType type, const char * pLine, const char * pNext)
+    {
+        closeAt(pLine);
+        MapFile::MAPSection section;
+        section.kind = kind;
+        section.type = type;
+        section.headerOffset = (size_t)(pLine - pStart);
+        section.bodyOffset = (size_t)(pNext - pStart);
+        sections.push_back(section);
+        isOpen = true;
+    }
+
+    void closeAt(const char * pLine)
+    {
+        if (!isOpen)
+            return;
+        sections.back().endOffset = (size_t)(pLine - pStart);
+        isOpen = false;
+    }
+
+    /// Ends a symbol table at a line which the parser would stop at
+    void finishAt(const char * pLine)
+    {
+        closeAt(pLine);
+        sectnHdr = MapFile::NO_SECTION;
+    }
+
+    const char * pStart;
+    size_t minLineLen;
+    std::vector<MapFile::MAPSection> &sections;
+    MapFile::SectionType sectnHdr = MapFile::NO_SECTION;
+    bool isOpen = false;
+    MapFile::MAPSymbol sym;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Quickly finds offsets of all sections of a MAP file loaded into memory.
+///     Symbol tables are only checked for their end, not parsed; parsing every
+///     PUBLICS_SECTION and STATICS_SECTION with parseSection() gives the same
+///     symbols as parseSymbols() does.
+/// @param  pStart Pointer to start of buffer
+/// @param  pEnd Pointer to end of buffer
+/// @param  minLineLen Minimal accepted length of line
+/// @param sections Receives the sections, in file order
+////////////////////////////////////////////////////////////////////////////////
+void MapFile::scanSections(const char * pStart, const char * pEnd, size_t minLineLen, std::vector<MapFile::MAPSection> &sections)
+{
+    sections.clear();
+    SectionScanner scanner(pStart, minLineLen, sections);
+    std::vector<size_t> eolOffsets;
+    // Like in LineIndex, a line starts at EOL of the previous one
+    const char * pLineStart = pStart;
+    for (const char * pBlock = pStart; pBlock < pEnd; )
+    {
+        const char * pBlockEnd = ((size_t)(pEnd - pBlock) > SCAN_BLOCK_SIZE) ? pBlock + SCAN_BLOCK_SIZE : pEnd;
+        MapFile::findAllEOLs(pBlock, pBlockEnd, eolOffsets);
+        // The last line ends at the end of buffer
+        if (pBlockEnd == pEnd)
+            eolOffsets.push_back((size_t)(pEnd - pBlock));
+        for (size_t offs : eolOffsets)
+        {
+            const char * pEOL = pBlock + offs;
+            const char * pLine = MapFile::skipSpaces(pLineStart, pEOL);
+            scanner.line(pLine, (size_t)(pEOL - pLine), (pEOL < pEnd) ? pEOL + 1 : pEnd);
+            pLineStart = pEOL;
+        }
+        pBlock = pBlockEnd;
+    }
+    scanner.finish(pEnd);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Reads symbols of one section found by scanSections().
+/// @param  pStart Pointer to start of buffer given to scanSections()
+/// @param  pEnd Pointer to end of buffer
+/// @param section The section to parse; sections without symbols give none
+/// @param  minLineLen Minimal accepted length of line
+/// @param numOfSegs Number of segments, used to verify segment number range
+/// @param symbols Receives parsed symbols, appended in file order
+/// @param numThreads Amount of threads to use, 0 for one per CPU core
+/// @return Counters of parsed sections and symbols of this section
+////////////////////////////////////////////////////////////////////////////////
+MapFile::ParseStats MapFile::parseSection(const char * pStart, const char * pEnd, const MapFile::MAPSection &section,
+    size_t minLineLen, size_t numOfSegs, MapFile::SymbolTable &symbols, unsigned numThreads)
+{
+    if (numThreads == 0)
+        numThreads = std::thread::hardware_concurrency();
+    if (numThreads == 0)
+        numThreads = 1;
+
+    MapFile::ParseStats stats;
+    if ((section.type == MapFile::NO_SECTION) || (section.endOffset > (size_t)(pEnd - pStart)))
+        return stats;
+    if (section.kind == MapFile::PUBLICS_SECTION)
+        stats.sections++;
+
+    const size_t firstSymbol = symbols.size();
+    const LineIndex lines(pStart + section.bodyOffset, pStart + section.endOffset);
+    LineCursor cursor(lines);
+    MapFile::MAPSymbol sym;
+    TableSink sink(symbols);
+    dispatchFormat(section.type, [&](auto format)
+    {
+        parseTable<decltype(format)>(cursor, sym, minLineLen, numOfSegs, numThreads, sink, stats);
+    });
+    stats.symbols = (unsigned long)(symbols.size() - firstSymbol);
+    return stats;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Reads all symbol tables of a MAP file from a stream, line by line.
+///     Gives the same result as parsing the whole file from memory, while only
+///     the stream buffer is held; on a NUL character in the input parsing
+///     stops and stream result is set to FILE_BINARY_ERROR.
+/// @param stream Opened stream to read from
+/// @param  minLineLen Minimal accepted length of line
+/// @param numOfSegs Number of segments, used to verify segment number range
+/// @param symbols Receives parsed symbols, appended in file order
+/// @return Counters of parsed sections and symbols
+////////////////////////////////////////////////////////////////////////////////
+MapFile::ParseStats MapFile::parseSymbols(MapFile::MAPStream &stream, size_t minLineLen, size_t numOfSegs, MapFile::SymbolTable &symbols)
+{
+    TableSink sink(symbols);
+    return parseTables(stream, MapFile::NO_SECTION, minLineLen, numOfSegs, 1, sink);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Reads all symbol tables of a MAP file loaded into memory.
+/// @param  pStart Pointer to start of buffer
+/// @param  pEnd Pointer to end of buffer
+/// @param events Receiver of the symbols and section events
+/// @return Counters of parsed sections and symbols
+////////////////////////////////////////////////////////////////////////////////
+MapFile::ParseStats MapFile::Parser::parseEvents(const char * pStart, const char * pEnd, MapFile::ParserEvents &events) const
+{
+    MapFile::MAPDialect dialect;
+    MapFile::sniffDialect(pStart, pEnd, minLineLen, dialect);
+    EventSink sink(events);
+    const MapFile::ParseStats stats = parseBuffer(pStart, pEnd, dialect, minLineLen, numOfSegs, numThreads, sink);
+    sink.flush();
+    return stats;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Reads all symbol tables of a MAP file from a stream, line by line.
+/// @param stream Opened stream to read from
+/// @param events Receiver of the symbols and section events
+/// @return Counters of parsed sections and symbols
+////////////////////////////////////////////////////////////////////////////////
+MapFile::ParseStats MapFile::Parser::parseEvents(MapFile::MAPStream &stream, MapFile::ParserEvents &events) const
+{
+    EventSink sink(events);
+    const MapFile::ParseStats stats = parseTables(stream, MapFile::NO_SECTION, minLineLen, numOfSegs, 1, sink);
+    sink.flush();
+    return stats;
+}
+
+////////////////////////////////////////////////////////////////////////////////
@@ -1,76 +1,507 @@
-////////////////////////////////////////////////////////////////////////////////
-/// @file MAPReader.h
-///     MAP file analysis and loading routines header.
-/// @par Purpose:
-///     Library for loading MAP file entries.
-/// @author TQN <truong_quoc_ngan@yahoo.com>
-/// @author TL <mefistotelis@gmail.com>
-/// @date 2004.09.11 - 2018.11.08
-/// @par  Copying and copyrights:
-///     This program is free software; you can redistribute it and/or modify
-///     it under the terms of the GNU General Public License as published by
-///     the Free Software Foundation; either version 2 of the License, or
-///     (at your option) any later version.
-////////////////////////////////////////////////////////////////////////////////
-
-#ifndef MAPREADER_H_
-#define MAPREADER_H_
-
-#include  <cstdio>
-
-#undef MAXNAMELEN
-#define MAXNAMELEN      2048
-#define INVALID_MAPFILE_SIZE	(0xffffffff)
-
-namespace MapFile {
-
-typedef enum {
-    NO_SECTION = 0,
-    MSVC_MAP,
-    BCCL_NAM_MAP,
-    BCCL_VAL_MAP,
-    WATCOM_MAP,
-    GCC_MAP
-} SectionType;
-
-typedef enum {
-    OPEN_NO_ERROR = 0,
-    WIN32_ERROR,
-    FILE_EMPTY_ERROR,
-    FILE_BINARY_ERROR
-} MAPResult;
-
-typedef enum {
-    SKIP_LINE = 0,
-    INVALID_LINE,
-    FINISHING_LINE,
-    COMMENT_LINE,
-    SYMBOL_LINE,
-    STATICS_LINE,
-} ParseResult;
-
-typedef struct {
-    unsigned long seg = 0;
-    unsigned long addr = 0;
-    char name[MAXNAMELEN + 1] = {};
-    char type = 0;
-    char libname[260 + 1] = {}; // MAX_PATH
-} MAPSymbol;
-
-void closeMAP(const void * lpAddr);
-MAPResult openMAP(const char * lpszFileName, char * &lpMapAddr, size_t &dwSize);
-const char * skipSpaces(const char * pStart, const char * pEnd);
-const char * findEOL(const char * pStart, const char * pEnd);
-bool isXboxLibraryFile(const char* filename);
-MapFile::SectionType recognizeSectionStart(const char *pLine, size_t lineLen);
-MapFile::SectionType recognizeSectionEnd(MapFile::SectionType secType, const char *pLine, size_t lineLen);
-MapFile::ParseResult parseMsSymbolLine(MapFile::MAPSymbol &sym, const char *pLine, size_t lineLen, size_t minLineLen, size_t numOfSegs);
-MapFile::ParseResult parseWatcomSymbolLine(MapFile::MAPSymbol &sym, const char *pLine, size_t lineLen, size_t minLineLen, size_t numOfSegs);
-MapFile::ParseResult parseGccSymbolLine(MapFile::MAPSymbol &sym, const char *pLine, size_t lineLen, size_t minLineLen, size_t numOfSegs);
-
-};
-
-// Converts address in linear form into seg:offs, using IDA sections list
-void linearAddressToSymbolAddr(MapFile::MAPSymbol &sym, unsigned long linear_addr);
-
-#endif
+////////////////////////////////////////////////////////////////////////////////
+/// @file MAPReader.h
+///     MAP file analysis and loading routines header.
+/// @par Purpose:
+///     Library for loading MAP file entries.
+/// @author TQN <truong_quoc_ngan@yahoo.com>
+/// @author TL <mefistotelis@gmail.com>
+/// @date 2004.09.11 - 2018.11.08
+/// @par  Copying and copyrights:
+///     This program is free software; you can redistribute it and/or modify
+///     it under the terms of the GNU General Public License as published by
+///     the Free Software Foundation; either version 2 of the License, or
+///     (at your option) any later version.
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef MAPREADER_H_
+#define MAPREADER_H_
+
+#include  <cstdint>
+#include  <cstdio>
+#include  <deque>
+#include  <string>
+#include  <string_view>
+#include  <unordered_map>
+#include  <vector>
+
+#undef MAXNAMELEN
+#define MAXNAMELEN      2048
+#define INVALID_MAPFILE_SIZE	((size_t)-1)
+
+namespace MapFile {
+
+typedef enum {
+    NO_SECTION = 0,
+    MSVC_MAP,
+    BCCL_NAM_MAP,
+    BCCL_VAL_MAP,
+    WATCOM_MAP,
+    GCC_MAP
+} SectionType;
+
+typedef enum {
+    OPEN_NO_ERROR = 0,
+    WIN32_ERROR,
+    FILE_EMPTY_ERROR,
+    FILE_BINARY_ERROR
+} MAPResult;
+
+typedef enum {
+    SKIP_LINE = 0,
+    INVALID_LINE,
+    FINISHING_LINE,
+    COMMENT_LINE,
+    SYMBOL_LINE,
+    STATICS_LINE,
+} ParseResult;
+
+/// Minimal accepted length of a symbol line, for a "xxxx:xxxxxxxx " line
+const size_t DEFAULT_MIN_LINE_LEN = 14;
+/// Amount of segments accepted in symbol lines by both executables
+const size_t DEFAULT_NUM_OF_SEGS = 9;
+
+/// View of a MAP file mapped into memory; released by closeMAP().
+typedef struct {
+    char * addr = NULL;
+    size_t size = INVALID_MAPFILE_SIZE;
+} MAPView;
+
+typedef struct {
+    unsigned long seg = 0;
+    unsigned long addr = 0;
+    char name[MAXNAMELEN + 1] = {};
+    char type = 0;
+    char libname[260 + 1] = {}; // MAX_PATH
+} MAPSymbol;
+
+/// Contents of a section found by scanSections().
+typedef enum {
+    PUBLICS_SECTION = 0,
+    STATICS_SECTION,
+    LINE_NUMBERS_SECTION,
+    FIXUPS_SECTION,
+    EXPORTS_SECTION
+} SectionKind;
+
+/// Entry of a section directory; offsets are from start of the MAP file.
+typedef struct {
+    SectionKind kind = PUBLICS_SECTION;
+    /// Format of the symbol table, or NO_SECTION for sections without symbols
+    SectionType type = NO_SECTION;
+    size_t headerOffset = 0;
+    /// Offset right after the EOL of header line
+    size_t bodyOffset = 0;
+    /// Offset of the line which ended the section, or size of the file
+    size_t endOffset = 0;
+} MAPSection;
+
+/// Amount of bytes at start of a MAP file looked at by sniffDialect()
+#define SNIFF_SIZE      (64 * 1024)
+
+/// Format of a MAP file, found by sniffDialect().
+typedef struct {
+    /// Format of the first symbol table, or NO_SECTION if none was found
+    SectionType type = NO_SECTION;
+    /// Offset of header line of the first symbol table
+    size_t headerOffset = 0;
+    /// Offset right after the EOL of header line
+    size_t bodyOffset = 0;
+} MAPDialect;
+
+/// Totals gathered by parseSymbols().
+typedef struct {
+    unsigned long sections = 0;
+    unsigned long symbols = 0;
+    unsigned long invalidSyms = 0;
+    /// Set if addresses went through linearAddressToSymbolAddr(), which
+    /// depends on the host program; such results are not cached
+    bool usesHostSegments = false;
+} ParseStats;
+
+/// Suffix appended to MAP file name to get name of its symbol cache
+#define SYMBOL_CACHE_SUFFIX ".symcache"
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Set of distinct strings, each identified by a dense integer ID.
+///     IDs are assigned from 0 in order of first appearance.
+////////////////////////////////////////////////////////////////////////////////
+class NamePool {
+public:
+    static constexpr unsigned NO_NAME = (unsigned)-1;
+
+    unsigned intern(const char * name, size_t len);
+    unsigned find(const char * name, size_t len) const;
+    void clear();
+
+    size_t size() const { return names.size(); }
+    const char * getName(unsigned id) const { return names[id].c_str(); }
+
+private:
+    // deque never moves its elements, so the map keys stay valid
+    std::deque<std::string> names;
+    std::unordered_map<std::string_view, unsigned> ids;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Symbols of a MAP file stored column by column.
+///     Names are kept NUL-terminated in one string arena and referenced by
+///     offset; Lib:Object entries are interned into object IDs. Each symbol
+///     costs a few dozen bytes instead of a MAPSymbol.
+///     Pointers returned by getName() are valid until next append.
+////////////////////////////////////////////////////////////////////////////////
+class SymbolTable {
+public:
+    void append(const MapFile::MAPSymbol &sym);
+    void append(unsigned long seg, unsigned long addr, char type,
+        const char * name, size_t nameLen, const char * libname, size_t libnameLen);
+    void append(const MapFile::SymbolTable &other);
+    void reserve(size_t numSymbols);
+    void clear();
+
+    size_t size() const { return addrs.size(); }
+    bool empty() const { return addrs.empty(); }
+
+    unsigned long getSeg(size_t idx) const { return segs[idx]; }
+    unsigned long getAddr(size_t idx) const { return addrs[idx]; }
+    char getType(size_t idx) const { return types[idx]; }
+    const char * getName(size_t idx) const { return &strings[nameOffsets[idx]]; }
+    unsigned getObjectId(size_t idx) const { return objectIds[idx]; }
+    const char * getLibname(size_t idx) const { return objects.getName(objectIds[idx]); }
+
+    /// Distinct Lib:Object entries, indexed by object ID
+    size_t getNumObjects() const { return objects.size(); }
+    const char * getObjectName(unsigned objectId) const { return objects.getName(objectId); }
+
+    /// Whole columns, for scans which need only some of the fields
+    const std::vector<unsigned long> &getSegs() const { return segs; }
+    const std::vector<unsigned long> &getAddrs() const { return addrs; }
+    const std::vector<char> &getTypes() const { return types; }
+    const std::vector<unsigned> &getObjectIds() const { return objectIds; }
+
+private:
+    std::vector<unsigned long> segs;
+    std::vector<unsigned long> addrs;
+    std::vector<char> types;
+    std::vector<size_t> nameOffsets;
+    std::vector<unsigned> objectIds;
+    std::vector<char> strings;
+    MapFile::NamePool objects;
+
+    friend bool loadSymbolCache(const char * cacheFileName, const char * mapFileName, const MapFile::MAPView &map,
+        size_t minLineLen, size_t numOfSegs, MapFile::SymbolTable &symbols, MapFile::ParseStats &stats);
+    friend bool saveSymbolCache(const char * cacheFileName, const char * mapFileName, const MapFile::MAPView &map,
+        size_t minLineLen, size_t numOfSegs, const MapFile::SymbolTable &symbols, const MapFile::ParseStats &stats);
+};
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Sorted index of SymbolTable addresses, for address to symbol lookups.
+///     Each segment keeps its distinct addresses sorted, plus a copy in
+///     Eytzinger (breadth-first) order for cache-friendly binary search.
+///     Symbol sizes are inferred from the address of the next symbol.
+////////////////////////////////////////////////////////////////////////////////
+class AddressIndex {
+public:
+    static const size_t NO_SYMBOL = (size_t)-1;
+
+    void build(const MapFile::SymbolTable &symbols);
+    void clear();
+
+    size_t find(unsigned long seg, unsigned long addr) const;
+    void findBatch(const unsigned long * segs, const unsigned long * addrs, size_t count, size_t * found) const;
+
+    /// Distance to the next symbol in segment; 0 for the last one, which has unknown size
+    unsigned long getSymbolSize(size_t symIdx) const { return symbolSizes[symIdx]; }
+
+private:
+    struct SegmentIndex {
+        std::vector<unsigned long> addrs;
+        std::vector<size_t> symbols;
+        std::vector<unsigned long> eytzAddrs;
+        std::vector<size_t> eytzRanks;
+    };
+
+    size_t findRank(const SegmentIndex &segIndex, unsigned long addr) const;
+
+    std::vector<SegmentIndex> segments;
+    std::vector<unsigned long> symbolSizes;
+};
+
+/// One entry of a LineTable; seg is 0-based, like in SymbolTable.
+typedef struct {
+    unsigned long seg = 0;
+    unsigned long addr = 0;
+    unsigned long line = 0;
+    unsigned fileId = 0;
+} MAPLine;
+
+/// Amount of LineTable entries encoded together in one block
+#define LINE_BLOCK_ENTRIES      64
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Source lines of code addresses, from "Line numbers for" sections.
+///     Entries of all files are sorted by segment and address, and stored
+///     delta-encoded like DWARF line programs: variable length address and
+///     line increments, with file ID only where it changes. Blocks of
+///     LINE_BLOCK_ENTRIES can be decoded on their own, so a lookup is a
+///     binary search over blocks followed by decoding one or a few blocks.
+////////////////////////////////////////////////////////////////////////////////
+class LineTable {
+public:
+    unsigned addFile(const char * name, size_t len) { return files.intern(name, len); }
+    void build(std::vector<MapFile::MAPLine> &lines);
+    void clear();
+
+    size_t size() const { return numLines; }
+    size_t getNumFiles() const { return files.size(); }
+    const char * getFileName(unsigned id) const { return files.getName(id); }
+    /// Bytes used by the encoded entries and block index
+    size_t getEncodedSize() const { return data.size() + blocks.size() * sizeof(Block); }
+
+    bool find(unsigned long seg, unsigned long addr, MapFile::MAPLine &line) const;
+    void findRange(unsigned long seg, unsigned long addrBegin, unsigned long addrEnd, std::vector<MapFile::MAPLine> &lines) const;
+
+private:
+    struct Block {
+        unsigned long seg;
+        unsigned long firstAddr;
+        size_t dataOffset;
+        size_t count;
+    };
+
+    size_t findBlock(unsigned long seg, unsigned long addr) const;
+
+    std::vector<Block> blocks;
+    std::vector<unsigned char> data;
+    MapFile::NamePool files;
+    size_t numLines = 0;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Relocated locations from "FIXUPS:" sections of MSVC MAP files.
+///     Stored as a sorted array of 32-bit RVAs, like in PE relocation table,
+///     so finding fixups within an address range is a binary search.
+///     Ranges of segments are known only after setSegments().
+////////////////////////////////////////////////////////////////////////////////
+class FixupTable {
+public:
+    void build(std::vector<unsigned long> &fixupRvas);
+    void clear();
+
+    size_t size() const { return rvas.size(); }
+    unsigned long getRva(size_t idx) const { return rvas[idx]; }
+
+    size_t findRange(unsigned long rvaBegin, unsigned long rvaEnd, size_t &first) const;
+    void setSegments(const std::vector<unsigned long> &segStarts, const std::vector<unsigned long> &segSizes);
+    bool getSegmentRange(unsigned long seg, size_t &first, size_t &last) const;
+
+private:
+    std::vector<uint32_t> rvas;
+    /// Range of fixup indexes of each segment, set by setSegments()
+    std::vector<size_t> segmentFirst;
+    std::vector<size_t> segmentLast;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Entries of "Exports" section of MSVC MAP files.
+///     Exported names are hashed, so finding an export by name takes
+///     constant time.
+////////////////////////////////////////////////////////////////////////////////
+class ExportTable {
+public:
+    static constexpr size_t NO_EXPORT = (size_t)-1;
+
+    void add(unsigned long ordinal, const char * name, size_t nameLen, const char * internalName, size_t internalLen);
+    void clear();
+
+    size_t size() const { return ordinals.size(); }
+    unsigned long getOrdinal(size_t idx) const { return ordinals[idx]; }
+    const char * getName(size_t idx) const { return names.getName(nameIds[idx]); }
+    /// Name of the exported symbol within the module; same as getName() if not given
+    const char * getInternalName(size_t idx) const { return names.getName(internalIds[idx]); }
+
+    size_t findByName(const char * name) const;
+
+private:
+    std::vector<unsigned long> ordinals;
+    std::vector<unsigned> nameIds;
+    std::vector<unsigned> internalIds;
+    /// Export index of each name ID, NO_EXPORT for internal names only
+    std::vector<size_t> exportOfName;
+    MapFile::NamePool names;
+};
+
+/// Default buffer size of MAPStream; longer lines are truncated to it
+#define MAPSTREAM_BUFFER_SIZE   (1024 * 1024)
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Sequential reader of MAP file lines from a file, pipe or stdin.
+///     Input is read in chunks into a buffer of fixed size, so memory use does
+///     not depend on input size. A line cut by the end of a chunk is moved to
+///     the buffer front, and the next chunk is appended after it.
+///     File name "-" reads standard input; names ending with ".gz" or ".zst"
+///     are read through the gzip or zstd tool.
+///     Pointers returned by nextLine() are valid until the next call.
+////////////////////////////////////////////////////////////////////////////////
+class MAPStream {
+public:
+    explicit MAPStream(size_t bufferSize = MAPSTREAM_BUFFER_SIZE);
+    ~MAPStream();
+    MAPStream(const MAPStream &) = delete;
+    MAPStream &operator=(const MAPStream &) = delete;
+
+    /// Checks if the file cannot be mapped by openMAP(), but can be streamed
+    static bool requiresStream(const char * fileName);
+
+    MapFile::MAPResult open(const char * fileName);
+    void close();
+    bool nextLine(const char * &pLine, size_t &lineLen);
+
+    /// FILE_BINARY_ERROR if reading stopped on a NUL character, WIN32_ERROR
+    /// if reading failed or the decompressor reported an error
+    MapFile::MAPResult getResult() const { return result; }
+    unsigned long long getBytesRead() const { return bytesRead; }
+    /// Gets data which is read, but not returned by nextLine() yet
+    const char * getBuffered(size_t &size) const { size = bufEnd - bufPos; return buffer.data() + bufPos; }
+
+private:
+    bool readChunk();
+
+    FILE * file = NULL;
+    bool isPipe = false;
+    bool atEOF = false;
+    /// Set after a truncated line, until its EOL is reached
+    bool skipToEOL = false;
+    MapFile::MAPResult result = OPEN_NO_ERROR;
+    std::vector<char> buffer;
+    size_t bufPos = 0;
+    size_t bufEnd = 0;
+    unsigned long long bytesRead = 0;
+};
+
+/// Checks for characters which isspace() accepts in the "C" locale;
+/// these separate fields of MAP lines
+inline bool isFieldSeparator(char c)
+{
+    return (c == ' ') || (c == '\t') || (c == '\n') || (c == '\v') || (c == '\f') || (c == '\r');
+}
+
+void closeMAP(MapFile::MAPView &view);
+MAPResult openView(const char * lpszFileName, MapFile::MAPView &view);
+MAPResult openMAP(const char * lpszFileName, MapFile::MAPView &view);
+const char * skipSpaces(const char * pStart, const char * pEnd);
+const char * findEOL(const char * pStart, const char * pEnd);
+const char * nextField(const char * pStart, const char * pEnd, const char * &pFieldEnd);
+const char * parseNumber(const char * pStart, const char * pEnd, unsigned base, unsigned long &value);
+void findAllEOLs(const char * pStart, const char * pEnd, std::vector<size_t> &eolOffsets);
+bool isXboxLibraryFile(const char* filename);
+MapFile::SectionType recognizeSectionStart(const char *pLine, size_t lineLen);
+MapFile::SectionType recognizeSectionEnd(MapFile::SectionType secType, const char *pLine, size_t lineLen);
+MapFile::ParseResult parseMsSymbolLine(MapFile::MAPSymbol &sym, const char *pLine, size_t lineLen, size_t minLineLen, size_t numOfSegs);
+MapFile::ParseResult parseWatcomSymbolLine(MapFile::MAPSymbol &sym, const char *pLine, size_t lineLen, size_t minLineLen, size_t numOfSegs);
+MapFile::ParseResult parseGccSymbolLine(MapFile::MAPSymbol &sym, const char *pLine, size_t lineLen, size_t minLineLen, size_t numOfSegs);
+MapFile::ParseStats parseSymbols(const char * pStart, const char * pEnd, size_t minLineLen, size_t numOfSegs, MapFile::SymbolTable &symbols, unsigned numThreads = 1);
+MapFile::ParseStats parseSymbols(MapFile::MAPStream &stream, size_t minLineLen, size_t numOfSegs, MapFile::SymbolTable &symbols);
+bool sniffDialect(const char * pStart, const char * pEnd, size_t minLineLen, MapFile::MAPDialect &dialect);
+MapFile::MAPResult sniffDialect(const char * fileName, size_t minLineLen, MapFile::MAPDialect &dialect);
+MapFile::ParseStats parseSymbols(const char * pStart, const char * pEnd, const MapFile::MAPDialect &dialect,
+    size_t minLineLen, size_t numOfSegs, MapFile::SymbolTable &symbols, unsigned numThreads = 1);
+void scanSections(const char * pStart, const char * pEnd, size_t minLineLen, std::vector<MapFile::MAPSection> &sections);
+MapFile::ParseStats parseSection(const char * pStart, const char * pEnd, const MapFile::MAPSection &section,
+    size_t minLineLen, size_t numOfSegs, MapFile::SymbolTable &symbols, unsigned numThreads = 1);
+size_t parseLineNumbers(const char * pStart, const char * pEnd, const std::vector<MapFile::MAPSection> &sections, MapFile::LineTable &table);
+size_t parseFixups(const char * pStart, const char * pEnd, const std::vector<MapFile::MAPSection> &sections, MapFile::FixupTable &table);
+size_t parseExports(const char * pStart, const char * pEnd, const std::vector<MapFile::MAPSection> &sections, MapFile::ExportTable &table);
+bool loadSymbolCache(const char * cacheFileName, const char * mapFileName, const MapFile::MAPView &map,
+    size_t minLineLen, size_t numOfSegs, MapFile::SymbolTable &symbols, MapFile::ParseStats &stats);
+bool saveSymbolCache(const char * cacheFileName, const char * mapFileName, const MapFile::MAPView &map,
+    size_t minLineLen, size_t numOfSegs, const MapFile::SymbolTable &symbols, const MapFile::ParseStats &stats);
+MapFile::ParseStats parseSymbolsCached(const char * mapFileName, const MapFile::MAPView &map, size_t minLineLen,
+    size_t numOfSegs, MapFile::SymbolTable &symbols, unsigned numThreads = 1);
+
+/// Amount of symbols collected before they are passed to a Parser visitor
+#define PARSER_BATCH_SIZE       4096
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Receiver of events from Parser; visitors are wrapped into it.
+////////////////////////////////////////////////////////////////////////////////
+class ParserEvents {
+public:
+    virtual ~ParserEvents() {}
+    virtual void sectionStart(MapFile::SectionType type) = 0;
+    virtual void symbols(const MapFile::SymbolTable &batch) = 0;
+    virtual void comment(const char * text) = 0;
+    virtual void sectionEnd(MapFile::SectionType type) = 0;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Base of Parser visitors, ignoring all events.
+///     Visitors derive from it and define only the methods they need.
+////////////////////////////////////////////////////////////////////////////////
+struct ParserVisitor {
+    /// Called after the header line of a symbol table
+    void sectionStart(MapFile::SectionType) {}
+    /// Called with symbols in file order; object IDs are local to the batch,
+    /// and the batch is reused after the call returns
+    void symbols(const MapFile::SymbolTable &) {}
+    /// Called for comment lines within a table, like Watcom "Module: " lines
+    void comment(const char *) {}
+    /// Called after the last line of a symbol table
+    void sectionEnd(MapFile::SectionType) {}
+};
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Reads symbol tables of a MAP file, passing them to a visitor.
+///     Lines are parsed by the same loops as parseSymbols() uses; the visitor
+///     is called once per batch of symbols, not once per line.
+////////////////////////////////////////////////////////////////////////////////
+class Parser {
+public:
+    explicit Parser(size_t minLineLen = DEFAULT_MIN_LINE_LEN, size_t numOfSegs = DEFAULT_NUM_OF_SEGS, unsigned numThreads = 1)
+        : minLineLen(minLineLen), numOfSegs(numOfSegs), numThreads(numThreads)
+    {
+    }
+
+    /// Parses a MAP file loaded into memory
+    template <class Visitor>
+    MapFile::ParseStats parse(const char * pStart, const char * pEnd, Visitor &visitor) const
+    {
+        VisitorEvents<Visitor> events(visitor);
+        return parseEvents(pStart, pEnd, events);
+    }
+
+    /// Parses a MAP file from an opened stream
+    template <class Visitor>
+    MapFile::ParseStats parse(MapFile::MAPStream &stream, Visitor &visitor) const
+    {
+        VisitorEvents<Visitor> events(visitor);
+        return parseEvents(stream, events);
+    }
+
+private:
+    template <class Visitor>
+    class VisitorEvents : public ParserEvents {
+    public:
+        explicit VisitorEvents(Visitor &visitor) : visitor(visitor) {}
+        void sectionStart(MapFile::SectionType type) override { visitor.sectionStart(type); }
+        void symbols(const MapFile::SymbolTable &batch) override { visitor.symbols(batch); }
+        void comment(const char * text) override { visitor.comment(text); }
+        void sectionEnd(MapFile::SectionType type) override { visitor.sectionEnd(type); }
+
+    private:
+        Visitor &visitor;
+    };
+
+    MapFile::ParseStats parseEvents(const char * pStart, const char * pEnd, MapFile::ParserEvents &events) const;
+    MapFile::ParseStats parseEvents(MapFile::MAPStream &stream, MapFile::ParserEvents &events) const;
+
+    size_t minLineLen;
+    size_t numOfSegs;
+    unsigned numThreads;
+};
+
+};
+
+// Converts address in linear form into seg:offs, using IDA sections list
+void linearAddressToSymbolAddr(MapFile::MAPSymbol &sym, unsigned long linear_addr);
+
+#endif
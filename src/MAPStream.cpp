@@ -0,0 +1,241 @@
+////////////////////////////////////////////////////////////////////////////////
+/// @file MAPStream.cpp
+///     Sequential reading of MAP file lines with bounded memory.
+/// @par Purpose:
+///     Reads MAP files which cannot be mapped into memory: pipes, standard
+///     input and compressed files, or files larger than the address space.
+/// @par  Copying and copyrights:
+///     This program is free software; you can redistribute it and/or modify
+///     it under the terms of the GNU General Public License as published by
+///     the Free Software Foundation; either version 2 of the License, or
+///     (at your option) any later version.
+////////////////////////////////////////////////////////////////////////////////
+
+#include  "MAPReader.h"
+
+#include  <cctype>
+#include  <cstring>
+#include  <string>
+
+#ifdef _WIN32
+#define popen _popen
+#define pclose _pclose
+#define POPEN_READ_MODE "rb"
+#else
+#define POPEN_READ_MODE "r"
+#endif
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Checks if file name ends with given extension, ignoring case.
+////////////////////////////////////////////////////////////////////////////////
+static bool hasExtension(const char * fileName, const char * ext)
+{
+    const size_t nameLen = strlen(fileName);
+    const size_t extLen = strlen(ext);
+    if (nameLen <= extLen)
+        return false;
+    for (size_t i = 0; i < extLen; i++)
+    {
+        if (tolower((unsigned char)fileName[nameLen - extLen + i]) != ext[i])
+            return false;
+    }
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Builds command line which decompresses a file to standard output.
+/// @return The command, or empty string if the file is not compressed
+////////////////////////////////////////////////////////////////////////////////
+static std::string decompressCommand(const char * fileName)
+{
+    std::string cmd;
+    if (hasExtension(fileName, ".gz"))
+        cmd = "gzip -dc ";
+    else
+    if (hasExtension(fileName, ".zst"))
+        cmd = "zstd -dcq ";
+    else
+        return cmd;
+#ifdef _WIN32
+    cmd += '"';
+    cmd += fileName;
+    cmd += '"';
+#else
+    // Single quotes keep the shell from interpreting the name
+    cmd += '\'';
+    for (const char * p = fileName; *p != '\0'; p++)
+    {
+        if (*p == '\'')
+            cmd += "'\\''";
+        else
+            cmd += *p;
+    }
+    cmd += '\'';
+#endif
+    return cmd;
+}
+
+bool MapFile::MAPStream::requiresStream(const char * fileName)
+{
+    return (strcmp(fileName, "-") == 0) || !decompressCommand(fileName).empty();
+}
+
+MapFile::MAPStream::MAPStream(size_t bufferSize)
+    : buffer(bufferSize)
+{
+}
+
+MapFile::MAPStream::~MAPStream()
+{
+    close();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Opens a MAP file for reading line by line.
+///     The first chunk is read at once, to report empty and binary inputs.
+/// @param fileName Path of the file, or "-" for standard input
+/// @return enum value of OPEN_FILE_ERROR
+////////////////////////////////////////////////////////////////////////////////
+MapFile::MAPResult MapFile::MAPStream::open(const char * fileName)
+{
+    close();
+    if (strcmp(fileName, "-") == 0)
+    {
+        file = stdin;
+    } else
+    {
+        const std::string cmd = decompressCommand(fileName);
+        if (!cmd.empty())
+        {
+            file = popen(cmd.c_str(), POPEN_READ_MODE);
+            isPipe = true;
+        } else
+        {
+            file = fopen(fileName, "rb");
+        }
+    }
+    if (file == NULL)
+    {
+        isPipe = false;
+        return WIN32_ERROR;
+    }
+
+    if (!readChunk())
+    {
+        // A decompressor which failed to start gives no output either
+        const MapFile::MAPResult eRet = (result == OPEN_NO_ERROR) ? FILE_EMPTY_ERROR : result;
+        close();
+        return eRet;
+    }
+    return OPEN_NO_ERROR;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Closes the input; standard input is left open.
+////////////////////////////////////////////////////////////////////////////////
+void MapFile::MAPStream::close()
+{
+    if (file != NULL)
+    {
+        if (isPipe)
+            pclose(file);
+        else
+        if (file != stdin)
+            fclose(file);
+    }
+    file = NULL;
+    isPipe = false;
+    atEOF = false;
+    skipToEOL = false;
+    result = OPEN_NO_ERROR;
+    bufPos = 0;
+    bufEnd = 0;
+    bytesRead = 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Moves unread data to buffer front and appends next chunk after it.
+///     At end of input a decompressor is waited for; read errors and its
+///     failure are kept as WIN32_ERROR result.
+/// @return False if nothing more could be read
+////////////////////////////////////////////////////////////////////////////////
+bool MapFile::MAPStream::readChunk()
+{
+    if (atEOF || (file == NULL))
+    {
+        atEOF = true;
+        return false;
+    }
+    if (bufPos > 0)
+    {
+        memmove(buffer.data(), buffer.data() + bufPos, bufEnd - bufPos);
+        bufEnd -= bufPos;
+        bufPos = 0;
+    }
+    const size_t got = fread(buffer.data() + bufEnd, 1, buffer.size() - bufEnd, file);
+    if (got == 0)
+    {
+        // A damaged compressed file ends the output early, and only the
+        // exit status of the decompressor tells
+        if (ferror(file))
+            result = WIN32_ERROR;
+        if (isPipe)
+        {
+            if (pclose(file) != 0)
+                result = WIN32_ERROR;
+            file = NULL;
+            isPipe = false;
+        }
+        atEOF = true;
+        return false;
+    }
+    if (memchr(buffer.data() + bufEnd, 0, got) != NULL)
+    {
+        // File is binary or Unicode file
+        result = FILE_BINARY_ERROR;
+        atEOF = true;
+        return false;
+    }
+    bufEnd += got;
+    bytesRead += got;
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Gets next line, split at '\r' or '\n' like findAllEOLs() does.
+/// @param pLine Receives start of the line, with leading spaces skipped
+/// @param lineLen Receives length of the line, without EOL
+/// @return False at end of input
+////////////////////////////////////////////////////////////////////////////////
+bool MapFile::MAPStream::nextLine(const char * &pLine, size_t &lineLen)
+{
+    for (;;)
+    {
+        const char * pStart = buffer.data() + bufPos;
+        const char * pEnd = buffer.data() + bufEnd;
+        const char * pEOL = MapFile::findEOL(pStart, pEnd);
+        const bool bufferFull = (bufPos == 0) && (bufEnd == buffer.size());
+        if ((pEOL == pEnd) && !bufferFull && !atEOF)
+        {
+            // Reading moves the buffer, so look for EOL again
+            readChunk();
+            continue;
+        }
+        // At end of input the last line ends at end of buffer
+        if ((pStart == pEnd) && (pEOL == pEnd))
+            return false;
+
+        const bool wasSkipping = skipToEOL;
+        // Line longer than the buffer is cut, rest of it is dropped
+        skipToEOL = (pEOL == pEnd) && bufferFull;
+        bufPos = (size_t)(pEOL - buffer.data());
+        if (pEOL < pEnd)
+            bufPos++;
+        if (wasSkipping)
+            continue;
+
+        pLine = MapFile::skipSpaces(pStart, pEOL);
+        lineLen = (size_t)(pEOL - pLine);
+        return true;
+    }
+}
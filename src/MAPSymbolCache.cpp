@@ -0,0 +1,354 @@
+////////////////////////////////////////////////////////////////////////////////
+/// @file MAPSymbolCache.cpp
+///     Binary cache of symbols parsed from a MAP file.
+/// @par Purpose:
+///     Stores a parsed SymbolTable next to its MAP file, so later runs can
+///     load it with a few block copies instead of parsing the text again.
+/// @par  Copying and copyrights:
+///     This program is free software; you can redistribute it and/or modify
+///     it under the terms of the GNU General Public License as published by
+///     the Free Software Foundation; either version 2 of the License, or
+///     (at your option) any later version.
+////////////////////////////////////////////////////////////////////////////////
+
+#include  "MAPReader.h"
+
+#include  <cstdint>
+#include  <cstring>
+#include  <filesystem>
+#include  <string>
+#include  <vector>
+
+namespace {
+
+/// @name Identification of the cache file format.
+/// @{
+const char SYMBOL_CACHE_MAGIC[8]        = "MAPSYMC";
+const uint32_t SYMBOL_CACHE_VERSION     = 1;
+const uint32_t SYMBOL_CACHE_BYTE_ORDER  = 0x01020304;
+/// @}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Header at the start of a symbol cache file.
+///     It is followed by these blocks, each padded to 8 bytes:
+///     seg[numSymbols] u64, addr[numSymbols] u64, nameOffset[numSymbols] u64,
+///     objectId[numSymbols] u32, type[numSymbols] char, names[namesSize],
+///     objectNameOffset[numObjects] u64, objectNames[objectNamesSize].
+////////////////////////////////////////////////////////////////////////////////
+struct SymbolCacheHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t byteOrder;
+    // Source MAP file the cache was made from
+    uint64_t sourceSize;
+    int64_t sourceMtime;
+    uint64_t sourceHash;
+    // Parameters which change the parsing result
+    uint64_t minLineLen;
+    uint64_t numOfSegs;
+    // Parsing results
+    uint64_t sections;
+    uint64_t invalidSyms;
+    uint64_t numSymbols;
+    uint64_t numObjects;
+    uint64_t namesSize;
+    uint64_t objectNamesSize;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Offsets of the blocks which follow the header.
+////////////////////////////////////////////////////////////////////////////////
+struct SymbolCacheLayout {
+    uint64_t segs;
+    uint64_t addrs;
+    uint64_t nameOffsets;
+    uint64_t objectIds;
+    uint64_t types;
+    uint64_t names;
+    uint64_t objectNameOffsets;
+    uint64_t objectNames;
+    uint64_t fileSize;
+
+    explicit SymbolCacheLayout(const SymbolCacheHeader &hdr)
+    {
+        uint64_t offs = sizeof(SymbolCacheHeader);
+        segs = place(offs, hdr.numSymbols * sizeof(uint64_t));
+        addrs = place(offs, hdr.numSymbols * sizeof(uint64_t));
+        nameOffsets = place(offs, hdr.numSymbols * sizeof(uint64_t));
+        objectIds = place(offs, hdr.numSymbols * sizeof(uint32_t));
+        types = place(offs, hdr.numSymbols);
+        names = place(offs, hdr.namesSize);
+        objectNameOffsets = place(offs, hdr.numObjects * sizeof(uint64_t));
+        objectNames = place(offs, hdr.objectNamesSize);
+        fileSize = offs;
+    }
+
+private:
+    static uint64_t place(uint64_t &offs, uint64_t size)
+    {
+        const uint64_t start = offs;
+        offs = (offs + size + 7) & ~(uint64_t)7;
+        return start;
+    }
+};
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Hashes the whole MAP file, 8 bytes per step.
+////////////////////////////////////////////////////////////////////////////////
+uint64_t hashMapContent(const MapFile::MAPView &map)
+{
+    const uint64_t prime = 0x100000001b3ULL;
+    uint64_t hash = 0xcbf29ce484222325ULL ^ (uint64_t)map.size;
+    size_t offs = 0;
+    for (; offs + sizeof(uint64_t) <= map.size; offs += sizeof(uint64_t))
+    {
+        uint64_t word;
+        memcpy(&word, map.addr + offs, sizeof(word));
+        hash = (hash ^ word) * prime;
+        hash ^= hash >> 29;
+    }
+    for (; offs < map.size; offs++)
+        hash = (hash ^ (unsigned char)map.addr[offs]) * prime;
+    return hash;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Fills fields of the header which identify the source MAP file.
+/// @return False if file attributes could not be read
+////////////////////////////////////////////////////////////////////////////////
+bool describeSource(SymbolCacheHeader &hdr, const char * mapFileName, const MapFile::MAPView &map,
+    size_t minLineLen, size_t numOfSegs)
+{
+    std::error_code err;
+    const auto mtime = std::filesystem::last_write_time(mapFileName, err);
+    if (err)
+        return false;
+    memcpy(hdr.magic, SYMBOL_CACHE_MAGIC, sizeof(hdr.magic));
+    hdr.version = SYMBOL_CACHE_VERSION;
+    hdr.byteOrder = SYMBOL_CACHE_BYTE_ORDER;
+    hdr.sourceSize = map.size;
+    hdr.sourceMtime = (int64_t)mtime.time_since_epoch().count();
+    hdr.sourceHash = hashMapContent(map);
+    hdr.minLineLen = minLineLen;
+    hdr.numOfSegs = numOfSegs;
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Writes a block of the cache file at given offset.
+////////////////////////////////////////////////////////////////////////////////
+bool writeBlock(FILE * fp, uint64_t &pos, uint64_t offset, const void * data, size_t size)
+{
+    static const char padding[8] = {};
+    while (pos < offset)
+    {
+        const size_t padLen = (size_t)(offset - pos);
+        if (fwrite(padding, 1, padLen, fp) != padLen)
+            return false;
+        pos += padLen;
+    }
+    if ((size != 0) && (fwrite(data, 1, size, fp) != size))
+        return false;
+    pos += size;
+    return true;
+}
+
+};
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Loads symbols from a cache file, if it matches the MAP file.
+/// @param cacheFileName Path name of the cache file.
+/// @param mapFileName Path name of the MAP file the cache was made from.
+/// @param map The MAP file content, used to verify the cache.
+/// @param  minLineLen Minimal accepted length of line used while parsing
+/// @param numOfSegs Number of segments used while parsing
+/// @param symbols Receives the cached symbols
+/// @param stats Receives the cached parsing totals
+/// @return True if the cache was valid and loaded
+////////////////////////////////////////////////////////////////////////////////
+bool MapFile::loadSymbolCache(const char * cacheFileName, const char * mapFileName, const MapFile::MAPView &map,
+    size_t minLineLen, size_t numOfSegs, MapFile::SymbolTable &symbols, MapFile::ParseStats &stats)
+{
+    MapFile::MAPView cache;
+    if (MapFile::openView(cacheFileName, cache) != MapFile::OPEN_NO_ERROR)
+        return false;
+
+    bool valid = false;
+    SymbolCacheHeader hdr;
+    SymbolCacheHeader expected;
+    if ((cache.size >= sizeof(hdr)) && describeSource(expected, mapFileName, map, minLineLen, numOfSegs))
+    {
+        memcpy(&hdr, cache.addr, sizeof(hdr));
+        valid = (memcmp(hdr.magic, expected.magic, sizeof(hdr.magic)) == 0) &&
+            (hdr.version == expected.version) && (hdr.byteOrder == expected.byteOrder) &&
+            (hdr.sourceSize == expected.sourceSize) && (hdr.sourceMtime == expected.sourceMtime) &&
+            (hdr.sourceHash == expected.sourceHash) && (hdr.minLineLen == expected.minLineLen) &&
+            (hdr.numOfSegs == expected.numOfSegs) &&
+            (hdr.numSymbols < cache.size) && (hdr.numObjects < cache.size) &&
+            (hdr.namesSize < cache.size) && (hdr.objectNamesSize < cache.size) &&
+            (SymbolCacheLayout(hdr).fileSize == cache.size);
+    }
+    if (!valid)
+    {
+        MapFile::closeMAP(cache);
+        return false;
+    }
+
+    const SymbolCacheLayout layout(hdr);
+    const size_t numSymbols = (size_t)hdr.numSymbols;
+    const char * base = cache.addr;
+    const uint64_t * fileSegs = (const uint64_t *)(base + layout.segs);
+    const uint64_t * fileAddrs = (const uint64_t *)(base + layout.addrs);
+    const uint64_t * fileNameOffsets = (const uint64_t *)(base + layout.nameOffsets);
+    const uint32_t * fileObjectIds = (const uint32_t *)(base + layout.objectIds);
+    const uint64_t * fileObjectNameOffsets = (const uint64_t *)(base + layout.objectNameOffsets);
+    const char * fileNames = base + layout.names;
+    const char * fileObjectNames = base + layout.objectNames;
+
+    // Reject damaged files instead of handing out bad offsets
+    if ((hdr.namesSize > 0 && fileNames[hdr.namesSize - 1] != '\0') ||
+        (hdr.objectNamesSize > 0 && fileObjectNames[hdr.objectNamesSize - 1] != '\0'))
+    {
+        MapFile::closeMAP(cache);
+        return false;
+    }
+    for (size_t i = 0; i < numSymbols; i++)
+    {
+        if ((fileNameOffsets[i] >= hdr.namesSize) || (fileObjectIds[i] >= hdr.numObjects))
+        {
+            MapFile::closeMAP(cache);
+            return false;
+        }
+    }
+    for (size_t i = 0; i < hdr.numObjects; i++)
+    {
+        if (fileObjectNameOffsets[i] >= hdr.objectNamesSize)
+        {
+            MapFile::closeMAP(cache);
+            return false;
+        }
+    }
+
+    symbols.clear();
+    symbols.segs.assign(fileSegs, fileSegs + numSymbols);
+    symbols.addrs.assign(fileAddrs, fileAddrs + numSymbols);
+    symbols.nameOffsets.assign(fileNameOffsets, fileNameOffsets + numSymbols);
+    symbols.objectIds.assign(fileObjectIds, fileObjectIds + numSymbols);
+    symbols.types.assign(base + layout.types, base + layout.types + numSymbols);
+    symbols.strings.assign(fileNames, fileNames + hdr.namesSize);
+    // Interning in ID order gives back the same IDs
+    for (size_t i = 0; i < hdr.numObjects; i++)
+    {
+        const char * objectName = fileObjectNames + fileObjectNameOffsets[i];
+        symbols.objects.intern(objectName, strlen(objectName));
+    }
+
+    stats = MapFile::ParseStats();
+    stats.sections = (unsigned long)hdr.sections;
+    stats.invalidSyms = (unsigned long)hdr.invalidSyms;
+    stats.symbols = (unsigned long)numSymbols;
+
+    MapFile::closeMAP(cache);
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Writes symbols parsed from a MAP file into a cache file.
+///     The file is written under a temporary name and renamed when complete.
+/// @param cacheFileName Path name of the cache file.
+/// @param mapFileName Path name of the MAP file the symbols come from.
+/// @param map The MAP file content, used to make the cache verifiable.
+/// @param  minLineLen Minimal accepted length of line used while parsing
+/// @param numOfSegs Number of segments used while parsing
+/// @param symbols The parsed symbols
+/// @param stats The parsing totals
+/// @return True if the cache was written
+////////////////////////////////////////////////////////////////////////////////
+bool MapFile::saveSymbolCache(const char * cacheFileName, const char * mapFileName, const MapFile::MAPView &map,
+    size_t minLineLen, size_t numOfSegs, const MapFile::SymbolTable &symbols, const MapFile::ParseStats &stats)
+{
+    if (stats.usesHostSegments)
+        return false;
+
+    SymbolCacheHeader hdr;
+    memset(&hdr, 0, sizeof(hdr));
+    if (!describeSource(hdr, mapFileName, map, minLineLen, numOfSegs))
+        return false;
+
+    const size_t numSymbols = symbols.size();
+    std::vector<uint64_t> objectNameOffsets;
+    std::vector<char> objectNames;
+    for (unsigned id = 0; id < symbols.getNumObjects(); id++)
+    {
+        const char * objectName = symbols.getObjectName(id);
+        objectNameOffsets.push_back(objectNames.size());
+        objectNames.insert(objectNames.end(), objectName, objectName + strlen(objectName) + 1);
+    }
+
+    hdr.sections = stats.sections;
+    hdr.invalidSyms = stats.invalidSyms;
+    hdr.numSymbols = numSymbols;
+    hdr.numObjects = objectNameOffsets.size();
+    hdr.namesSize = symbols.strings.size();
+    hdr.objectNamesSize = objectNames.size();
+    const SymbolCacheLayout layout(hdr);
+
+    // Columns are stored with fixed widths, whatever unsigned long is here
+    const std::vector<uint64_t> fileSegs(symbols.segs.begin(), symbols.segs.end());
+    const std::vector<uint64_t> fileAddrs(symbols.addrs.begin(), symbols.addrs.end());
+    const std::vector<uint64_t> fileNameOffsets(symbols.nameOffsets.begin(), symbols.nameOffsets.end());
+    const std::vector<uint32_t> fileObjectIds(symbols.objectIds.begin(), symbols.objectIds.end());
+
+    const std::string tempFileName = std::string(cacheFileName) + ".tmp";
+    FILE * fp = fopen(tempFileName.c_str(), "wb");
+    if (fp == NULL)
+        return false;
+    uint64_t pos = 0;
+    bool written = writeBlock(fp, pos, 0, &hdr, sizeof(hdr)) &&
+        writeBlock(fp, pos, layout.segs, fileSegs.data(), numSymbols * sizeof(uint64_t)) &&
+        writeBlock(fp, pos, layout.addrs, fileAddrs.data(), numSymbols * sizeof(uint64_t)) &&
+        writeBlock(fp, pos, layout.nameOffsets, fileNameOffsets.data(), numSymbols * sizeof(uint64_t)) &&
+        writeBlock(fp, pos, layout.objectIds, fileObjectIds.data(), numSymbols * sizeof(uint32_t)) &&
+        writeBlock(fp, pos, layout.types, symbols.types.data(), numSymbols) &&
+        writeBlock(fp, pos, layout.names, symbols.strings.data(), symbols.strings.size()) &&
+        writeBlock(fp, pos, layout.objectNameOffsets, objectNameOffsets.data(), objectNameOffsets.size() * sizeof(uint64_t)) &&
+        writeBlock(fp, pos, layout.objectNames, objectNames.data(), objectNames.size()) &&
+        writeBlock(fp, pos, layout.fileSize, NULL, 0);
+    written = (fclose(fp) == 0) && written;
+
+    std::error_code err;
+    if (written)
+        std::filesystem::rename(tempFileName, cacheFileName, err);
+    if (!written || err)
+    {
+        std::filesystem::remove(tempFileName, err);
+        return false;
+    }
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Reads all symbol tables of a MAP file, using its symbol cache.
+///     Loads the cache next to the MAP file if it is up to date; otherwise
+///     parses the MAP file and writes a new cache.
+/// @param mapFileName Path name of the MAP file.
+/// @param map The MAP file content.
+/// @param  minLineLen Minimal accepted length of line
+/// @param numOfSegs Number of segments, used to verify segment number range
+/// @param symbols Receives symbols, in file order
+/// @param numThreads Amount of threads to parse with, 0 for one per CPU core
+/// @return Counters of parsed sections and symbols
+////////////////////////////////////////////////////////////////////////////////
+MapFile::ParseStats MapFile::parseSymbolsCached(const char * mapFileName, const MapFile::MAPView &map, size_t minLineLen,
+    size_t numOfSegs, MapFile::SymbolTable &symbols, unsigned numThreads)
+{
+    const std::string cacheFileName = std::string(mapFileName) + SYMBOL_CACHE_SUFFIX;
+    MapFile::ParseStats stats;
+    if (loadSymbolCache(cacheFileName.c_str(), mapFileName, map, minLineLen, numOfSegs, symbols, stats))
+        return stats;
+
+    symbols.clear();
+    stats = parseSymbols(map.addr, map.addr + map.size, minLineLen, numOfSegs, symbols, numThreads);
+    saveSymbolCache(cacheFileName.c_str(), mapFileName, map, minLineLen, numOfSegs, symbols, stats);
+    return stats;
+}
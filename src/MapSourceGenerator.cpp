@@ -29,6 +29,9 @@
 
 //  other headers.
 #include  "MAPReader.h"
+#include  "PseudocodeCache.h"
+#include  "SourceManifest.h"
+#include  "SourcePipeline.h"
 #include "stdafx.h"
 
 //#define USE_DANGEROUS_FUNCTIONS
@@ -45,9 +48,10 @@
 #include <fpro.h>
 #include <prodir.h> // just for MAXPATH
 #include <auto.hpp>
-#include <unordered_map>
-#include <iostream>
+#include <typeinf.hpp>
 #include <fstream>
+#include <iterator>
+#include <unordered_map>
 #include <filesystem>
 
 hexdsp_t* hexdsp = nullptr;
@@ -64,9 +68,13 @@ void linearAddressToSymbolAddr(MapFile::MAPSymbol &sym, unsigned long linear_add
 
 typedef struct _tagPLUGIN_OPTIONS {
     int bVerbose;      //< show detail messages
+    int bRecord;       //< save decompiler answers for replaying
+    int bIncremental;  //< decompile only functions changed since last run
+    int bUseCache;     //< take pseudocode from cache shared between databases
+    char szCacheFolder[MAXPATH]; //< folder of the cache; empty for one in user IDA dir
 } PLUGIN_OPTIONS;
 
-const size_t g_minLineLen = 14; // For a "xxxx:xxxxxxxx " line
+const size_t g_minLineLen = MapFile::DEFAULT_MIN_LINE_LEN;
 
 static char g_szIniPath[MAXPATH] = { 0 };
 
@@ -77,6 +85,10 @@ static PLUGIN_OPTIONS g_options = { 0 };
 static const cfgopt_t g_optsinfo[] =
 {
 	cfgopt_t("VERBOSE_MESSAGES", &g_options.bVerbose, 0, 1),
+	cfgopt_t("RECORD_PSEUDOCODE", &g_options.bRecord, 0, 1),
+	cfgopt_t("INCREMENTAL", &g_options.bIncremental, 0, 1),
+	cfgopt_t("USE_PSEUDOCODE_CACHE", &g_options.bUseCache, 0, 1),
+	cfgopt_t("PSEUDOCODE_CACHE_FOLDER", g_options.szCacheFolder, sizeof(g_options.szCacheFolder)),
 };
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -115,13 +127,20 @@ static void showOptionsDlg(void)
     const char format[] =
         "STARTITEM 0\n"                             // TabStop
         "MapSourceGen Options\n"                         // Title
-        "<Show verbose messages:C>>\n\n";           // Checkbox Button
+        "<Show verbose messages:C>\n"               // Checkbox Button
+        "<Record pseudocode for replaying:C>\n"    // Checkbox Button
+        "<Reuse sources of last run:C>\n"          // Checkbox Button
+        "<Use shared pseudocode cache:C>>\n\n";    // Checkbox Button
 
     // Create the option dialog.
-    short verbose = (g_options.bVerbose ? 1 : 0);
-    if (ask_form(format, &verbose))
+    short checks = (g_options.bVerbose ? 1 : 0) | (g_options.bRecord ? 2 : 0) |
+        (g_options.bIncremental ? 4 : 0) | (g_options.bUseCache ? 8 : 0);
+    if (ask_form(format, &checks))
     {
-        g_options.bVerbose = (1 == verbose);
+        g_options.bVerbose = ((checks & 1) != 0);
+        g_options.bRecord = ((checks & 2) != 0);
+        g_options.bIncremental = ((checks & 4) != 0);
+        g_options.bUseCache = ((checks & 8) != 0);
     }
 }
 
@@ -160,33 +179,183 @@ plugmod_t* idaapi init(void)
     return PLUGIN_SKIP;
 }
 
-std::string makeFileName(const char* libname)
-{
-    bool bIsCPP = true;
-    const char* extString = strstr(libname, ".cpp");
-    if (extString == nullptr) {
-        extString = strstr(libname, ".c");
-        bIsCPP = false;
-        if (extString == nullptr) {
-            return {};
+////////////////////////////////////////////////////////////////////////////////
+/// @brief IDA kernel and Hex-Rays as the backend of source generation.
+///     IDA kernel is not thread safe, so decompiling runs only on the
+///     thread which called run().
+////////////////////////////////////////////////////////////////////////////////
+class IdaBackend : public SourceGen::DecompilerBackend {
+public:
+    unsigned getMaxThreads() const override
+    {
+        return 1;
+    }
+
+    bool getSegmentStart(unsigned long seg, unsigned long long &startEa) override
+    {
+        segment_t* sseg = getnseg((int)seg);
+        if (sseg == nullptr) {
+            return false;
         }
+        startEa = sseg->start_ea;
+        return true;
     }
 
-    const char* stringBegin = extString;
-    --stringBegin;
-    while (true) {
-        if (*(stringBegin - 1) == '.' || *(stringBegin - 1) == ' ' || *(stringBegin - 1) == '\0' || (stringBegin - 1) < libname) {
-            break;
+    bool findFunction(unsigned long long ea, unsigned long long &startEa, unsigned long long &endEa) override
+    {
+        auto_make_proc((ea_t)ea);
+        auto_recreate_insn((ea_t)ea);
+
+        func_t *pfn = get_func((ea_t)ea);
+        if (pfn == nullptr) {
+            return false;
         }
+        startEa = pfn->start_ea;
+        endEa = pfn->end_ea;
+        return true;
+    }
 
-        --stringBegin;
+    bool readBytes(unsigned long long ea, size_t size, std::vector<unsigned char> &bytes) override
+    {
+        bytes.resize(size);
+        if (size == 0) {
+            return true;
+        }
+        return (get_bytes(bytes.data(), (ssize_t)size, (ea_t)ea) == (ssize_t)size);
     }
 
-    std::string outString = std::string(stringBegin, extString - stringBegin);
-    outString += (bIsCPP ? ".cpp" : ".c");
+    std::string getSettings() const override
+    {
+        // Version of the decompiler, processor and compiler of the database,
+        // and decompiler options from the configuration of IDA and of user
+        const char *version = get_hexrays_version();
+        std::string settings = (version != nullptr) ? version : "";
+        char buf[QMAXPATH];
+        qsnprintf(buf, sizeof(buf), " %.*s cc %X %X %X %X %X %X %X %X %X %X",
+            (int)sizeof(inf.procname), inf.procname, inf.cc.id, inf.cc.cm, inf.cc.size_i, inf.cc.size_b,
+            inf.cc.size_e, inf.cc.defalign, inf.cc.size_s, inf.cc.size_l, inf.cc.size_ll, inf.cc.size_ldbl);
+        settings += buf;
+        qmakepath(buf, sizeof(buf), idadir(CFG_SUBDIR), "hexrays.cfg", nullptr);
+        appendFileHash(settings, buf);
+        qmakepath(buf, sizeof(buf), get_user_idadir(), CFG_SUBDIR, "hexrays.cfg", nullptr);
+        appendFileHash(settings, buf);
+        return settings;
+    }
 
-    return outString;
-}
+    bool readNormalizedCode(unsigned long long ea, size_t size, std::vector<unsigned char> &code) override
+    {
+        if (!readBytes(ea, size, code)) {
+            return false;
+        }
+        qstring name;
+        get_name(&name, (ea_t)ea);
+        appendName(code, name);
+        appendType(code, (ea_t)ea);
+
+        // Operands referring to other addresses are zeroed, and names and
+        // types of their targets appended instead
+        const ea_t endEa = (ea_t)(ea + size);
+        insn_t insn;
+        for (ea_t insnEa = (ea_t)ea; insnEa < endEa; ) {
+            const int len = decode_insn(&insn, insnEa);
+            if (len <= 0) {
+                insnEa++;
+                continue;
+            }
+            const auto flags = get_flags(insnEa);
+            for (int n = 0; (n < UA_MAXOP) && (insn.ops[n].type != o_void); n++) {
+                const op_t &op = insn.ops[n];
+                ea_t target;
+                if ((op.type == o_near) || (op.type == o_far) || (op.type == o_mem)) {
+                    target = op.addr;
+                } else if ((op.type == o_imm) && (is_off(flags, n) || exists_fixup(insnEa + op.offb))) {
+                    target = (ea_t)op.value;
+                } else if ((op.type == o_displ) && (is_off(flags, n) || exists_fixup(insnEa + op.offb))) {
+                    target = op.addr;
+                } else {
+                    continue;
+                }
+                if (op.offb == 0) {
+                    continue;
+                }
+                // The operand lasts until the next one, or the instruction end
+                size_t opEnd = insn.size;
+                if ((n + 1 < UA_MAXOP) && (insn.ops[n + 1].type != o_void) && (insn.ops[n + 1].offb > op.offb)) {
+                    opEnd = insn.ops[n + 1].offb;
+                }
+                const size_t insnOffset = (size_t)(insnEa - (ea_t)ea);
+                for (size_t i = insnOffset + op.offb; (i < insnOffset + opEnd) && (i < size); i++) {
+                    code[i] = 0;
+                }
+                if (get_name(&name, target) <= 0) {
+                    name.sprnt("%llX", (unsigned long long)target);
+                }
+                appendName(code, name);
+                appendType(code, target);
+            }
+            insnEa += len;
+        }
+        return true;
+    }
+
+    void decompileBatch(const SourceGen::FunctionWork * funcs, size_t count, SourceGen::Pseudocode * results) override
+    {
+        qstring buf;
+        for (size_t i = 0; i < count; i++)
+        {
+            SourceGen::Pseudocode &code = results[i];
+            code.clear();
+            func_t *pfn = get_func((ea_t)funcs[i].ea);
+            if (pfn == nullptr) {
+                continue;
+            }
+
+            hexrays_failure_t hf;
+            cfuncptr_t cfunc = decompile(pfn, &hf, DECOMP_NO_WAIT);
+            if (cfunc == nullptr) {
+                continue;
+            }
+
+            const strvec_t& sv = cfunc->get_pseudocode();
+            code.reserve(sv.size());
+            for (const auto& line : sv) {
+                tag_remove(&buf, line.line);
+                code.emplace_back(buf.c_str(), buf.length());
+            }
+        }
+    }
+
+private:
+    static void appendName(std::vector<unsigned char> &code, const qstring &name)
+    {
+        code.insert(code.end(), name.c_str(), name.c_str() + name.length() + 1);
+    }
+
+    /// Appends declared type of an address; empty if it has none
+    static void appendType(std::vector<unsigned char> &code, ea_t ea)
+    {
+        qstring type;
+        if (!print_type(&type, ea, PRTYPE_1LINE)) {
+            type.clear();
+        }
+        appendName(code, type);
+    }
+
+    /// Appends hash of a configuration file; "-" if there is none
+    static void appendFileHash(std::string &settings, const char *fileName)
+    {
+        std::ifstream file(fileName, std::ios::in | std::ios::binary);
+        if (!file.is_open()) {
+            settings += " -";
+            return;
+        }
+        const std::string content((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        char buf[24];
+        qsnprintf(buf, sizeof(buf), " %016llX",
+            SourceGen::hashBytes(SourceGen::HASH_INITIAL, content.data(), content.size()));
+        settings += buf;
+    }
+};
 
 ////////////////////////////////////////////////////////////////////////////////
 /// @brief Plugin run function, which does the actual job
@@ -199,8 +368,6 @@ bool idaapi run(size_t)
 {
     static char mapFileName[_MAX_PATH] = { 0 };
 
-    std::unordered_map<std::string, std::fstream> filesMap;
-
     // If user press shift key, show options dialog
     if (GetAsyncKeyState(VK_SHIFT) & 0x8000)
     {
@@ -231,7 +398,9 @@ bool idaapi run(size_t)
     folderPath.append("sources/");
 
     std::error_code err;
-    std::filesystem::remove_all(folderPath, err);
+    if (!g_options.bIncremental) {
+        std::filesystem::remove_all(folderPath, err);
+    }
     std::filesystem::create_directory(folderPath, err);
     
     // Show open map file dialog
@@ -242,9 +411,8 @@ bool idaapi run(size_t)
         return false;
     }
 
-    char * pMapStart = NULL;
-	size_t mapSize = INVALID_MAPFILE_SIZE;
-	const MapFile::MAPResult eRet = MapFile::openMAP(mapFileName, pMapStart, mapSize);
+    MapFile::MAPView mapView;
+	const MapFile::MAPResult eRet = MapFile::openMAP(mapFileName, mapView);
 	switch (eRet) {
 	case MapFile::WIN32_ERROR:
 		printf("Could not open file '%s'.\n", mapFileName);
@@ -265,196 +433,52 @@ bool idaapi run(size_t)
 
     show_wait_box("Generating sources for '%s'", fname);
 
-	MapFile::SectionType sectnHdr = MapFile::NO_SECTION;
-	unsigned long sectnNumber = 0;
 	unsigned long generated = 0;
+	unsigned long reused = 0;
+	SourceGen::CacheStats cacheStats;
 	unsigned long invalidSyms = 0;
 
-	// The mark pointer to the end of memory map file
-	// all below code must not read or write at and over it
-	const char * pMapEnd = pMapStart + mapSize;
-
 	try
     {
-        const char * pLine = pMapStart;
-        const char * pEOL = pMapStart;
-        MapFile::MAPSymbol sym;
-        MapFile::MAPSymbol prvsym;
-        sym.seg = 16;
-        sym.addr = -1;
-        sym.name[0] = '\0';
-        bool inStaticsSection = false;
-
-        std::string curLibName = "";
-        bool curLibIsXboxLibrary = false;
-
-        while (pLine < pMapEnd)
-        {
-            // Skip the spaces, '\r', '\n' characters, blank lines, seek to the
-            // non space character at the beginning of a non blank line
-            pLine = MapFile::skipSpaces(pEOL, pMapEnd);
-
-            // Find the EOL '\r' or '\n' characters
-            pEOL = MapFile::findEOL(pLine, pMapEnd);
-
-            size_t lineLen = (size_t) (pEOL - pLine);
-            if (lineLen < 14)
-            {
-                continue;
-            }
-            char fmt[80];
-            fmt[0] = '\0';
-
-            // Check if we're on section header or section end
-            if (sectnHdr == MapFile::NO_SECTION)
-            {
-                sectnHdr = MapFile::recognizeSectionStart(pLine, lineLen);
-                if (sectnHdr != MapFile::NO_SECTION)
-                {
-                    sectnNumber++;
-                    qsnprintf(fmt, sizeof(fmt), "Section start line: '%%.%ds'.\n",  (int)lineLen);
-                    continue;
-                }
-            } else
-            {
-                sectnHdr = MapFile::recognizeSectionEnd(sectnHdr, pLine, lineLen);
-                if (sectnHdr == MapFile::NO_SECTION)
-                {
-                    qsnprintf(fmt, sizeof(fmt), "Section end line: '%%.%ds'.\n", (int)lineLen);
-                    continue;
-                }
-            }
-            MapFile::ParseResult parsed;
-            prvsym.seg = sym.seg;
-            prvsym.addr = sym.addr;
-            qstrncpy(prvsym.name, sym.name, sizeof(sym.name));
-            sym.seg = 16;
-            sym.addr = -1;
-            sym.name[0] = '\0';
-            parsed = MapFile::INVALID_LINE;
-
-            switch (sectnHdr)
-            {
-            case MapFile::NO_SECTION:
-                parsed = MapFile::SKIP_LINE;
-                break;
-            case MapFile::MSVC_MAP:
-            case MapFile::BCCL_NAM_MAP:
-            case MapFile::BCCL_VAL_MAP:
-                parsed = parseMsSymbolLine(sym,pLine,lineLen,14,9/*numOfSegs*/);
-                break;
-            case MapFile::WATCOM_MAP:
-                parsed = parseWatcomSymbolLine(sym,pLine,lineLen,14,9/*numOfSegs*/);
-                break;
-            case MapFile::GCC_MAP:
-                parsed = parseGccSymbolLine(sym,pLine,lineLen,14,9/*numOfSegs*/);
-                break;
-            }
-            
-            if (parsed == MapFile::STATICS_LINE)
-              inStaticsSection = true;
-
-            if (parsed == MapFile::SKIP_LINE || parsed == MapFile::STATICS_LINE)
-            {
-                qsnprintf(fmt, sizeof(fmt), "Skipping line: '%%.%ds'.\n",  (int)lineLen);
-                continue;
-            }
-            if (parsed == MapFile::FINISHING_LINE)
-            {
-                sectnHdr = MapFile::NO_SECTION;
-                // we have parsed to end of value/name symbols table or reached EOF
-                qsnprintf(fmt, sizeof(fmt), "Parsing finished at line: '%%.%ds'.\n",  (int)lineLen);
-                continue;
-            }
-            if (parsed == MapFile::INVALID_LINE)
-            {
-                invalidSyms++;
-                qsnprintf(fmt, sizeof(fmt), "Invalid map line: %%.%ds.\n",  (int)lineLen);
-                continue;
-            }
-
-            segment_t* seg = getnseg((int)sym.seg);
-            if (seg == nullptr) {
-                continue;
-            }
-
-            unsigned long la = sym.addr + seg->start_ea;
-            flags_t f = get_full_flags(la);
-            
-            curLibName = sym.libname;
-            curLibIsXboxLibrary = MapFile::isXboxLibraryFile(sym.libname);
-            if (sym.type == 'f') {
-                auto_make_proc(la);
-                auto_recreate_insn(la);
-
-                func_t *pfn = get_func(la);
-                if (pfn == nullptr) {
-                    continue;
-                }
-
-                hexrays_failure_t hf;
-                cfuncptr_t cfunc = decompile(pfn, &hf, DECOMP_NO_WAIT);
-                if (cfunc == nullptr) {
-                    continue;
-                }
-
-                const strvec_t& sv = cfunc->get_pseudocode();
-                if (sv.empty()) {
-                    continue;
-                }
-
-                std::string fileName = makeFileName(sym.libname);
-                if (!filesMap[fileName].is_open()) {
-                    std::string filePath = folderPath + fileName;
-                    filesMap[fileName].open(filePath, std::ios::out | std::ios::binary);
-                    if (!filesMap[fileName].is_open()) {
-                        continue;
-                    }
-                }
-
-                for (const auto& line : sv) {
-                    qstring buf;
-                    tag_remove(&buf, line.line);
-                    size_t begin_note_str = buf.find('\`');
-                    if (begin_note_str != size_t(-1) && begin_note_str != 0) {
-                        size_t end_note_str = buf.find('\'', begin_note_str + 1);
-                        if (end_note_str != size_t(-1)) {
-                            std::vector<size_t> vertices_to_delete;
-
-                            size_t counter = begin_note_str + 1;
-                            while (counter < buf.size()) {
-                                if (buf[counter] == '\'' || buf[counter] == '\`' || buf[counter] == '\0') {
-                                    break;
-                                }
-
-                                if (buf[counter] == ' ') {
-                                    vertices_to_delete.push_back(counter);
-                                }
-
-                                counter++;
-                            }
-
-                            if (end_note_str != size_t(-1)) {
-                                buf.remove(end_note_str, 1);
-                            }
-
-                            for (auto it = vertices_to_delete.cend(); it != vertices_to_delete.cbegin(); ) {
-                                --it;
-                                buf.remove(*it, 1);
-                            }
-
-                            buf.remove(begin_note_str, 1);
-                        }
-                    }
-
-                    filesMap[fileName] << buf.c_str();
-                    filesMap[fileName] << "\n";
-                }
-
-                filesMap[fileName] << "\n";
-
-                //cfunc.reset();
-                generated++;
+        MapFile::SymbolTable symbols;
+        const MapFile::ParseStats stats = MapFile::parseSymbolsCached(mapFileName, mapView, g_minLineLen, MapFile::DEFAULT_NUM_OF_SEGS, symbols, 0);
+        invalidSyms = stats.invalidSyms;
+
+        // Source lines, for "// file:line" markers before each function
+        std::vector<MapFile::MAPSection> sections;
+        MapFile::scanSections(mapView.addr, mapView.addr + mapView.size, g_minLineLen, sections);
+        MapFile::LineTable lineTable;
+        MapFile::parseLineNumbers(mapView.addr, mapView.addr + mapView.size, sections, lineTable);
+
+        std::string cacheFolder = g_options.szCacheFolder;
+        if (cacheFolder.empty()) {
+            cacheFolder = get_user_idadir();
+            cacheFolder.append("/mapsourcegen_cache");
+        }
+        cacheFolder.append("/");
+
+        IdaBackend idaBackend;
+        SourceGen::CachingBackend cache(idaBackend, cacheFolder);
+        SourceGen::DecompilerBackend &decompiler = g_options.bUseCache ? (SourceGen::DecompilerBackend &)cache : idaBackend;
+        SourceGen::RecordingBackend recorder(decompiler);
+        SourceGen::DecompilerBackend &backend = g_options.bRecord ? (SourceGen::DecompilerBackend &)recorder : decompiler;
+
+        std::vector<std::string> fileNames;
+        std::vector<SourceGen::FunctionWork> funcs;
+        SourceGen::buildWorkList(symbols, lineTable, backend, fileNames, funcs);
+        const SourceGen::PipelineStats pipelineStats = SourceGen::generateSources(funcs, fileNames, folderPath,
+            backend, 0, g_options.bIncremental != 0);
+        generated = pipelineStats.generated;
+        reused = pipelineStats.reused;
+        cacheStats = cache.getStats();
+
+        if (g_options.bRecord) {
+            // Answers of IDA, for replaying the generation without it
+            char recordFileName[_MAX_PATH];
+            qstrncpy(recordFileName, mapFileName, sizeof(recordFileName));
+            pathExtensionSwitch(recordFileName, ".pseudocode", sizeof(recordFileName));
+            if (!recorder.save(recordFileName)) {
+                msg("MapSourceGen: Could not write '%s'\n", recordFileName);
             }
         }
     }
@@ -464,12 +488,15 @@ bool idaapi run(size_t)
         invalidSyms++;
     }
 
-    MapFile::closeMAP(pMapStart);
-    filesMap.clear();
+    MapFile::closeMAP(mapView);
     
     hide_wait_box();
     
-    msg("results for %s file: \nGenerated function : %d\nInvalid symbols: %d", fname, generated, invalidSyms);
+    msg("results for %s file: \nGenerated function : %lu\nReused function : %lu\nInvalid symbols: %lu", fname, generated, reused, invalidSyms);
+    if (g_options.bUseCache) {
+        msg("\nPseudocode cache: %lu hits, %lu misses, %lu uncached, %lu not stored\n",
+            cacheStats.hits, cacheStats.misses, cacheStats.uncached, cacheStats.failedStores);
+    }
 
     return true;
 }
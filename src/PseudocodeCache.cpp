@@ -0,0 +1,208 @@
+////////////////////////////////////////////////////////////////////////////////
+/// @file PseudocodeCache.cpp
+///     Cache of decompiled functions, shared between databases.
+/// @par Purpose:
+///     Keeps pseudocode on disk under a hash of the function code, so that
+///     functions present in many builds of a program are decompiled once.
+/// @par  Copying and copyrights:
+///     This program is free software; you can redistribute it and/or modify
+///     it under the terms of the GNU General Public License as published by
+///     the Free Software Foundation; either version 2 of the License, or
+///     (at your option) any later version.
+////////////////////////////////////////////////////////////////////////////////
+
+#include  "PseudocodeCache.h"
+
+#include  <chrono>
+#include  <cstdio>
+#include  <filesystem>
+#include  <fstream>
+#include  <functional>
+#include  <thread>
+
+#include  "SourcePipeline.h"
+
+namespace {
+
+const char CACHE_HEADER[] = "MapSourceGen pseudocode 1";
+/// Initial value of the second hash, which is checked when reading
+const unsigned long long CHECK_INITIAL = 0x84222325CBF29CE4ULL;
+
+} // namespace
+
+SourceGen::CachingBackend::CachingBackend(SourceGen::DecompilerBackend &backend, const std::string &folderPath)
+    : backend(backend), folderPath(folderPath), settings(backend.getSettings()),
+    hits(0), misses(0), uncached(0), failedStores(0)
+{
+}
+
+SourceGen::CacheStats SourceGen::CachingBackend::getStats() const
+{
+    SourceGen::CacheStats stats;
+    stats.hits = hits;
+    stats.misses = misses;
+    stats.uncached = uncached;
+    stats.failedStores = failedStores;
+    return stats;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Finds where pseudocode of a function is stored.
+/// @return False if the function code could not be read
+////////////////////////////////////////////////////////////////////////////////
+bool SourceGen::CachingBackend::makeKey(const SourceGen::FunctionWork &func, CacheKey &key)
+{
+    std::vector<unsigned char> code;
+    if (!backend.readNormalizedCode(func.ea, (size_t)func.size, code))
+        return false;
+
+    unsigned long long hash = SourceGen::hashBytes(SourceGen::HASH_INITIAL, settings.c_str(), settings.size() + 1);
+    hash = SourceGen::hashBytes(hash, code.data(), code.size());
+    unsigned long long check = SourceGen::hashBytes(CHECK_INITIAL, settings.c_str(), settings.size() + 1);
+    check = SourceGen::hashBytes(check, code.data(), code.size());
+
+    char buf[80];
+    snprintf(buf, sizeof(buf), "%02X/%016llX.txt", (unsigned)(hash >> 56), hash);
+    key.path = folderPath + buf;
+    snprintf(buf, sizeof(buf), " %zX %016llX", code.size(), check);
+    key.header = CACHE_HEADER;
+    key.header += buf;
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Reads pseudocode of a function from the cache.
+/// @return False if there is no valid entry
+////////////////////////////////////////////////////////////////////////////////
+bool SourceGen::CachingBackend::loadEntry(const CacheKey &key, SourceGen::Pseudocode &code) const
+{
+    std::ifstream file(key.path, std::ios::in | std::ios::binary);
+    if (!file.is_open())
+        return false;
+    std::string line;
+    if (!std::getline(file, line) || (line != key.header))
+        return false;
+    code.clear();
+    while (std::getline(file, line))
+        code.push_back(line);
+    return !code.empty();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Writes pseudocode of a function into the cache.
+///     The entry is renamed into place when complete, so that readers never
+///     see a partial one.
+/// @return False if the entry could not be written
+////////////////////////////////////////////////////////////////////////////////
+bool SourceGen::CachingBackend::storeEntry(const CacheKey &key, const SourceGen::Pseudocode &code) const
+{
+    std::error_code err;
+    const std::filesystem::path entryPath(key.path);
+    std::filesystem::create_directories(entryPath.parent_path(), err);
+
+    // Unique among threads and runs which may store the same entry
+    char suffix[40];
+    const unsigned long long unique = std::hash<std::thread::id>()(std::this_thread::get_id()) ^
+        (unsigned long long)std::chrono::steady_clock::now().time_since_epoch().count();
+    snprintf(suffix, sizeof(suffix), ".%016llX.tmp", unique);
+    const std::string tempName = key.path + suffix;
+    {
+        std::ofstream file(tempName, std::ios::out | std::ios::binary);
+        if (!file.is_open())
+            return false;
+        file << key.header << "\n";
+        for (const std::string &line : code)
+            file << line << "\n";
+        file.close();
+        if (file.fail())
+        {
+            std::filesystem::remove(tempName, err);
+            return false;
+        }
+    }
+    std::filesystem::rename(tempName, entryPath, err);
+    if (err)
+    {
+        std::filesystem::remove(tempName, err);
+        return false;
+    }
+    return true;
+}
+
+unsigned SourceGen::CachingBackend::getMaxThreads() const
+{
+    return backend.getMaxThreads();
+}
+
+bool SourceGen::CachingBackend::getSegmentStart(unsigned long seg, unsigned long long &startEa)
+{
+    return backend.getSegmentStart(seg, startEa);
+}
+
+bool SourceGen::CachingBackend::findFunction(unsigned long long ea, unsigned long long &startEa, unsigned long long &endEa)
+{
+    return backend.findFunction(ea, startEa, endEa);
+}
+
+bool SourceGen::CachingBackend::readBytes(unsigned long long ea, size_t size, std::vector<unsigned char> &bytes)
+{
+    return backend.readBytes(ea, size, bytes);
+}
+
+std::string SourceGen::CachingBackend::getSettings() const
+{
+    return settings;
+}
+
+bool SourceGen::CachingBackend::readNormalizedCode(unsigned long long ea, size_t size, std::vector<unsigned char> &code)
+{
+    return backend.readNormalizedCode(ea, size, code);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Gets pseudocode of functions from the cache, decompiling the rest.
+///     Functions missing from the cache are given to the wrapped backend in
+///     one batch, and stored if decompiling succeeded.
+////////////////////////////////////////////////////////////////////////////////
+void SourceGen::CachingBackend::decompileBatch(const SourceGen::FunctionWork * funcs, size_t count, SourceGen::Pseudocode * results)
+{
+    std::vector<CacheKey> keys(count);
+    std::vector<bool> hasKey(count, false);
+    std::vector<size_t> missing;
+    for (size_t i = 0; i < count; i++)
+    {
+        hasKey[i] = makeKey(funcs[i], keys[i]);
+        if (!hasKey[i])
+        {
+            uncached++;
+            missing.push_back(i);
+        }
+        else if (loadEntry(keys[i], results[i]))
+        {
+            hits++;
+        }
+        else
+        {
+            misses++;
+            missing.push_back(i);
+        }
+    }
+    if (missing.empty())
+        return;
+
+    std::vector<SourceGen::FunctionWork> missingFuncs;
+    missingFuncs.reserve(missing.size());
+    for (size_t i : missing)
+        missingFuncs.push_back(funcs[i]);
+    std::vector<SourceGen::Pseudocode> missingCode(missing.size());
+    backend.decompileBatch(missingFuncs.data(), missingFuncs.size(), missingCode.data());
+
+    for (size_t k = 0; k < missing.size(); k++)
+    {
+        const size_t i = missing[k];
+        results[i] = std::move(missingCode[k]);
+        if (hasKey[i] && !results[i].empty() && !storeEntry(keys[i], results[i]))
+            failedStores++;
+    }
+}
+////////////////////////////////////////////////////////////////////////////////
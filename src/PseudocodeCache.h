@@ -0,0 +1,83 @@
+////////////////////////////////////////////////////////////////////////////////
+/// @file PseudocodeCache.h
+///     Cache of decompiled functions, shared between databases.
+/// @par Purpose:
+///     Keeps pseudocode on disk under a hash of the function code, so that
+///     functions present in many builds of a program are decompiled once.
+/// @par  Copying and copyrights:
+///     This program is free software; you can redistribute it and/or modify
+///     it under the terms of the GNU General Public License as published by
+///     the Free Software Foundation; either version 2 of the License, or
+///     (at your option) any later version.
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef PSEUDOCODECACHE_H_
+#define PSEUDOCODECACHE_H_
+
+#include  <atomic>
+#include  <string>
+#include  <vector>
+
+#include  "DecompilerBackend.h"
+
+namespace SourceGen {
+
+/// Totals gathered by CachingBackend.
+typedef struct {
+    /// Functions taken from the cache
+    unsigned long hits = 0;
+    /// Functions which were not in the cache, and were decompiled
+    unsigned long misses = 0;
+    /// Functions decompiled without using the cache, as their code could not be read
+    unsigned long uncached = 0;
+    /// Decompiled functions which could not be stored
+    unsigned long failedStores = 0;
+} CacheStats;
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Backend which takes pseudocode from a cache folder when it can.
+///     Entries are keyed by a hash of the decompiler settings and the
+///     normalized code of a function, and stored as "XX/hash.txt" text files;
+///     a second hash of the key in the first line guards against collisions.
+///     Failed decompilations are not stored. Entries are written through
+///     temporary files, so the folder may be shared by concurrent runs.
+///     Other calls are passed to the wrapped backend.
+////////////////////////////////////////////////////////////////////////////////
+class CachingBackend : public DecompilerBackend {
+public:
+    CachingBackend(SourceGen::DecompilerBackend &backend, const std::string &folderPath);
+
+    SourceGen::CacheStats getStats() const;
+
+    unsigned getMaxThreads() const override;
+    bool getSegmentStart(unsigned long seg, unsigned long long &startEa) override;
+    bool findFunction(unsigned long long ea, unsigned long long &startEa, unsigned long long &endEa) override;
+    bool readBytes(unsigned long long ea, size_t size, std::vector<unsigned char> &bytes) override;
+    std::string getSettings() const override;
+    bool readNormalizedCode(unsigned long long ea, size_t size, std::vector<unsigned char> &code) override;
+    void decompileBatch(const SourceGen::FunctionWork * funcs, size_t count, SourceGen::Pseudocode * results) override;
+
+private:
+    /// Where pseudocode of a function is stored
+    typedef struct {
+        std::string path;
+        /// First line of the entry
+        std::string header;
+    } CacheKey;
+
+    bool makeKey(const SourceGen::FunctionWork &func, CacheKey &key);
+    bool loadEntry(const CacheKey &key, SourceGen::Pseudocode &code) const;
+    bool storeEntry(const CacheKey &key, const SourceGen::Pseudocode &code) const;
+
+    SourceGen::DecompilerBackend &backend;
+    const std::string folderPath;
+    const std::string settings;
+    std::atomic<unsigned long> hits;
+    std::atomic<unsigned long> misses;
+    std::atomic<unsigned long> uncached;
+    std::atomic<unsigned long> failedStores;
+};
+
+};
+
+#endif // PSEUDOCODECACHE_H_
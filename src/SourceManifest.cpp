@@ -0,0 +1,400 @@
+////////////////////////////////////////////////////////////////////////////////
+/// @file SourceManifest.cpp
+///     Incremental generation of source files.
+/// @par Purpose:
+///     Remembers where text of each function went in generated files, so
+///     that following runs decompile only functions which changed.
+/// @par  Copying and copyrights:
+///     This program is free software; you can redistribute it and/or modify
+///     it under the terms of the GNU General Public License as published by
+///     the Free Software Foundation; either version 2 of the License, or
+///     (at your option) any later version.
+////////////////////////////////////////////////////////////////////////////////
+
+#include  "SourceManifest.h"
+
+#include  <cstdio>
+#include  <cstdlib>
+#include  <filesystem>
+#include  <fstream>
+#include  <memory>
+#include  <unordered_map>
+#include  <unordered_set>
+
+namespace {
+
+const char MANIFEST_HEADER[] = "MapSourceGen manifest 2";
+/// Size of a file which does not exist
+const unsigned long long NO_FILE_SIZE = ~0ULL;
+/// Index of a manifest entry which cannot be reused
+const size_t NO_ENTRY = ~(size_t)0;
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Gets size and hash of a file's contents.
+/// @return False if the file could not be read; size is then NO_FILE_SIZE
+////////////////////////////////////////////////////////////////////////////////
+bool hashFile(const std::string &filePath, unsigned long long &size, unsigned long long &hash)
+{
+    size = NO_FILE_SIZE;
+    hash = 0;
+    std::ifstream file(filePath, std::ios::in | std::ios::binary);
+    if (!file.is_open())
+        return false;
+    std::vector<char> buffer(1024 * 1024);
+    unsigned long long total = 0;
+    unsigned long long result = SourceGen::HASH_INITIAL;
+    while (file)
+    {
+        file.read(buffer.data(), (std::streamsize)buffer.size());
+        const size_t count = (size_t)file.gcount();
+        result = SourceGen::hashBytes(result, buffer.data(), count);
+        total += count;
+    }
+    if (!file.eof())
+        return false;
+    size = total;
+    hash = result;
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Reads hexadecimal numbers separated by spaces.
+/// @return Pointer after the last number, or NULL if some is missing
+////////////////////////////////////////////////////////////////////////////////
+const char * readManifestNumbers(const char * p, unsigned long long * values, size_t count)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        char * pEnd;
+        values[i] = std::strtoull(p, &pEnd, 16);
+        if ((pEnd == p) || ((*pEnd != ' ') && (*pEnd != '\0')))
+            return NULL;
+        p = pEnd;
+    }
+    return p;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Reads text of a function from a file made by earlier run.
+////////////////////////////////////////////////////////////////////////////////
+bool readOldText(std::ifstream &file, const SourceGen::TextLocation &location, std::string &text)
+{
+    text.resize((size_t)location.length);
+    file.clear();
+    file.seekg((std::streamoff)location.offset);
+    file.read(&text[0], (std::streamsize)location.length);
+    return (file.gcount() == (std::streamsize)location.length);
+}
+
+} // namespace
+
+void SourceGen::Manifest::clear()
+{
+    fileNames.clear();
+    fileSizes.clear();
+    fileHashes.clear();
+    entries.clear();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Reads manifest of earlier run.
+/// @param fileName Name of the manifest file
+/// @return False if the file is missing or not a valid manifest; the
+///     manifest is then empty
+////////////////////////////////////////////////////////////////////////////////
+bool SourceGen::Manifest::load(const std::string &fileName)
+{
+    clear();
+    std::ifstream file(fileName, std::ios::in | std::ios::binary);
+    if (!file.is_open())
+        return false;
+
+    std::string line;
+    bool valid = std::getline(file, line) && (line == MANIFEST_HEADER);
+    unsigned long long values[7];
+    while (valid && std::getline(file, line))
+    {
+        if ((line.size() < 2) || (line[1] != ' '))
+        {
+            valid = false;
+            break;
+        }
+        const char * pArgs = line.c_str() + 2;
+        const char * pEnd;
+        switch (line[0])
+        {
+        case 'T':
+            pEnd = readManifestNumbers(pArgs, values, 2);
+            valid = (pEnd != NULL) && (*pEnd == ' ') && entries.empty();
+            if (valid)
+            {
+                fileSizes.push_back(values[0]);
+                fileHashes.push_back(values[1]);
+                fileNames.emplace_back(pEnd + 1);
+            }
+            break;
+        case 'E':
+            pEnd = readManifestNumbers(pArgs, values, 7);
+            valid = (pEnd != NULL) && (*pEnd == '\0') && (values[4] < fileNames.size());
+            if (valid)
+            {
+                SourceGen::ManifestEntry entry;
+                entry.ea = values[0];
+                entry.size = values[1];
+                entry.hash = values[2];
+                entry.settings = values[3];
+                entry.fileIdx = (unsigned)values[4];
+                entry.location.offset = values[5];
+                entry.location.length = values[6];
+                entries.push_back(entry);
+            }
+            break;
+        default:
+            valid = false;
+            break;
+        }
+    }
+    if (!valid)
+        clear();
+    return valid;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Writes the manifest.
+///     A temporary file is written first, so that an interrupted run does
+///     not leave a damaged manifest.
+/// @param fileName Name of the manifest file
+/// @return False if the file could not be written
+////////////////////////////////////////////////////////////////////////////////
+bool SourceGen::Manifest::save(const std::string &fileName) const
+{
+    const std::string tempName = fileName + ".tmp";
+    {
+        std::ofstream file(tempName, std::ios::out | std::ios::binary);
+        if (!file.is_open())
+            return false;
+        char buf[160];
+        file << MANIFEST_HEADER << "\n";
+        for (size_t i = 0; i < fileNames.size(); i++)
+        {
+            snprintf(buf, sizeof(buf), "T %llX %llX ", fileSizes[i], fileHashes[i]);
+            file << buf << fileNames[i] << "\n";
+        }
+        for (const SourceGen::ManifestEntry &entry : entries)
+        {
+            snprintf(buf, sizeof(buf), "E %llX %llX %llX %llX %X %llX %llX\n", entry.ea, entry.size,
+                entry.hash, entry.settings, entry.fileIdx, entry.location.offset, entry.location.length);
+            file << buf;
+        }
+        file.close();
+        if (file.fail())
+            return false;
+    }
+    std::error_code err;
+    std::filesystem::rename(tempName, fileName, err);
+    if (err)
+    {
+        std::filesystem::remove(tempName, err);
+        return false;
+    }
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Generates source files, reusing output of earlier run.
+///     A function is reused if its address, size, hash and decompiler
+///     settings match the manifest, and its file was not changed since.
+///     Files in which all functions are reused, in the same order, are left
+///     as they are; other files are written again, with reused functions
+///     copied from the old files and the rest decompiled. The manifest is
+///     written in any case, so the following run may be incremental.
+/// @param funcs Work list of functions, made by buildWorkList()
+/// @param fileNames Names of output files, indexed by FunctionWork::fileId
+/// @param folderPath Folder for the files, with trailing separator
+/// @param backend The decompiler
+/// @param numThreads Threads to use, or 0 for all CPU cores
+/// @param incremental Whether to reuse output of earlier run; if not,
+///     all functions are decompiled
+/// @return Totals of the run
+////////////////////////////////////////////////////////////////////////////////
+SourceGen::PipelineStats SourceGen::generateSources(const std::vector<SourceGen::FunctionWork> &funcs,
+    const std::vector<std::string> &fileNames, const std::string &folderPath,
+    SourceGen::DecompilerBackend &backend, unsigned numThreads, bool incremental)
+{
+    const std::string settings = backend.getSettings();
+    const unsigned long long settingsHash = SourceGen::hashBytes(SourceGen::HASH_INITIAL, settings.data(), settings.size());
+    const std::string manifestPath = folderPath + MANIFEST_FILE_NAME;
+    SourceGen::Manifest old;
+    if (incremental)
+        old.load(manifestPath);
+
+    // Old files are used only if nobody changed them since; offsets of
+    // text are valid only while the contents are the same
+    std::vector<bool> oldFileValid(old.fileNames.size());
+    std::unordered_map<std::string, unsigned> oldFileIds;
+    for (unsigned idx = 0; idx < old.fileNames.size(); idx++)
+    {
+        unsigned long long size;
+        unsigned long long hash;
+        oldFileValid[idx] = (old.fileSizes[idx] != NO_FILE_SIZE) &&
+            hashFile(folderPath + old.fileNames[idx], size, hash) &&
+            (size == old.fileSizes[idx]) && (hash == old.fileHashes[idx]);
+        oldFileIds.emplace(old.fileNames[idx], idx);
+    }
+    // Symbols sharing an address are matched in order of the work list
+    std::unordered_map<unsigned long long, std::vector<size_t>> oldEntryIds;
+    std::vector<std::vector<size_t>> oldFileEntries(old.fileNames.size());
+    for (size_t idx = 0; idx < old.entries.size(); idx++)
+    {
+        oldEntryIds[old.entries[idx].ea].push_back(idx);
+        oldFileEntries[old.entries[idx].fileIdx].push_back(idx);
+    }
+
+    // Find functions which did not change
+    std::vector<size_t> reuseEntry(funcs.size(), NO_ENTRY);
+    std::vector<std::vector<size_t>> fileFuncs(fileNames.size());
+    std::unordered_map<unsigned long long, size_t> eaOccurrences;
+    for (size_t i = 0; i < funcs.size(); i++)
+    {
+        const SourceGen::FunctionWork &func = funcs[i];
+        if (func.fileId >= fileNames.size())
+            continue;
+        fileFuncs[func.fileId].push_back(i);
+        auto found = oldEntryIds.find(func.ea);
+        if (found == oldEntryIds.end())
+            continue;
+        const size_t occurrence = eaOccurrences[func.ea]++;
+        if ((func.hash == 0) || (occurrence >= found->second.size()))
+            continue;
+        const size_t entryIdx = found->second[occurrence];
+        const SourceGen::ManifestEntry &entry = old.entries[entryIdx];
+        if ((entry.hash == func.hash) && (entry.size == func.size) &&
+            (entry.settings == settingsHash) && oldFileValid[entry.fileIdx])
+        {
+            reuseEntry[i] = entryIdx;
+        }
+    }
+
+    // Files with the same functions in the same order are kept
+    std::vector<bool> keepFile(fileNames.size(), false);
+    for (unsigned fileId = 0; fileId < fileNames.size(); fileId++)
+    {
+        auto found = oldFileIds.find(fileNames[fileId]);
+        if ((found == oldFileIds.end()) || !oldFileValid[found->second] || fileFuncs[fileId].empty())
+            continue;
+        const std::vector<size_t> &oldEntries = oldFileEntries[found->second];
+        const std::vector<size_t> &newFuncs = fileFuncs[fileId];
+        bool same = (oldEntries.size() == newFuncs.size());
+        for (size_t k = 0; same && (k < newFuncs.size()); k++)
+            same = (reuseEntry[newFuncs[k]] == oldEntries[k]);
+        keepFile[fileId] = same;
+    }
+
+    // Other files are written again; text of unchanged functions is read
+    // before any of them is overwritten
+    SourceGen::PipelineStats stats;
+    std::vector<SourceGen::FunctionWork> rewritten;
+    std::vector<std::unique_ptr<std::ifstream>> oldFiles(old.fileNames.size());
+    for (size_t i = 0; i < funcs.size(); i++)
+    {
+        const SourceGen::FunctionWork &func = funcs[i];
+        if ((func.fileId >= fileNames.size()) || keepFile[func.fileId])
+            continue;
+        rewritten.push_back(func);
+        if (reuseEntry[i] == NO_ENTRY)
+            continue;
+        SourceGen::FunctionWork &work = rewritten.back();
+        const SourceGen::ManifestEntry &entry = old.entries[reuseEntry[i]];
+        work.reused = true;
+        if (entry.location.length == 0)
+            continue;
+        std::unique_ptr<std::ifstream> &file = oldFiles[entry.fileIdx];
+        if (!file)
+            file.reset(new std::ifstream(folderPath + old.fileNames[entry.fileIdx], std::ios::in | std::ios::binary));
+        if (!readOldText(*file, entry.location, work.text))
+        {
+            work.reused = false;
+            work.text.clear();
+        }
+    }
+    oldFiles.clear();
+
+    std::vector<SourceGen::TextLocation> locations;
+    if (!rewritten.empty())
+        stats = SourceGen::runPipeline(rewritten, fileNames, folderPath, backend, numThreads, true, &locations);
+    for (const SourceGen::FunctionWork &work : rewritten)
+    {
+        if (work.reused)
+            stats.reused++;
+    }
+
+    // Record where each function is now
+    SourceGen::Manifest manifest;
+    manifest.fileNames = fileNames;
+    manifest.fileSizes.resize(fileNames.size());
+    manifest.fileHashes.resize(fileNames.size());
+    std::vector<bool> fileWritten(fileNames.size(), false);
+    size_t rewrittenIdx = 0;
+    for (size_t i = 0; i < funcs.size(); i++)
+    {
+        const SourceGen::FunctionWork &func = funcs[i];
+        if (func.fileId >= fileNames.size())
+            continue;
+        SourceGen::ManifestEntry entry;
+        if (keepFile[func.fileId])
+        {
+            entry = old.entries[reuseEntry[i]];
+            stats.reused++;
+            if (entry.location.length > 0)
+                stats.generated++;
+        }
+        else
+        {
+            entry.ea = func.ea;
+            entry.size = func.size;
+            entry.hash = func.hash;
+            entry.settings = settingsHash;
+            entry.location = locations[rewrittenIdx++];
+        }
+        entry.fileIdx = func.fileId;
+        if (entry.location.length > 0)
+            fileWritten[func.fileId] = true;
+        manifest.entries.push_back(entry);
+    }
+    for (unsigned fileId = 0; fileId < fileNames.size(); fileId++)
+    {
+        if (keepFile[fileId])
+        {
+            // Checked above, and not written since
+            const unsigned oldIdx = oldFileIds[fileNames[fileId]];
+            manifest.fileSizes[fileId] = old.fileSizes[oldIdx];
+            manifest.fileHashes[fileId] = old.fileHashes[oldIdx];
+            stats.keptFiles++;
+            stats.files++;
+            continue;
+        }
+        hashFile(folderPath + fileNames[fileId], manifest.fileSizes[fileId], manifest.fileHashes[fileId]);
+    }
+
+    // Remove files which would be left from earlier run with stale text
+    std::error_code err;
+    std::unordered_set<std::string> currentNames(fileNames.begin(), fileNames.end());
+    for (const std::string &oldName : old.fileNames)
+    {
+        if (currentNames.find(oldName) == currentNames.end())
+            std::filesystem::remove(folderPath + oldName, err);
+    }
+    for (unsigned fileId = 0; fileId < fileNames.size(); fileId++)
+    {
+        if (!keepFile[fileId] && !fileWritten[fileId] && (manifest.fileSizes[fileId] != NO_FILE_SIZE))
+        {
+            std::filesystem::remove(folderPath + fileNames[fileId], err);
+            manifest.fileSizes[fileId] = NO_FILE_SIZE;
+            manifest.fileHashes[fileId] = 0;
+        }
+    }
+
+    manifest.save(manifestPath);
+    return stats;
+}
+////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,68 @@
+////////////////////////////////////////////////////////////////////////////////
+/// @file SourceManifest.h
+///     Incremental generation of source files.
+/// @par Purpose:
+///     Remembers where text of each function went in generated files, so
+///     that following runs decompile only functions which changed.
+/// @par  Copying and copyrights:
+///     This program is free software; you can redistribute it and/or modify
+///     it under the terms of the GNU General Public License as published by
+///     the Free Software Foundation; either version 2 of the License, or
+///     (at your option) any later version.
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef SOURCEMANIFEST_H_
+#define SOURCEMANIFEST_H_
+
+#include  <string>
+#include  <vector>
+
+#include  "SourcePipeline.h"
+
+/// Name of the manifest file, within folder of generated sources
+#define MANIFEST_FILE_NAME      ".mapsourcegen"
+
+namespace SourceGen {
+
+/// Function written by earlier run.
+typedef struct {
+    unsigned long long ea = 0;
+    unsigned long long size = 0;
+    /// FunctionWork::hash of the function
+    unsigned long long hash = 0;
+    /// Hash of decompiler settings
+    unsigned long long settings = 0;
+    /// Index into files of the manifest
+    unsigned fileIdx = 0;
+    /// Place of the text; zero length if decompiling failed
+    SourceGen::TextLocation location;
+} ManifestEntry;
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief List of generated files, and of functions within them.
+///     Stored as text: a "MapSourceGen manifest 2" header, then
+///     "T size hash name" for each file, then
+///     "E ea size hash settings file offset length" for each function,
+///     in order of the work list. Numbers are hexadecimal.
+////////////////////////////////////////////////////////////////////////////////
+class Manifest {
+public:
+    bool load(const std::string &fileName);
+    bool save(const std::string &fileName) const;
+    void clear();
+
+    std::vector<std::string> fileNames;
+    /// Size of each file when it was written
+    std::vector<unsigned long long> fileSizes;
+    /// Hash of contents of each file, by hashBytes()
+    std::vector<unsigned long long> fileHashes;
+    std::vector<SourceGen::ManifestEntry> entries;
+};
+
+SourceGen::PipelineStats generateSources(const std::vector<SourceGen::FunctionWork> &funcs,
+    const std::vector<std::string> &fileNames, const std::string &folderPath,
+    SourceGen::DecompilerBackend &backend, unsigned numThreads, bool incremental);
+
+};
+
+#endif // SOURCEMANIFEST_H_
@@ -0,0 +1,480 @@
+////////////////////////////////////////////////////////////////////////////////
+/// @file SourcePipeline.cpp
+///     Generation of source files from decompiled functions.
+/// @par Purpose:
+///     Runs decompiling, post-processing and writing of functions as
+///     separate stages, each on its own threads, connected by batches.
+/// @par  Copying and copyrights:
+///     This program is free software; you can redistribute it and/or modify
+///     it under the terms of the GNU General Public License as published by
+///     the Free Software Foundation; either version 2 of the License, or
+///     (at your option) any later version.
+////////////////////////////////////////////////////////////////////////////////
+
+#include  "SourcePipeline.h"
+#include  "SourceWriter.h"
+
+#include  <algorithm>
+#include  <climits>
+#include  <condition_variable>
+#include  <cstdio>
+#include  <cstring>
+#include  <deque>
+#include  <mutex>
+#include  <set>
+#include  <thread>
+#include  <unordered_map>
+
+namespace {
+
+const unsigned long long FNV_PRIME = 0x100000001B3ULL;
+
+/// Functions decompiled and written together, in work list order.
+typedef struct {
+    /// Output of the decompiler, released after post-processing
+    std::vector<SourceGen::Pseudocode> code;
+    /// Text to append to the file of each function; empty if it failed
+    std::vector<std::string> text;
+} PipelineBatch;
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief State shared by threads of runPipeline().
+///     Batches are decompiled in increasing order, post-processed in any
+///     order, and written in increasing order by whichever post-processing
+///     thread finds no other one writing. Decompiling stays at most
+///     PIPELINE_MAX_PENDING batches ahead of writing, which bounds memory.
+////////////////////////////////////////////////////////////////////////////////
+class Pipeline {
+public:
+    Pipeline(const std::vector<SourceGen::FunctionWork> &funcs, const std::vector<std::string> &fileNames,
+        const std::string &folderPath, SourceGen::DecompilerBackend &backend, bool backgroundIO,
+        std::vector<SourceGen::TextLocation> * locations)
+        : funcs(funcs), backend(backend), locations(locations),
+        batches((funcs.size() + PIPELINE_BATCH_SIZE - 1) / PIPELINE_BATCH_SIZE),
+        writer(folderPath, fileNames, backgroundIO)
+    {
+    }
+
+    void decompileLoop();
+    void processLoop();
+    void finish();
+
+    SourceGen::PipelineStats stats;
+
+private:
+    size_t batchBegin(size_t batchIdx) const { return batchIdx * PIPELINE_BATCH_SIZE; }
+    size_t batchSize(size_t batchIdx) const;
+    void processBatch(size_t batchIdx, unsigned long &failed);
+    void writeBatch(size_t batchIdx);
+
+    const std::vector<SourceGen::FunctionWork> &funcs;
+    SourceGen::DecompilerBackend &backend;
+    /// Where text of each function was written, if the caller wants it
+    std::vector<SourceGen::TextLocation> * locations;
+
+    std::vector<PipelineBatch> batches;
+    /// Output files; only used by the writing thread
+    SourceGen::SourceWriter writer;
+    /// Functions given to the writer
+    unsigned long appended = 0;
+
+    std::mutex lock;
+    std::condition_variable changed;
+    /// Next batch to decompile
+    size_t nextDecompile = 0;
+    /// Batches decompiled so far, whether processed or not
+    size_t numDecompiled = 0;
+    /// Next batch to write
+    size_t nextWrite = 0;
+    /// Decompiled batches waiting for post-processing
+    std::deque<size_t> decompiled;
+    /// Post-processed batches waiting for their turn to be written
+    std::set<size_t> processed;
+    bool writing = false;
+};
+
+size_t Pipeline::batchSize(size_t batchIdx) const
+{
+    const size_t begin = batchBegin(batchIdx);
+    return std::min((size_t)PIPELINE_BATCH_SIZE, funcs.size() - begin);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Decompiles batches until none is left; stage two of the pipeline.
+////////////////////////////////////////////////////////////////////////////////
+void Pipeline::decompileLoop()
+{
+    std::unique_lock<std::mutex> guard(lock);
+    for (;;)
+    {
+        // The batch to be written next is never held back, so waiting always ends
+        changed.wait(guard, [this] { return (nextDecompile >= batches.size()) || (nextDecompile < nextWrite + PIPELINE_MAX_PENDING); });
+        if (nextDecompile >= batches.size())
+            break;
+        const size_t batchIdx = nextDecompile++;
+        guard.unlock();
+
+        PipelineBatch &batch = batches[batchIdx];
+        batch.code.resize(batchSize(batchIdx));
+        const SourceGen::FunctionWork * func = funcs.data() + batchBegin(batchIdx);
+        // Functions with text kept from earlier run are skipped
+        for (size_t first = 0; first < batch.code.size(); )
+        {
+            if (func[first].reused)
+            {
+                first++;
+                continue;
+            }
+            size_t last = first + 1;
+            while ((last < batch.code.size()) && !func[last].reused)
+                last++;
+            backend.decompileBatch(func + first, last - first, batch.code.data() + first);
+            first = last;
+        }
+
+        guard.lock();
+        numDecompiled++;
+        decompiled.push_back(batchIdx);
+        changed.notify_all();
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Post-processes and writes batches until none is left; stage three.
+////////////////////////////////////////////////////////////////////////////////
+void Pipeline::processLoop()
+{
+    std::unique_lock<std::mutex> guard(lock);
+    for (;;)
+    {
+        changed.wait(guard, [this] { return !decompiled.empty() || (numDecompiled >= batches.size()); });
+        if (decompiled.empty())
+            break;
+        const size_t batchIdx = decompiled.front();
+        decompiled.pop_front();
+        guard.unlock();
+
+        unsigned long failed = 0;
+        processBatch(batchIdx, failed);
+
+        guard.lock();
+        stats.failed += failed;
+        processed.insert(batchIdx);
+        // Write every batch which is in turn, unless another thread already does
+        while (!writing && !processed.empty() && (*processed.begin() == nextWrite))
+        {
+            processed.erase(processed.begin());
+            writing = true;
+            guard.unlock();
+            writeBatch(nextWrite);
+            guard.lock();
+            writing = false;
+            nextWrite++;
+            changed.notify_all();
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Makes text of each function in a batch, as it will appear in file.
+////////////////////////////////////////////////////////////////////////////////
+void Pipeline::processBatch(size_t batchIdx, unsigned long &failed)
+{
+    PipelineBatch &batch = batches[batchIdx];
+    const SourceGen::FunctionWork * func = funcs.data() + batchBegin(batchIdx);
+    batch.text.resize(batch.code.size());
+    for (size_t i = 0; i < batch.code.size(); i++)
+    {
+        SourceGen::Pseudocode &code = batch.code[i];
+        std::string &text = batch.text[i];
+        if (func[i].reused)
+            text = func[i].text;
+        if (code.empty())
+        {
+            if (text.empty())
+                failed++;
+            continue;
+        }
+        if (!func[i].marker.empty())
+        {
+            text += func[i].marker;
+            text += '\n';
+        }
+        for (std::string &line : code)
+        {
+            SourceGen::cleanupPseudocodeLine(line);
+            text += line;
+            text += '\n';
+        }
+        text += '\n';
+    }
+    std::vector<SourceGen::Pseudocode>().swap(batch.code);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Appends functions of a batch to their files.
+///     Only one thread writes at a time, as the writer requires.
+////////////////////////////////////////////////////////////////////////////////
+void Pipeline::writeBatch(size_t batchIdx)
+{
+    PipelineBatch &batch = batches[batchIdx];
+    const SourceGen::FunctionWork * func = funcs.data() + batchBegin(batchIdx);
+    for (size_t i = 0; i < batch.text.size(); i++)
+    {
+        if (batch.text[i].empty())
+            continue;
+        const unsigned long long offset = writer.append(func[i].fileId, batch.text[i].data(), batch.text[i].size());
+        if (locations != nullptr)
+        {
+            SourceGen::TextLocation &location = (*locations)[batchBegin(batchIdx) + i];
+            location.offset = offset;
+            location.length = batch.text[i].size();
+        }
+        appended++;
+    }
+    std::vector<std::string>().swap(batch.text);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Writes what is left in buffers, and totals the run.
+///     Functions of files which failed are counted only then, as files are
+///     created when their text is written out.
+////////////////////////////////////////////////////////////////////////////////
+void Pipeline::finish()
+{
+    writer.finish();
+    const SourceGen::WriterStats &writerStats = writer.getStats();
+    stats.files = writerStats.files;
+    stats.unwritten = writerStats.unwritten;
+    stats.generated = appended - writerStats.unwritten;
+}
+
+} // namespace
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Adds bytes to a 64-bit FNV-1a hash.
+/// @param hash Hash of earlier data, or HASH_INITIAL
+/// @param data Bytes to add
+/// @param size Amount of bytes
+/// @return The updated hash
+////////////////////////////////////////////////////////////////////////////////
+unsigned long long SourceGen::hashBytes(unsigned long long hash, const void * data, size_t size)
+{
+    const unsigned char * p = (const unsigned char *)data;
+    for (size_t i = 0; i < size; i++)
+        hash = (hash ^ p[i]) * FNV_PRIME;
+    return hash;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Gets name of the source file an object was compiled from.
+/// @param objectName Object name from the MAP file, like "lib:file.cpp.obj"
+/// @return File name with .c or .cpp extension, or empty string if the
+///     object was not compiled from C/C++ source
+////////////////////////////////////////////////////////////////////////////////
+std::string SourceGen::makeFileName(const char * objectName)
+{
+    bool bIsCPP = true;
+    const char* extString = strstr(objectName, ".cpp");
+    if (extString == nullptr) {
+        extString = strstr(objectName, ".c");
+        bIsCPP = false;
+        if (extString == nullptr) {
+            return {};
+        }
+    }
+
+    const char* stringBegin = extString;
+    --stringBegin;
+    while (true) {
+        if (*(stringBegin - 1) == '.' || *(stringBegin - 1) == ' ' || *(stringBegin - 1) == '\0' || (stringBegin - 1) < objectName) {
+            break;
+        }
+
+        --stringBegin;
+    }
+
+    std::string outString = std::string(stringBegin, extString - stringBegin);
+    outString += (bIsCPP ? ".cpp" : ".c");
+
+    return outString;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Simplifies names quoted in `' within pseudocode line.
+///     Removes the quotes and spaces between them, so that names like
+///     "`vftable'" or "`string'" become identifiers. Every quoted name in
+///     the line is simplified; quotes do not nest, so a backtick within
+///     a name is removed as well. A backtick at start of the line, or one
+///     without closing quote after it, is left alone; names following a
+///     backtick at line start are still simplified.
+///     Runs in one pass over the line, moving text in place.
+/// @param line Line of pseudocode, without tags; modified in place
+////////////////////////////////////////////////////////////////////////////////
+void SourceGen::cleanupPseudocodeLine(std::string &line)
+{
+    const size_t size = line.size();
+    if (size < 2)
+        return;
+    char * const p = &line[0];
+    size_t in = 1;
+    size_t out = 1;
+    for (;;)
+    {
+        const char * pNote = (const char *)memchr(p + in, '`', size - in);
+        if (pNote == nullptr)
+            break;
+        const char * pNoteEnd = (const char *)memchr(pNote + 1, '\'', size - (size_t)(pNote + 1 - p));
+        if (pNoteEnd == nullptr)
+            break;
+        // Text up to the name is kept as it is
+        const size_t keep = (size_t)(pNote - p) - in;
+        if (out != in)
+            memmove(p + out, p + in, keep);
+        out += keep;
+        for (const char * pName = pNote + 1; pName < pNoteEnd; pName++)
+        {
+            if ((*pName != ' ') && (*pName != '`'))
+                p[out++] = *pName;
+        }
+        in = (size_t)(pNoteEnd + 1 - p);
+    }
+    if (out == in)
+        return;
+    memmove(p + out, p + in, size - in);
+    line.resize(out + size - in);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Lists functions to generate; stage one of source generation.
+///     Takes functions of objects compiled from C/C++ sources, making sure
+///     the backend knows each of them as a function. Each function gets
+///     a hash of its normalized code, name and marker, for telling whether
+///     output of an earlier run is still valid. Normalized code includes names
+///     of called functions and referenced data, so renaming them changes the
+///     hash of their users too. The hash is 0 if the code could not be read.
+/// @param symbols The symbol table
+/// @param lineTable Source lines, for markers before functions; may be empty
+/// @param backend The decompiler; only its lookups are used
+/// @param fileNames Receives names of output files
+/// @param funcs Receives the work list, in order of the symbol table
+/// @return Number of functions the backend did not find
+////////////////////////////////////////////////////////////////////////////////
+size_t SourceGen::buildWorkList(const MapFile::SymbolTable &symbols, const MapFile::LineTable &lineTable,
+    SourceGen::DecompilerBackend &backend, std::vector<std::string> &fileNames,
+    std::vector<SourceGen::FunctionWork> &funcs)
+{
+    fileNames.clear();
+    funcs.clear();
+
+    // Output file name depends only on the object, so work it out once
+    // per object; objects compiled from the same source share a file
+    std::vector<unsigned> objectFileIds(symbols.getNumObjects());
+    std::unordered_map<std::string, unsigned> fileIds;
+    for (unsigned id = 0; id < symbols.getNumObjects(); id++)
+    {
+        const std::string fileName = SourceGen::makeFileName(symbols.getObjectName(id));
+        if (fileName.empty())
+        {
+            objectFileIds[id] = UINT_MAX;
+            continue;
+        }
+        auto found = fileIds.emplace(fileName, (unsigned)fileNames.size());
+        if (found.second)
+            fileNames.push_back(fileName);
+        objectFileIds[id] = found.first->second;
+    }
+
+    size_t notFound = 0;
+    std::vector<MapFile::MAPLine> funcLines;
+    std::vector<unsigned char> funcCode;
+    for (size_t symIdx = 0; symIdx < symbols.size(); symIdx++)
+    {
+        if (symbols.getType(symIdx) != 'f')
+            continue;
+        const unsigned fileId = objectFileIds[symbols.getObjectId(symIdx)];
+        if (fileId == UINT_MAX)
+            continue;
+
+        unsigned long long segStart;
+        if (!backend.getSegmentStart(symbols.getSeg(symIdx), segStart))
+            continue;
+
+        const unsigned long long ea = segStart + symbols.getAddr(symIdx);
+        unsigned long long funcStart, funcEnd;
+        if (!backend.findFunction(ea, funcStart, funcEnd))
+        {
+            notFound++;
+            continue;
+        }
+
+        SourceGen::FunctionWork work;
+        work.ea = ea;
+        work.fileId = fileId;
+        const unsigned long funcSize = (unsigned long)(funcEnd - ea);
+        lineTable.findRange(symbols.getSeg(symIdx), symbols.getAddr(symIdx), symbols.getAddr(symIdx) + funcSize, funcLines);
+        if (!funcLines.empty())
+        {
+            work.marker = "// ";
+            work.marker += lineTable.getFileName(funcLines[0].fileId);
+            work.marker += ":";
+            work.marker += std::to_string(funcLines[0].line);
+        }
+        work.size = funcEnd - ea;
+        if (backend.readNormalizedCode(ea, (size_t)work.size, funcCode))
+        {
+            const char * name = symbols.getName(symIdx);
+            unsigned long long hash = SourceGen::hashBytes(SourceGen::HASH_INITIAL, funcCode.data(), funcCode.size());
+            hash = SourceGen::hashBytes(hash, name, strlen(name) + 1);
+            hash = SourceGen::hashBytes(hash, work.marker.c_str(), work.marker.size() + 1);
+            work.hash = (hash != 0) ? hash : 1;
+        }
+        funcs.push_back(std::move(work));
+    }
+    return notFound;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Decompiles functions and writes them into source files.
+///     Functions are written in order of the list, so output does not depend
+///     on the amount of threads. Decompiling runs on the calling thread, and
+///     on additional ones if the decompiler allows; post-processing and
+///     writing runs on separate threads.
+/// @param funcs Work list of functions, made by the caller
+/// @param fileNames Names of output files, indexed by FunctionWork::fileId
+/// @param folderPath Folder for the files, with trailing separator
+/// @param backend The decompiler
+/// @param numThreads Threads to use, or 0 for all CPU cores
+/// @param backgroundIO Whether to write files on a separate thread
+/// @param locations If not null, receives where text of each function was
+///     written; functions which were not written get zero length
+/// @return Totals of the run
+////////////////////////////////////////////////////////////////////////////////
+SourceGen::PipelineStats SourceGen::runPipeline(const std::vector<SourceGen::FunctionWork> &funcs,
+    const std::vector<std::string> &fileNames, const std::string &folderPath,
+    SourceGen::DecompilerBackend &backend, unsigned numThreads, bool backgroundIO,
+    std::vector<SourceGen::TextLocation> * locations)
+{
+    if (numThreads == 0)
+        numThreads = std::thread::hardware_concurrency();
+    if (numThreads == 0)
+        numThreads = 1;
+    const unsigned numDecompile = std::max(1u, std::min(numThreads, backend.getMaxThreads()));
+    // Post-processing gets the remaining threads, but always at least one
+    const unsigned numProcess = (numThreads > numDecompile) ? (numThreads - numDecompile) : 1;
+
+    if (locations != nullptr)
+        locations->assign(funcs.size(), SourceGen::TextLocation());
+    Pipeline pipeline(funcs, fileNames, folderPath, backend, backgroundIO, locations);
+    std::vector<std::thread> threads;
+    for (unsigned i = 0; i < numProcess; i++)
+        threads.emplace_back(&Pipeline::processLoop, &pipeline);
+    for (unsigned i = 1; i < numDecompile; i++)
+        threads.emplace_back(&Pipeline::decompileLoop, &pipeline);
+    pipeline.decompileLoop();
+    for (std::thread &thread : threads)
+        thread.join();
+    pipeline.finish();
+    return pipeline.stats;
+}
+////////////////////////////////////////////////////////////////////////////////
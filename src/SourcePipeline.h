@@ -0,0 +1,68 @@
+////////////////////////////////////////////////////////////////////////////////
+/// @file SourcePipeline.h
+///     Generation of source files from decompiled functions.
+/// @par Purpose:
+///     Decompiles a list of functions and writes their pseudocode into
+///     source files, with decompiling and writing done in parallel.
+/// @par  Copying and copyrights:
+///     This program is free software; you can redistribute it and/or modify
+///     it under the terms of the GNU General Public License as published by
+///     the Free Software Foundation; either version 2 of the License, or
+///     (at your option) any later version.
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef SOURCEPIPELINE_H_
+#define SOURCEPIPELINE_H_
+
+#include  <string>
+#include  <vector>
+
+#include  "DecompilerBackend.h"
+#include  "MAPReader.h"
+
+/// Amount of functions given to the decompiler at once
+#define PIPELINE_BATCH_SIZE     64
+/// Amount of decompiled batches which may wait for writing
+#define PIPELINE_MAX_PENDING    16
+
+namespace SourceGen {
+
+/// Totals gathered by runPipeline().
+typedef struct {
+    /// Functions written into files
+    unsigned long generated = 0;
+    /// Functions which the decompiler failed on
+    unsigned long failed = 0;
+    /// Functions lost because their file could not be created or written
+    unsigned long unwritten = 0;
+    /// Files created
+    unsigned long files = 0;
+    /// Functions with text kept from earlier run instead of decompiling
+    unsigned long reused = 0;
+    /// Files left as earlier run made them
+    unsigned long keptFiles = 0;
+} PipelineStats;
+
+/// Initial value for hashBytes()
+const unsigned long long HASH_INITIAL = 0xCBF29CE484222325ULL;
+
+/// Place of a function text within its file.
+typedef struct {
+    unsigned long long offset = 0;
+    unsigned long long length = 0;
+} TextLocation;
+
+unsigned long long hashBytes(unsigned long long hash, const void * data, size_t size);
+std::string makeFileName(const char * objectName);
+void cleanupPseudocodeLine(std::string &line);
+size_t buildWorkList(const MapFile::SymbolTable &symbols, const MapFile::LineTable &lineTable,
+    SourceGen::DecompilerBackend &backend, std::vector<std::string> &fileNames,
+    std::vector<SourceGen::FunctionWork> &funcs);
+SourceGen::PipelineStats runPipeline(const std::vector<SourceGen::FunctionWork> &funcs,
+    const std::vector<std::string> &fileNames, const std::string &folderPath,
+    SourceGen::DecompilerBackend &backend, unsigned numThreads = 0, bool backgroundIO = true,
+    std::vector<SourceGen::TextLocation> * locations = nullptr);
+
+};
+
+#endif // SOURCEPIPELINE_H_
@@ -0,0 +1,290 @@
+////////////////////////////////////////////////////////////////////////////////
+/// @file SourceWriter.cpp
+///     Buffered output of generated source files.
+/// @par Purpose:
+///     Collects text of many source files in memory, and writes it in large
+///     blocks while keeping only a few files open at a time.
+/// @par  Copying and copyrights:
+///     This program is free software; you can redistribute it and/or modify
+///     it under the terms of the GNU General Public License as published by
+///     the Free Software Foundation; either version 2 of the License, or
+///     (at your option) any later version.
+////////////////////////////////////////////////////////////////////////////////
+
+#include  "SourceWriter.h"
+
+#include  <algorithm>
+#include  <cstring>
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Prepares writing of files; none of them is created yet.
+/// @param folderPath Folder for the files, with trailing separator
+/// @param fileNames Names of files, indexed by ID given to append(); must
+///     stay valid until finish()
+/// @param backgroundIO Whether to write on a separate thread
+/// @param maxOpenFiles Limit of files open at the same time
+////////////////////////////////////////////////////////////////////////////////
+SourceGen::SourceWriter::SourceWriter(const std::string &folderPath, const std::vector<std::string> &fileNames,
+    bool backgroundIO, unsigned maxOpenFiles)
+    : folderPath(folderPath), fileNames(fileNames), maxOpenFiles(std::max(1u, maxOpenFiles)),
+    files(fileNames.size())
+{
+    if (backgroundIO)
+        ioThread = std::thread(&SourceWriter::ioLoop, this);
+}
+
+SourceGen::SourceWriter::~SourceWriter()
+{
+    finish();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Adds text at end of a file.
+/// @param fileId Index of the file name
+/// @param data Text to add
+/// @param size Length of the text
+/// @return Offset of the text within the file
+////////////////////////////////////////////////////////////////////////////////
+unsigned long long SourceGen::SourceWriter::append(unsigned fileId, const char * data, size_t size)
+{
+    if (finished)
+        return 0;
+    if (fileId >= files.size())
+    {
+        stats.unwritten++;
+        return 0;
+    }
+    FileState &state = files[fileId];
+    state.appends++;
+    const unsigned long long offset = state.size;
+    state.size += size;
+    Buffered &buffer = state.buffer;
+    while (size > 0)
+    {
+        if (buffer.chunks.empty() || (buffer.lastUsed == WRITER_CHUNK_SIZE))
+        {
+            if (buffer.chunks.size() >= WRITER_FLUSH_CHUNKS)
+                flushFile(fileId);
+            // Running out of chunks may flush this file as well
+            char * chunk = allocChunk();
+            buffer.chunks.push_back(chunk);
+            buffer.lastUsed = 0;
+        }
+        const size_t part = std::min(size, (size_t)WRITER_CHUNK_SIZE - buffer.lastUsed);
+        memcpy(buffer.chunks.back() + buffer.lastUsed, data, part);
+        buffer.lastUsed += part;
+        data += part;
+        size -= part;
+    }
+    return offset;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Writes all buffered text and closes the files.
+///     Further appends are ignored.
+////////////////////////////////////////////////////////////////////////////////
+void SourceGen::SourceWriter::finish()
+{
+    if (finished)
+        return;
+    finished = true;
+    for (unsigned fileId = 0; fileId < files.size(); fileId++)
+        flushFile(fileId);
+    if (ioThread.joinable())
+    {
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            stopIO = true;
+            changed.notify_all();
+        }
+        ioThread.join();
+    }
+
+    for (FileState &state : files)
+    {
+        if ((state.file != nullptr) && (fclose(state.file) != 0) && !state.failed)
+        {
+            state.failed = true;
+            stats.failedFiles++;
+        }
+        state.file = nullptr;
+        if (state.failed)
+            stats.unwritten += state.appends;
+    }
+    openFiles.clear();
+    for (char * chunk : freeChunks)
+        delete[] chunk;
+    freeChunks.clear();
+    numChunks = 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Gets an empty chunk from the pool.
+///     When the pool reaches WRITER_MAX_BUFFERED, the file with most
+///     buffered text is written out to free its chunks.
+////////////////////////////////////////////////////////////////////////////////
+char * SourceGen::SourceWriter::allocChunk()
+{
+    std::unique_lock<std::mutex> guard(lock);
+    for (;;)
+    {
+        if (!freeChunks.empty())
+        {
+            char * chunk = freeChunks.back();
+            freeChunks.pop_back();
+            return chunk;
+        }
+        if (numChunks < WRITER_MAX_BUFFERED / WRITER_CHUNK_SIZE)
+        {
+            numChunks++;
+            guard.unlock();
+            return new char[WRITER_CHUNK_SIZE];
+        }
+        guard.unlock();
+        flushLargest();
+        guard.lock();
+        // Chunks come back once the I/O thread writes them
+        if (ioThread.joinable())
+            changed.wait(guard, [this] { return !freeChunks.empty(); });
+    }
+}
+
+void SourceGen::SourceWriter::releaseChunks(std::vector<char *> &chunks)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    freeChunks.insert(freeChunks.end(), chunks.begin(), chunks.end());
+    chunks.clear();
+    changed.notify_all();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Hands buffered text of a file over for writing.
+////////////////////////////////////////////////////////////////////////////////
+void SourceGen::SourceWriter::flushFile(unsigned fileId)
+{
+    Buffered &buffer = files[fileId].buffer;
+    if (buffer.chunks.empty())
+        return;
+    WriteJob job;
+    job.fileId = fileId;
+    job.buffer = std::move(buffer);
+    buffer = Buffered();
+    if (ioThread.joinable())
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        jobs.push_back(std::move(job));
+        changed.notify_all();
+    }
+    else
+    {
+        writeJob(job);
+    }
+}
+
+void SourceGen::SourceWriter::flushLargest()
+{
+    unsigned largest = 0;
+    size_t largestChunks = 0;
+    for (unsigned fileId = 0; fileId < files.size(); fileId++)
+    {
+        if (files[fileId].buffer.chunks.size() > largestChunks)
+        {
+            largest = fileId;
+            largestChunks = files[fileId].buffer.chunks.size();
+        }
+    }
+    if (largestChunks > 0)
+        flushFile(largest);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Writes text of a file, and returns its chunks to the pool.
+///     Text of a file which failed is dropped.
+////////////////////////////////////////////////////////////////////////////////
+void SourceGen::SourceWriter::writeJob(WriteJob &job)
+{
+    FileState &state = files[job.fileId];
+    FILE * file = state.failed ? nullptr : openFile(job.fileId);
+    if (file != nullptr)
+    {
+        const std::vector<char *> &chunks = job.buffer.chunks;
+        for (size_t i = 0; i < chunks.size(); i++)
+        {
+            const size_t size = (i + 1 < chunks.size()) ? WRITER_CHUNK_SIZE : job.buffer.lastUsed;
+            stats.writes++;
+            if (fwrite(chunks[i], 1, size, file) != size)
+            {
+                fclose(file);
+                state.file = nullptr;
+                openFiles.erase(state.lruPos);
+                state.failed = true;
+                stats.failedFiles++;
+                break;
+            }
+            stats.bytes += size;
+        }
+    }
+    releaseChunks(job.buffer.chunks);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Gets open handle of a file, closing the least recently used one
+///     if too many are open.
+/// @return The handle, or nullptr if the file could not be opened
+////////////////////////////////////////////////////////////////////////////////
+FILE * SourceGen::SourceWriter::openFile(unsigned fileId)
+{
+    FileState &state = files[fileId];
+    if (state.file != nullptr)
+    {
+        openFiles.splice(openFiles.begin(), openFiles, state.lruPos);
+        return state.file;
+    }
+    if (openFiles.size() >= maxOpenFiles)
+    {
+        FileState &oldest = files[openFiles.back()];
+        if ((fclose(oldest.file) != 0) && !oldest.failed)
+        {
+            oldest.failed = true;
+            stats.failedFiles++;
+        }
+        oldest.file = nullptr;
+        openFiles.pop_back();
+    }
+
+    const std::string filePath = folderPath + fileNames[fileId];
+    state.file = fopen(filePath.c_str(), state.created ? "ab" : "wb");
+    if (state.file == nullptr)
+    {
+        state.failed = true;
+        stats.failedFiles++;
+        return nullptr;
+    }
+    // Writes are whole chunks already, stdio buffering would only copy them
+    setvbuf(state.file, nullptr, _IONBF, 0);
+    if (!state.created)
+    {
+        state.created = true;
+        stats.files++;
+    }
+    openFiles.push_front(fileId);
+    state.lruPos = openFiles.begin();
+    return state.file;
+}
+
+void SourceGen::SourceWriter::ioLoop()
+{
+    std::unique_lock<std::mutex> guard(lock);
+    for (;;)
+    {
+        changed.wait(guard, [this] { return !jobs.empty() || stopIO; });
+        if (jobs.empty())
+            break;
+        WriteJob job = std::move(jobs.front());
+        jobs.pop_front();
+        guard.unlock();
+        writeJob(job);
+        guard.lock();
+    }
+}
+////////////////////////////////////////////////////////////////////////////////
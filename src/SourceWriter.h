@@ -0,0 +1,123 @@
+////////////////////////////////////////////////////////////////////////////////
+/// @file SourceWriter.h
+///     Buffered output of generated source files.
+/// @par Purpose:
+///     Collects text of many source files in memory, and writes it in large
+///     blocks while keeping only a few files open at a time.
+/// @par  Copying and copyrights:
+///     This program is free software; you can redistribute it and/or modify
+///     it under the terms of the GNU General Public License as published by
+///     the Free Software Foundation; either version 2 of the License, or
+///     (at your option) any later version.
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef SOURCEWRITER_H_
+#define SOURCEWRITER_H_
+
+#include  <condition_variable>
+#include  <cstdio>
+#include  <deque>
+#include  <list>
+#include  <mutex>
+#include  <string>
+#include  <thread>
+#include  <vector>
+
+/// Size of buffer chunks, which are also the unit of writing
+#define WRITER_CHUNK_SIZE       (256*1024)
+/// Buffered chunks of one file which make it written out
+#define WRITER_FLUSH_CHUNKS     4
+/// Limit of memory for buffers of all files
+#define WRITER_MAX_BUFFERED     (64*1024*1024)
+/// Default limit of files open at the same time
+#define WRITER_MAX_OPEN_FILES   64
+
+namespace SourceGen {
+
+/// Totals gathered by SourceWriter.
+typedef struct {
+    /// Files created
+    unsigned long files = 0;
+    /// Files which could not be created or written
+    unsigned long failedFiles = 0;
+    /// Blocks given to append() for files which failed
+    unsigned long unwritten = 0;
+    /// Bytes written
+    unsigned long long bytes = 0;
+    /// Calls to fwrite()
+    unsigned long long writes = 0;
+} WriterStats;
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Writer of many files, with data appended in any order between them.
+///     Text of each file is kept in chunks taken from a shared pool, and the
+///     file is written when it gathers WRITER_FLUSH_CHUNKS chunks, or when
+///     the pool runs out. Files are created on first write and reopened for
+///     appending; the least recently written is closed when too many are open.
+///     Writing may be done on a background thread. append() must not be
+///     called from more than one thread at a time.
+////////////////////////////////////////////////////////////////////////////////
+class SourceWriter {
+public:
+    SourceWriter(const std::string &folderPath, const std::vector<std::string> &fileNames,
+        bool backgroundIO = false, unsigned maxOpenFiles = WRITER_MAX_OPEN_FILES);
+    ~SourceWriter();
+
+    unsigned long long append(unsigned fileId, const char * data, size_t size);
+    void finish();
+    const SourceGen::WriterStats &getStats() const { return stats; }
+
+private:
+    /// Text of a file waiting to be written; all chunks are full except the last
+    typedef struct {
+        std::vector<char *> chunks;
+        size_t lastUsed = 0;
+    } Buffered;
+
+    /// State of a file; buffer is used by the appending thread, the rest by writing
+    typedef struct {
+        Buffered buffer;
+        unsigned long appends = 0;
+        unsigned long long size = 0;
+        FILE * file = nullptr;
+        bool created = false;
+        bool failed = false;
+        std::list<unsigned>::iterator lruPos;
+    } FileState;
+
+    /// Text of a file handed over for writing
+    typedef struct {
+        unsigned fileId;
+        Buffered buffer;
+    } WriteJob;
+
+    char * allocChunk();
+    void releaseChunks(std::vector<char *> &chunks);
+    void flushFile(unsigned fileId);
+    void flushLargest();
+    void writeJob(WriteJob &job);
+    FILE * openFile(unsigned fileId);
+    void ioLoop();
+
+    const std::string folderPath;
+    const std::vector<std::string> &fileNames;
+    const unsigned maxOpenFiles;
+    std::vector<FileState> files;
+    /// Files currently open, most recently written first
+    std::list<unsigned> openFiles;
+    SourceGen::WriterStats stats;
+    bool finished = false;
+
+    /// Guards the pool and the job queue, shared with the I/O thread
+    std::mutex lock;
+    std::condition_variable changed;
+    std::vector<char *> freeChunks;
+    size_t numChunks = 0;
+    std::deque<WriteJob> jobs;
+    bool stopIO = false;
+    std::thread ioThread;
+};
+
+};
+
+#endif // SOURCEWRITER_H_
@@ -1,50 +1,130 @@
-#include <fstream>
-#include <unordered_map>
+#include <cstdlib>
+#include <filesystem>
+#include <string>
 #include <vector>
 
+#ifdef _WIN32
+#include <windows.h>
+#include <psapi.h>
+#pragma comment(lib, "psapi.lib")
+#else
+#include <sys/resource.h>
+#endif
+
 #include "../MAPReader.h"
+#include "../PseudocodeCache.h"
+#include "../SourceManifest.h"
+#include "../SourcePipeline.h"
 
 void linearAddressToSymbolAddr(MapFile::MAPSymbol &sym, unsigned long linear_addr)
 {
 	sym.addr = linear_addr;
 }
 
-std::unordered_map<std::string, std::vector<std::pair<uint64_t, std::string>>> sym_map;
-
-std::streampos fileSize(std::fstream& stream ){
+// Peak resident memory of this process, in kilobytes
+unsigned long long peakMemoryKB()
+{
+#ifdef _WIN32
+	PROCESS_MEMORY_COUNTERS counters;
+	if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+		return 0;
+	}
+	return counters.PeakWorkingSetSize / 1024;
+#else
+	struct rusage usage;
+	if (getrusage(RUSAGE_SELF, &usage) != 0) {
+		return 0;
+	}
+#ifdef __APPLE__
+	return (unsigned long long)usage.ru_maxrss / 1024;
+#else
+	return (unsigned long long)usage.ru_maxrss;
+#endif
+#endif
+}
 
-	std::streampos fsize = 0;
-	fsize = stream.tellg();
-	stream.seekg( 0, std::ios::end );
-	fsize = stream.tellg() - fsize;
-	stream.seekg( 0, std::ios::beg );
-	
-	return fsize;
+// Adds a path separator to a folder name, unless it ends with one
+std::string folderPath(const char* folder)
+{
+	std::string path = folder;
+	if (!path.empty() && (path.back() != '/') && (path.back() != '\\')) {
+		path += '/';
+	}
+	return path;
 }
 
-std::vector<char> fileData;
+void printUsage(const char* program)
+{
+	printf("Usage: %s [options] [map_file]\n"
+		"Parses map_file (test.map by default); '-' reads standard input, .gz and .zst files are decompressed.\n"
+		"  --threads N        parsing and generating threads, 0 for all CPU cores (default)\n"
+		"  --memory-budget MB fail if peak memory exceeds MB megabytes; 0 for no limit (default)\n"
+		"  --out DIR          generate sources into DIR\n"
+		"  --replay FILE      generate sources from pseudocode recorded by the IDA plugin,\n"
+		"                     instead of stub bodies\n"
+		"  --incremental      reuse sources generated into DIR by an earlier run\n"
+		"  --cache DIR        keep pseudocode in a cache shared between runs\n"
+		"  --help             show this help\n", program);
+}
 
 int main(int argc, char *argv[])
 {
-	const char* mapFile = "test.map";	
-	if (argc >= 2) {
-		mapFile = argv[1];
+	const char* mapFile = "test.map";
+	// Parsing threads, all CPU cores by default
+	unsigned numThreads = 0;
+	// Fail the run if peak memory exceeds this many megabytes; 0 for no limit
+	unsigned long long memoryBudgetMB = 0;
+	// Folder to generate sources into; none by default
+	std::string outputFolder;
+	// Pseudocode recorded by the IDA plugin, to generate sources from;
+	// without it, functions get stub bodies
+	std::string replayFile;
+	// Reuse sources generated into the folder by earlier run
+	bool incremental = false;
+	// Folder of pseudocode cache shared between runs; none by default
+	std::string cacheFolder;
+
+	bool hasMapFile = false;
+	for (int i = 1; i < argc; i++) {
+		const std::string arg = argv[i];
+		const bool hasValue = (i + 1 < argc);
+		if (arg == "--help") {
+			printUsage(argv[0]);
+			return 0;
+		} else if ((arg == "--threads") && hasValue) {
+			numThreads = (unsigned)std::strtoul(argv[++i], nullptr, 10);
+		} else if ((arg == "--memory-budget") && hasValue) {
+			memoryBudgetMB = std::strtoull(argv[++i], nullptr, 10);
+		} else if ((arg == "--out") && hasValue) {
+			outputFolder = folderPath(argv[++i]);
+		} else if ((arg == "--replay") && hasValue) {
+			replayFile = argv[++i];
+		} else if (arg == "--incremental") {
+			incremental = true;
+		} else if ((arg == "--cache") && hasValue) {
+			cacheFolder = folderPath(argv[++i]);
+		} else if (((arg.size() < 2) || (arg.compare(0, 2, "--") != 0)) && !hasMapFile) {
+			mapFile = argv[i];
+			hasMapFile = true;
+		} else {
+			printf("Invalid argument '%s'.\n", argv[i]);
+			printUsage(argv[0]);
+			return -1;
+		}
 	}
-
-	std::fstream file;
-	file.open(mapFile, std::ios::in | std::ios::binary);
-	if (!file.is_open()) {
-		printf("Can't open file %s. Aborting...", mapFile);
+	if ((incremental || !replayFile.empty() || !cacheFolder.empty()) && outputFolder.empty()) {
+		printf("Options --replay, --incremental and --cache need --out.\n");
+		printUsage(argv[0]);
 		return -1;
 	}
 
-	fileData.resize(fileSize(file));
-	file.read(fileData.data(), fileData.size());
-	file.close();
+	// Regular files are mapped without copying; pipes and compressed maps
+	// are parsed while reading, with bounded memory
+	const bool useStream = MapFile::MAPStream::requiresStream(mapFile);
 
-	char * pMapStart = NULL;
-	size_t mapSize = INVALID_MAPFILE_SIZE;
-	const MapFile::MAPResult eRet = MapFile::openMAP(mapFile, pMapStart, mapSize);
+	MapFile::MAPView mapView;
+	MapFile::MAPStream mapStream;
+	const MapFile::MAPResult eRet = useStream ? mapStream.open(mapFile) : MapFile::openMAP(mapFile, mapView);
 	switch (eRet) {
 	case MapFile::WIN32_ERROR:
 		printf("Could not open file '%s'.\n", mapFile);
@@ -63,125 +143,76 @@ int main(int argc, char *argv[])
 		break;
 	}
 
-	MapFile::SectionType sectnHdr = MapFile::NO_SECTION;
-	unsigned long sectnNumber = 0;
-	unsigned long validSyms = 0;
 	unsigned long invalidSyms = 0;
+	try
+	{
+		MapFile::SymbolTable symbols;
+		const MapFile::ParseStats stats = useStream ?
+			MapFile::parseSymbols(mapStream, MapFile::DEFAULT_MIN_LINE_LEN, MapFile::DEFAULT_NUM_OF_SEGS, symbols) :
+			MapFile::parseSymbolsCached(mapFile, mapView, MapFile::DEFAULT_MIN_LINE_LEN, MapFile::DEFAULT_NUM_OF_SEGS, symbols, numThreads);
+		invalidSyms = stats.invalidSyms;
+		if (mapStream.getResult() == MapFile::FILE_BINARY_ERROR) {
+			printf("File '%s' seem to be a binary or Unicode file", mapFile);
+			return -1;
+		}
+		if (mapStream.getResult() == MapFile::WIN32_ERROR) {
+			printf("Could not read whole file '%s'.\n", mapFile);
+			return -1;
+		}
+
+		if (!outputFolder.empty()) {
+			// Source lines are only read from mapped files
+			MapFile::LineTable lineTable;
+			if (!useStream) {
+				std::vector<MapFile::MAPSection> sections;
+				MapFile::scanSections(mapView.addr, mapView.addr + mapView.size, MapFile::DEFAULT_MIN_LINE_LEN, sections);
+				MapFile::parseLineNumbers(mapView.addr, mapView.addr + mapView.size, sections, lineTable);
+			}
+
+			SourceGen::StubBackend stubBackend;
+			SourceGen::ReplayBackend replayBackend;
+			if (!replayFile.empty() && !replayBackend.load(replayFile.c_str())) {
+				printf("Could not read pseudocode recording '%s'\n", replayFile.c_str());
+				return -1;
+			}
+			SourceGen::DecompilerBackend& decompiler = replayFile.empty() ?
+				(SourceGen::DecompilerBackend&)stubBackend : replayBackend;
+			SourceGen::CachingBackend cache(decompiler, cacheFolder);
+			SourceGen::DecompilerBackend& backend = cacheFolder.empty() ?
+				decompiler : (SourceGen::DecompilerBackend&)cache;
+
+			std::vector<std::string> fileNames;
+			std::vector<SourceGen::FunctionWork> funcs;
+			const size_t notFound = SourceGen::buildWorkList(symbols, lineTable, backend, fileNames, funcs);
+
+			std::error_code err;
+			std::filesystem::create_directories(outputFolder, err);
+			const SourceGen::PipelineStats genStats = SourceGen::generateSources(funcs, fileNames, outputFolder,
+				backend, numThreads, incremental);
+			printf("Generated %lu functions in %lu files, %lu failed, %lu unwritten, %zu not found\n",
+				genStats.generated, genStats.files, genStats.failed, genStats.unwritten, notFound);
+			printf("Reused %lu functions, kept %lu files\n", genStats.reused, genStats.keptFiles);
+			if (!cacheFolder.empty()) {
+				const SourceGen::CacheStats cacheStats = cache.getStats();
+				printf("Pseudocode cache: %lu hits, %lu misses, %lu uncached, %lu not stored\n",
+					cacheStats.hits, cacheStats.misses, cacheStats.uncached, cacheStats.failedStores);
+			}
+		}
+	}
+	catch (...)
+	{
+		printf("Exception while parsing MAP file");
+		invalidSyms++;
+	}
+
+	const unsigned long long bytesRead = useStream ? mapStream.getBytesRead() : mapView.size;
+	MapFile::closeMAP(mapView);
 
-	// The mark pointer to the end of memory map file
-	// all below code must not read or write at and over it
-	const char * pMapEnd = pMapStart + mapSize;
-
-	    try
-    {
-        const char * pLine = pMapStart;
-        const char * pEOL = pMapStart;
-        MapFile::MAPSymbol sym = {};
-        MapFile::MAPSymbol prvsym = {};
-        sym.seg = 16;
-        sym.addr = -1;
-        sym.name[0] = '\0';
-        bool inStaticsSection = false;
-
-        std::string curLibName = "";
-        bool curLibIsXboxLibrary = false;
-
-        while (pLine < pMapEnd)
-        {
-            // Skip the spaces, '\r', '\n' characters, blank lines, seek to the
-            // non space character at the beginning of a non blank line
-            pLine = MapFile::skipSpaces(pEOL, pMapEnd);
-
-            // Find the EOL '\r' or '\n' characters
-            pEOL = MapFile::findEOL(pLine, pMapEnd);
-
-            size_t lineLen = (size_t) (pEOL - pLine);
-            if (lineLen < 14)
-            {
-                continue;
-            }
-            char fmt[80];
-            fmt[0] = '\0';
-
-            // Check if we're on section header or section end
-            if (sectnHdr == MapFile::NO_SECTION)
-            {
-                sectnHdr = MapFile::recognizeSectionStart(pLine, lineLen);
-                if (sectnHdr != MapFile::NO_SECTION)
-                {
-                    sectnNumber++;
-                    snprintf(fmt, sizeof(fmt), "Section start line: '%%.%ds'.\n",  (int)lineLen);
-                    continue;
-                }
-            } else
-            {
-                sectnHdr = MapFile::recognizeSectionEnd(sectnHdr, pLine, lineLen);
-                if (sectnHdr == MapFile::NO_SECTION)
-                {
-                    snprintf(fmt, sizeof(fmt), "Section end line: '%%.%ds'.\n", (int)lineLen);
-                    continue;
-                }
-            }
-            MapFile::ParseResult parsed;
-            prvsym.seg = sym.seg;
-            prvsym.addr = sym.addr;
-            strncpy(prvsym.name, sym.name, sizeof(sym.name));
-            sym.seg = 16;
-            sym.addr = -1;
-            sym.name[0] = '\0';
-            parsed = MapFile::INVALID_LINE;
-
-            switch (sectnHdr)
-            {
-            case MapFile::NO_SECTION:
-                parsed = MapFile::SKIP_LINE;
-                break;
-            case MapFile::MSVC_MAP:
-            case MapFile::BCCL_NAM_MAP:
-            case MapFile::BCCL_VAL_MAP:
-                parsed = parseMsSymbolLine(sym,pLine,lineLen,14,9/*numOfSegs*/);
-                break;
-            case MapFile::WATCOM_MAP:
-                parsed = parseWatcomSymbolLine(sym,pLine,lineLen,14,9/*numOfSegs*/);
-                break;
-            case MapFile::GCC_MAP:
-                parsed = parseGccSymbolLine(sym,pLine,lineLen,14,9/*numOfSegs*/);
-                break;
-            }
-
-        	if (std::strstr(sym.libname, ".c") != nullptr) {
-        		sym_map[sym.libname].push_back({sym.addr, sym.name});
-        	}
-        	
-            if (parsed == MapFile::STATICS_LINE)
-              inStaticsSection = true;
-
-            if (parsed == MapFile::SKIP_LINE || parsed == MapFile::STATICS_LINE)
-            {
-                snprintf(fmt, sizeof(fmt), "Skipping line: '%%.%ds'.\n",  (int)lineLen);
-                continue;
-            }
-            if (parsed == MapFile::FINISHING_LINE)
-            {
-                sectnHdr = MapFile::NO_SECTION;
-                // we have parsed to end of value/name symbols table or reached EOF
-                snprintf(fmt, sizeof(fmt), "Parsing finished at line: '%%.%ds'.\n",  (int)lineLen);
-                continue;
-            }
-            if (parsed == MapFile::INVALID_LINE)
-            {
-                invalidSyms++;
-                snprintf(fmt, sizeof(fmt), "Invalid map line: %%.%ds.\n",  (int)lineLen);
-                continue;
-            }
-        }
-    }
-    catch (...)
-    {
-        printf("Exception while parsing MAP file");
-        invalidSyms++;
-    }
-
-	MapFile::closeMAP(pMapStart);
+	const unsigned long long peakKB = peakMemoryKB();
+	printf("Read %llu bytes, peak memory %llu KB\n", bytesRead, peakKB);
+	if ((memoryBudgetMB != 0) && (peakKB > memoryBudgetMB * 1024)) {
+		printf("Peak memory exceeds budget of %llu MB\n", memoryBudgetMB);
+		return -1;
+	}
 	return 0;
 }
\ No newline at end of file
@@ -0,0 +1,215 @@
+////////////////////////////////////////////////////////////////////////////////
+/// @file MsSymbolLineTest.cpp
+///     Differential test of MapFile::parseMsSymbolLine().
+/// @par Purpose:
+///     Compares the in-place parser with the istringstream based one it
+///     replaced, on a corpus of MSVC and Borland symbol lines and on random
+///     lines made of MAP file characters.
+/// @par  Copying and copyrights:
+///     This program is free software; you can redistribute it and/or modify
+///     it under the terms of the GNU General Public License as published by
+///     the Free Software Foundation; either version 2 of the License, or
+///     (at your option) any later version.
+////////////////////////////////////////////////////////////////////////////////
+
+#include  <cstdio>
+#include  <cstring>
+#include  <fstream>
+#include  <iterator>
+#include  <sstream>
+#include  <stdexcept>
+#include  <string>
+#include  <vector>
+
+#include  "../src/MAPReader.h"
+#include  "../src/stdafx.h"
+
+void linearAddressToSymbolAddr(MapFile::MAPSymbol &sym, unsigned long linear_addr)
+{
+    sym.addr = linear_addr;
+}
+
+namespace {
+
+/// Symbol read by the old parser; strings instead of MAPSymbol buffers,
+/// which the old parser could overflow
+typedef struct {
+    unsigned long seg = 0;
+    unsigned long addr = 0;
+    std::string name;
+    char type = 0;
+    std::string libname;
+} OldSymbol;
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief parseMsSymbolLine() as it was before parsing lines in place.
+///     Kept as the reference; only the output buffers differ.
+////////////////////////////////////////////////////////////////////////////////
+MapFile::ParseResult oldParseMsSymbolLine(OldSymbol &sym, const char *pLine, size_t lineLen, size_t minLineLen, size_t numOfSegs)
+{
+    // Skip any entrypoint / "static symbols" lines
+    const char* testStr = "entry point at";
+    if(strncasecmp(pLine, testStr, strlen(testStr)) == 0)
+      return MapFile::SKIP_LINE;
+    const char* testStr2 = "Static symbols";
+    if (strncasecmp(pLine, testStr2, strlen(testStr2)) == 0)
+      return MapFile::STATICS_LINE;
+
+    // Get segment number, address, name, by pass spaces at beginning,
+    // between ':' character, between address and name
+    size_t lineCut = lineLen;
+    if (lineCut > MAXNAMELEN + minLineLen)
+        lineCut = MAXNAMELEN + minLineLen;
+    std::string testLine((const char*)pLine, lineCut);
+
+    std::istringstream iss(testLine);
+    std::vector<std::string> results((std::istream_iterator<std::string>(iss)),
+      std::istream_iterator<std::string>());
+
+    // Parse line parts
+    if(results.size() < 3)
+      return MapFile::FINISHING_LINE; // Failed, we must have parsed to end of value/name symbols table or reached EOF
+
+    auto sepIdx = results[0].find(':');
+    sym.seg = std::stoi(results[0], 0, 0x10);
+    sym.addr = std::stoi(results[0].substr(sepIdx+1), 0, 0x10);
+
+    auto& name = results[1];
+    if (results.size() > 3)
+      sym.type = results[3].at(0);
+    else
+      sym.type = 0;
+
+    sym.name = name;
+
+    auto& libname = results[results.size() - 1];
+    if (libname.length())
+      sym.libname = libname;
+
+    if ((0 == sym.seg) || (--sym.seg >= numOfSegs) ||
+            ((unsigned long)-1 == sym.addr) || (sym.name.length() == 0) )
+    {
+        return MapFile::INVALID_LINE;
+    }
+    return MapFile::SYMBOL_LINE;
+}
+
+/// Totals of the comparison
+typedef struct {
+    unsigned long lines = 0;
+    unsigned long symbols = 0;
+    /// Lines on which the old parser threw, and the new one gives INVALID_LINE
+    unsigned long invalidArgs = 0;
+    /// Lines with offsets over INT_MAX, which only the new parser accepts
+    unsigned long wideOffsets = 0;
+    unsigned long failures = 0;
+} TestStats;
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Runs both parsers on a line and compares their results.
+/// @param what Where the line comes from, for messages
+////////////////////////////////////////////////////////////////////////////////
+void checkLine(const std::string &line, const char * what, TestStats &stats)
+{
+    stats.lines++;
+    MapFile::MAPSymbol sym;
+    const MapFile::ParseResult result = MapFile::parseMsSymbolLine(sym, line.c_str(), line.size(),
+        MapFile::DEFAULT_MIN_LINE_LEN, MapFile::DEFAULT_NUM_OF_SEGS);
+
+    OldSymbol oldSym;
+    MapFile::ParseResult oldResult;
+    try
+    {
+        oldResult = oldParseMsSymbolLine(oldSym, line.c_str(), line.size(),
+            MapFile::DEFAULT_MIN_LINE_LEN, MapFile::DEFAULT_NUM_OF_SEGS);
+    }
+    catch (const std::invalid_argument &)
+    {
+        // Aborted the whole parse before; now only the line is rejected
+        stats.invalidArgs++;
+        if (result != MapFile::INVALID_LINE)
+        {
+            printf("%s: expected INVALID_LINE, got %d: '%s'\n", what, (int)result, line.c_str());
+            stats.failures++;
+        }
+        return;
+    }
+    catch (const std::out_of_range &)
+    {
+        // Offsets which do not fit into int are read in full now
+        stats.wideOffsets++;
+        if ((result != MapFile::SYMBOL_LINE) && (result != MapFile::INVALID_LINE))
+        {
+            printf("%s: expected a symbol, got %d: '%s'\n", what, (int)result, line.c_str());
+            stats.failures++;
+        }
+        return;
+    }
+
+    bool same = (result == oldResult);
+    if (same && (result == MapFile::SYMBOL_LINE))
+    {
+        stats.symbols++;
+        // Fields are cut to the buffers of MAPSymbol
+        const std::string oldName = oldSym.name.substr(0, MAXNAMELEN);
+        const std::string oldLibname = oldSym.libname.substr(0, sizeof(sym.libname) - 1);
+        same = (sym.seg == oldSym.seg) && (sym.addr == oldSym.addr) && (sym.type == oldSym.type) &&
+            (oldName == sym.name) && (oldLibname == sym.libname);
+    }
+    if (!same)
+    {
+        printf("%s: results differ (%d vs old %d): '%s'\n", what, (int)result, (int)oldResult, line.c_str());
+        stats.failures++;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Makes a random line of characters which are common in MAP files.
+////////////////////////////////////////////////////////////////////////////////
+std::string randomLine(unsigned long long &seed)
+{
+    static const char CHARS[] = "0123456789ABCDEFabcdefx:  \t?@_$.+-fi";
+    seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+    const size_t length = (size_t)(seed >> 58);
+    std::string line;
+    for (size_t i = 0; i < length; i++)
+    {
+        seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+        line += CHARS[(seed >> 33) % (sizeof(CHARS) - 1)];
+    }
+    return line;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    if (argc < 2)
+    {
+        printf("Usage: %s corpus\n", argv[0]);
+        return 2;
+    }
+    std::ifstream corpus(argv[1], std::ios::in | std::ios::binary);
+    if (!corpus.is_open())
+    {
+        printf("Could not open corpus '%s'\n", argv[1]);
+        return 2;
+    }
+
+    TestStats stats;
+    std::string line;
+    while (std::getline(corpus, line))
+    {
+        if (!line.empty() && (line.back() == '\r'))
+            line.pop_back();
+        checkLine(line, "corpus", stats);
+    }
+
+    unsigned long long seed = 1;
+    for (unsigned long i = 0; i < 200000; i++)
+        checkLine(randomLine(seed), "random", stats);
+
+    printf("%lu lines, %lu symbols, %lu invalid numbers, %lu wide offsets, %lu failures\n",
+        stats.lines, stats.symbols, stats.invalidArgs, stats.wideOffsets, stats.failures);
+    return (stats.failures == 0) ? 0 : 1;
+}
@@ -0,0 +1,192 @@
+////////////////////////////////////////////////////////////////////////////////
+/// @file ParallelParseTest.cpp
+///     Tests of parsing MSVC symbol tables on worker threads.
+/// @par Purpose:
+///     Parses one MAP file with MapFile::parseSymbols() on a single thread and
+///     on several, and checks that symbol tables and totals are the same. The
+///     MAP is made by the test; its tables are large enough to be split into
+///     chunks, and each is ended by a line in the middle of a chunk.
+/// @par  Copying and copyrights:
+///     This program is free software; you can redistribute it and/or modify
+///     it under the terms of the GNU General Public License as published by
+///     the Free Software Foundation; either version 2 of the License, or
+///     (at your option) any later version.
+////////////////////////////////////////////////////////////////////////////////
+
+#include  <cstdio>
+#include  <cstring>
+#include  <string>
+
+#include  "../src/MAPReader.h"
+
+void linearAddressToSymbolAddr(MapFile::MAPSymbol &sym, unsigned long linear_addr)
+{
+    sym.addr = linear_addr;
+}
+
+namespace {
+
+/// Lines of each symbol table; over 16384, so tables are split between threads
+const unsigned long TABLE_LINES = 50000;
+
+/// Counts of lines put into the MAP, which parsing should report
+typedef struct {
+    unsigned long sections = 0;
+    unsigned long symbols = 0;
+    unsigned long invalidSyms = 0;
+} MapTotals;
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Adds a symbol table to the MAP.
+///     The table is ended by a line with two fields at finishAt; lines after it
+///     must be ignored, up to the header of next table.
+////////////////////////////////////////////////////////////////////////////////
+void addTable(std::string &map, unsigned long long &seed, unsigned long finishAt, MapTotals &totals)
+{
+    static const char * const OBJECTS[] = {
+        "game.obj", "render.obj", "D3D8:d3d8.obj", "libcmt:crt0.obj", "xapilib:file.obj", "ai.obj",
+    };
+    static const char * const TYPES[] = { " f  ", "    ", " f i" };
+    const size_t numObjects = sizeof(OBJECTS) / sizeof(OBJECTS[0]);
+
+    map += "  Address         Publics by Value              Rva+Base     Lib:Object\r\n\r\n";
+    totals.sections++;
+    bool finished = false;
+    char line[200];
+    for (unsigned long i = 0; i < TABLE_LINES; i++)
+    {
+        seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+        const unsigned long value = (unsigned long)(seed >> 33);
+        if (i == finishAt)
+        {
+            map += " 0001:00001000       _lonely_name\r\n";
+            finished = true;
+            continue;
+        }
+        if (i == TABLE_LINES / 2)
+        {
+            // Lines which neither end the table nor give symbols
+            map += "\r\n  entry point at        0001:00001234\r\n\r\n Static symbols\r\n\r\n";
+            continue;
+        }
+        // Segments 0 and 10 are out of range
+        unsigned long seg = 1 + value % 3;
+        if ((value % 97) == 0)
+            seg = 0;
+        else if ((value % 89) == 0)
+            seg = 10;
+        snprintf(line, sizeof(line), " %04lX:%08lX       ?func%lu@@YAXXZ           %08lX%s %s\r\n",
+            seg, value & 0xFFFFF, i, 0x10000 + (value & 0xFFFFF), TYPES[value % 3], OBJECTS[(value >> 8) % numObjects]);
+        map += line;
+        if (finished)
+            continue;
+        if ((seg == 0) || (seg > MapFile::DEFAULT_NUM_OF_SEGS))
+            totals.invalidSyms++;
+        else
+            totals.symbols++;
+    }
+    map += "\r\n";
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Makes a MAP file of two symbol tables, with other sections around.
+////////////////////////////////////////////////////////////////////////////////
+std::string makeMap(MapTotals &totals)
+{
+    std::string map = " game\r\n\r\n Timestamp is 3f1a2b3c (Mon Jul 21 10:00:00 2003)\r\n\r\n"
+        " Preferred load address is 00010000\r\n\r\n"
+        " Start         Length     Name                   Class\r\n"
+        " 0001:00000000 00100000H .text                   CODE\r\n\r\n";
+    unsigned long long seed = 1;
+    // Threads used by the test cut tables into 8 to 24 chunks; neither table
+    // ends at a chunk boundary
+    addTable(map, seed, 31000, totals);
+    addTable(map, seed, 10001, totals);
+    map += "Line numbers for .\\Release\\game.obj(c:\\src\\game.cpp) segment .text\r\n\r\n"
+        "    10 0001:00001000    11 0001:00001010\r\n";
+    return map;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Compares two symbol tables, column by column.
+/// @return Index of the first symbol which differs, or -1 if there is none
+////////////////////////////////////////////////////////////////////////////////
+size_t findDifference(const MapFile::SymbolTable &expected, const MapFile::SymbolTable &symbols)
+{
+    const size_t count = (expected.size() < symbols.size()) ? expected.size() : symbols.size();
+    for (size_t i = 0; i < count; i++)
+    {
+        if ((expected.getSeg(i) != symbols.getSeg(i)) || (expected.getAddr(i) != symbols.getAddr(i)) ||
+            (expected.getType(i) != symbols.getType(i)) ||
+            (expected.getObjectId(i) != symbols.getObjectId(i)) ||
+            (strcmp(expected.getName(i), symbols.getName(i)) != 0) ||
+            (strcmp(expected.getLibname(i), symbols.getLibname(i)) != 0))
+        {
+            return i;
+        }
+    }
+    if (expected.size() != symbols.size())
+        return count;
+    if (expected.getNumObjects() != symbols.getNumObjects())
+        return 0;
+    for (unsigned id = 0; id < expected.getNumObjects(); id++)
+    {
+        if (strcmp(expected.getObjectName(id), symbols.getObjectName(id)) != 0)
+            return 0;
+    }
+    return (size_t)-1;
+}
+
+bool sameStats(const MapFile::ParseStats &expected, const MapFile::ParseStats &stats)
+{
+    return (expected.sections == stats.sections) && (expected.symbols == stats.symbols) &&
+        (expected.invalidSyms == stats.invalidSyms) && (expected.usesHostSegments == stats.usesHostSegments);
+}
+
+} // namespace
+
+int main()
+{
+    MapTotals totals;
+    const std::string map = makeMap(totals);
+    const char * pStart = map.c_str();
+    const char * pEnd = pStart + map.size();
+
+    unsigned long failures = 0;
+    MapFile::SymbolTable serial;
+    const MapFile::ParseStats serialStats = MapFile::parseSymbols(pStart, pEnd,
+        MapFile::DEFAULT_MIN_LINE_LEN, MapFile::DEFAULT_NUM_OF_SEGS, serial, 1);
+    if ((serialStats.sections != totals.sections) || (serialStats.symbols != totals.symbols) ||
+        (serialStats.invalidSyms != totals.invalidSyms) || (serial.size() != totals.symbols))
+    {
+        printf("1 thread: expected %lu sections, %lu symbols, %lu invalid; got %lu, %lu (%zu in table), %lu\n",
+            totals.sections, totals.symbols, totals.invalidSyms,
+            serialStats.sections, serialStats.symbols, serial.size(), serialStats.invalidSyms);
+        failures++;
+    }
+
+    static const unsigned THREADS[] = { 2, 3, 4, 8, 16 };
+    for (unsigned numThreads : THREADS)
+    {
+        MapFile::SymbolTable symbols;
+        const MapFile::ParseStats stats = MapFile::parseSymbols(pStart, pEnd,
+            MapFile::DEFAULT_MIN_LINE_LEN, MapFile::DEFAULT_NUM_OF_SEGS, symbols, numThreads);
+        if (!sameStats(serialStats, stats))
+        {
+            printf("%u threads: got %lu sections, %lu symbols, %lu invalid; 1 thread got %lu, %lu, %lu\n",
+                numThreads, stats.sections, stats.symbols, stats.invalidSyms,
+                serialStats.sections, serialStats.symbols, serialStats.invalidSyms);
+            failures++;
+        }
+        const size_t idx = findDifference(serial, symbols);
+        if (idx != (size_t)-1)
+        {
+            printf("%u threads: symbol tables differ at %zu (%zu vs %zu symbols, %zu vs %zu objects)\n",
+                numThreads, idx, symbols.size(), serial.size(), symbols.getNumObjects(), serial.getNumObjects());
+            failures++;
+        }
+    }
+
+    printf("%zu symbols, %lu invalid, %lu failures\n", serial.size(), serialStats.invalidSyms, failures);
+    return (failures == 0) ? 0 : 1;
+}
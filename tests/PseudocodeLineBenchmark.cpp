@@ -0,0 +1,123 @@
+////////////////////////////////////////////////////////////////////////////////
+/// @file PseudocodeLineBenchmark.cpp
+///     Micro-benchmark of SourceGen::cleanupPseudocodeLine().
+/// @par Purpose:
+///     Times cleaning of realistic pseudocode lines, against the algorithm
+///     used before, which erased quotes and spaces one at a time.
+/// @par  Copying and copyrights:
+///     This program is free software; you can redistribute it and/or modify
+///     it under the terms of the GNU General Public License as published by
+///     the Free Software Foundation; either version 2 of the License, or
+///     (at your option) any later version.
+////////////////////////////////////////////////////////////////////////////////
+
+#include  <chrono>
+#include  <cstdio>
+#include  <cstdlib>
+#include  <string>
+#include  <vector>
+
+#include  "../src/SourcePipeline.h"
+
+void linearAddressToSymbolAddr(MapFile::MAPSymbol &sym, unsigned long linear_addr)
+{
+    sym.addr = linear_addr;
+}
+
+namespace {
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief cleanupPseudocodeLine() as it was before the single pass.
+////////////////////////////////////////////////////////////////////////////////
+void oldCleanupPseudocodeLine(std::string &line)
+{
+    const size_t beginNote = line.find('`');
+    if ((beginNote == std::string::npos) || (beginNote == 0))
+        return;
+    const size_t endNote = line.find('\'', beginNote + 1);
+    if (endNote == std::string::npos)
+        return;
+
+    std::vector<size_t> spaces;
+    for (size_t i = beginNote + 1; i < line.size(); i++)
+    {
+        if ((line[i] == '\'') || (line[i] == '`') || (line[i] == '\0'))
+            break;
+        if (line[i] == ' ')
+            spaces.push_back(i);
+    }
+
+    line.erase(endNote, 1);
+    for (auto it = spaces.crbegin(); it != spaces.crend(); ++it)
+        line.erase(*it, 1);
+    line.erase(beginNote, 1);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Makes lines like those of decompiled MSVC programs; most have no
+///     quoted name, some have MSVC special names, a few very long ones.
+////////////////////////////////////////////////////////////////////////////////
+std::vector<std::string> makeLines(size_t count)
+{
+    static const char * const SAMPLES[] = {
+        "  v3 = *(_DWORD *)(a1 + 8);",
+        "  if ( !sub_401000(v5, 16) )",
+        "  *(_DWORD *)this = &CGame::`vftable';",
+        "  v7 = `anonymous namespace'::g_table[v2];",
+        "void __fastcall `dynamic initializer for 'g_manager''()",
+        "  return `vector deleting destructor'(this, 1);",
+        "  }",
+        "  v2 = (int)&`string';",
+    };
+    const size_t numSamples = sizeof(SAMPLES) / sizeof(SAMPLES[0]);
+    std::vector<std::string> lines;
+    lines.reserve(count);
+    for (size_t i = 0; i < count; i++)
+    {
+        if ((i % 1000) == 999)
+            lines.push_back("  v1 = `" + std::string(2000, ' ') + "padded name';");
+        else
+            lines.push_back(SAMPLES[i % numSamples]);
+    }
+    return lines;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Cleans copies of the lines, a few times over.
+/// @return Time taken, in milliseconds
+////////////////////////////////////////////////////////////////////////////////
+double timeCleanup(const std::vector<std::string> &lines, void (*cleanup)(std::string &), size_t &totalSize)
+{
+    const int ROUNDS = 5;
+    totalSize = 0;
+    const auto start = std::chrono::steady_clock::now();
+    for (int round = 0; round < ROUNDS; round++)
+    {
+        for (const std::string &source : lines)
+        {
+            std::string line = source;
+            cleanup(line);
+            totalSize += line.size();
+        }
+    }
+    const auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::milli>(end - start).count() / ROUNDS;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    size_t count = 200000;
+    if (argc >= 2)
+        count = (size_t)std::strtoul(argv[1], nullptr, 10);
+
+    const std::vector<std::string> lines = makeLines(count);
+    size_t newSize;
+    size_t oldSize;
+    const double newTime = timeCleanup(lines, SourceGen::cleanupPseudocodeLine, newSize);
+    const double oldTime = timeCleanup(lines, oldCleanupPseudocodeLine, oldSize);
+    printf("%zu lines: %.1f ms, before %.1f ms (%zu / %zu bytes out)\n",
+        lines.size(), newTime, oldTime, newSize, oldSize);
+    return 0;
+}
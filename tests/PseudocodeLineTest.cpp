@@ -0,0 +1,151 @@
+////////////////////////////////////////////////////////////////////////////////
+/// @file PseudocodeLineTest.cpp
+///     Tests of SourceGen::cleanupPseudocodeLine().
+/// @par Purpose:
+///     Checks golden cases of simplifying `' quoted names, and compares lines
+///     with one quoted name against the algorithm used before, which only
+///     handled the first name of a line.
+/// @par  Copying and copyrights:
+///     This program is free software; you can redistribute it and/or modify
+///     it under the terms of the GNU General Public License as published by
+///     the Free Software Foundation; either version 2 of the License, or
+///     (at your option) any later version.
+////////////////////////////////////////////////////////////////////////////////
+
+#include  <cstdio>
+#include  <string>
+#include  <vector>
+
+#include  "../src/SourcePipeline.h"
+
+void linearAddressToSymbolAddr(MapFile::MAPSymbol &sym, unsigned long linear_addr)
+{
+    sym.addr = linear_addr;
+}
+
+namespace {
+
+/// Line given to cleanupPseudocodeLine(), and the line expected from it
+typedef struct {
+    const char * line;
+    const char * expected;
+} GoldenCase;
+
+const GoldenCase GOLDEN_CASES[] = {
+    { "", "" },
+    { "`", "`" },
+    { "int a;", "int a;" },
+    { "a`'", "a" },
+    // Names made by MSVC
+    { "const Foo::`vftable';", "const Foo::vftable;" },
+    { "x = `anonymous namespace'::g;", "x = anonymousnamespace::g;" },
+    { "p->`vbtable'[1] + `vftable'", "p->vbtable[1] + vftable" },
+    { "void __fastcall `dynamic initializer for 'g_x''()", "void __fastcall dynamicinitializerforg_x''()" },
+    // Every quoted name is simplified, not only the first one
+    { "a `b c' d `e f' g", "a bc d ef g" },
+    // A backtick at line start is left alone, but later names are simplified
+    { "`vector deleting destructor'(this)", "`vector deleting destructor'(this)" },
+    { "`anonymous namespace'::f(`string')", "`anonymous namespace'::f(string)" },
+    // Backticks without closing quote are left alone
+    { "a `b c", "a `b c" },
+    { "a `b' c `d e", "a b c `d e" },
+    // Quotes do not nest; backticks within a name are removed
+    { "a `b `c d' e'", "a bcd e'" },
+    { "a ``' b", "a  b" },
+    // Char literals
+    { "c = '`';", "c = ';" },
+    { "c = '`' + `x y';", "c = ' + xy;" },
+};
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief cleanupPseudocodeLine() as it was before the single pass.
+///     Simplifies only the first quoted name of a line.
+////////////////////////////////////////////////////////////////////////////////
+void oldCleanupPseudocodeLine(std::string &line)
+{
+    const size_t beginNote = line.find('`');
+    if ((beginNote == std::string::npos) || (beginNote == 0))
+        return;
+    const size_t endNote = line.find('\'', beginNote + 1);
+    if (endNote == std::string::npos)
+        return;
+
+    std::vector<size_t> spaces;
+    for (size_t i = beginNote + 1; i < line.size(); i++)
+    {
+        if ((line[i] == '\'') || (line[i] == '`') || (line[i] == '\0'))
+            break;
+        if (line[i] == ' ')
+            spaces.push_back(i);
+    }
+
+    line.erase(endNote, 1);
+    for (auto it = spaces.crbegin(); it != spaces.crend(); ++it)
+        line.erase(*it, 1);
+    line.erase(beginNote, 1);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Makes a random line with at most one backtick, which both
+///     algorithms should simplify the same way.
+////////////////////////////////////////////////////////////////////////////////
+std::string randomLine(unsigned long long &seed)
+{
+    static const char CHARS[] = "ab_:;() '  ";
+    seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+    const size_t length = (size_t)(seed >> 58);
+    std::string line;
+    for (size_t i = 0; i < length; i++)
+    {
+        seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+        line += CHARS[(seed >> 33) % (sizeof(CHARS) - 1)];
+    }
+    seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+    if ((seed >> 63) != 0)
+        line.insert((size_t)((seed >> 33) % (line.size() + 1)), 1, '`');
+    return line;
+}
+
+} // namespace
+
+int main()
+{
+    unsigned long failures = 0;
+    for (const GoldenCase &golden : GOLDEN_CASES)
+    {
+        std::string line = golden.line;
+        SourceGen::cleanupPseudocodeLine(line);
+        if (line != golden.expected)
+        {
+            printf("'%s': expected '%s', got '%s'\n", golden.line, golden.expected, line.c_str());
+            failures++;
+        }
+    }
+
+    // Long names must come out whole
+    std::string padded = "x `a" + std::string(2000, ' ') + "b'";
+    SourceGen::cleanupPseudocodeLine(padded);
+    if (padded != "x ab")
+    {
+        printf("Name padded with spaces: got '%s'\n", padded.c_str());
+        failures++;
+    }
+
+    unsigned long long seed = 1;
+    for (unsigned long i = 0; i < 500000; i++)
+    {
+        const std::string line = randomLine(seed);
+        std::string cleaned = line;
+        SourceGen::cleanupPseudocodeLine(cleaned);
+        std::string oldCleaned = line;
+        oldCleanupPseudocodeLine(oldCleaned);
+        if (cleaned != oldCleaned)
+        {
+            printf("'%s': expected '%s' as before, got '%s'\n", line.c_str(), oldCleaned.c_str(), cleaned.c_str());
+            failures++;
+        }
+    }
+
+    printf("%zu golden cases, %lu failures\n", sizeof(GOLDEN_CASES) / sizeof(GOLDEN_CASES[0]) + 1, failures);
+    return (failures == 0) ? 0 : 1;
+}
@@ -0,0 +1,309 @@
+////////////////////////////////////////////////////////////////////////////////
+/// @file SourcePipelineTest.cpp
+///     Tests of source generation without IDA.
+/// @par Purpose:
+///     Generates sources from a small MAP file and a pseudocode recording
+///     through SourceGen::ReplayBackend, and from many functions through
+///     SourceGen::StubBackend. Output must not depend on the amount of threads,
+///     and the replayed sources must equal the golden ones. Incremental runs
+///     must decompile again functions whose callees were renamed.
+/// @par  Copying and copyrights:
+///     This program is free software; you can redistribute it and/or modify
+///     it under the terms of the GNU General Public License as published by
+///     the Free Software Foundation; either version 2 of the License, or
+///     (at your option) any later version.
+////////////////////////////////////////////////////////////////////////////////
+
+#include  <algorithm>
+#include  <cstdio>
+#include  <filesystem>
+#include  <fstream>
+#include  <iterator>
+#include  <string>
+#include  <vector>
+
+#include  "../src/MAPReader.h"
+#include  "../src/SourceManifest.h"
+#include  "../src/SourcePipeline.h"
+
+void linearAddressToSymbolAddr(MapFile::MAPSymbol &sym, unsigned long linear_addr)
+{
+    sym.addr = linear_addr;
+}
+
+namespace {
+
+unsigned long failures = 0;
+
+void check(bool passed, const char * what)
+{
+    if (!passed)
+    {
+        printf("FAILED: %s\n", what);
+        failures++;
+    }
+}
+
+std::string readFile(const std::filesystem::path &fileName)
+{
+    std::ifstream file(fileName, std::ios::in | std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Checks that two folders hold the same files, byte by byte.
+////////////////////////////////////////////////////////////////////////////////
+void checkSameFiles(const std::filesystem::path &expected, const std::filesystem::path &folder, const char * what)
+{
+    std::vector<std::string> expectedNames;
+    std::vector<std::string> names;
+    for (const auto &entry : std::filesystem::directory_iterator(expected))
+        expectedNames.push_back(entry.path().filename().string());
+    for (const auto &entry : std::filesystem::directory_iterator(folder))
+        names.push_back(entry.path().filename().string());
+    std::sort(expectedNames.begin(), expectedNames.end());
+    std::sort(names.begin(), names.end());
+    if (names != expectedNames)
+    {
+        printf("FAILED: %s: %zu files in '%s', expected %zu\n", what, names.size(),
+            folder.string().c_str(), expectedNames.size());
+        failures++;
+        return;
+    }
+    for (const std::string &name : names)
+    {
+        if (readFile(folder / name) != readFile(expected / name))
+        {
+            printf("FAILED: %s: '%s' differs from '%s'\n", what, (folder / name).string().c_str(),
+                (expected / name).string().c_str());
+            failures++;
+        }
+    }
+}
+
+bool sameStats(const SourceGen::PipelineStats &a, const SourceGen::PipelineStats &b)
+{
+    return (a.generated == b.generated) && (a.failed == b.failed) && (a.unwritten == b.unwritten) &&
+        (a.files == b.files) && (a.reused == b.reused) && (a.keptFiles == b.keptFiles);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Makes the work list of the MAP file, like files_gen does.
+/// @return False if the MAP file could not be read
+////////////////////////////////////////////////////////////////////////////////
+bool makeWorkList(const std::string &mapFileName, SourceGen::DecompilerBackend &backend,
+    std::vector<std::string> &fileNames, std::vector<SourceGen::FunctionWork> &funcs, size_t &notFound)
+{
+    MapFile::MAPView map;
+    if (MapFile::openMAP(mapFileName.c_str(), map) != MapFile::OPEN_NO_ERROR)
+        return false;
+    MapFile::SymbolTable symbols;
+    MapFile::parseSymbols(map.addr, map.addr + map.size, MapFile::DEFAULT_MIN_LINE_LEN,
+        MapFile::DEFAULT_NUM_OF_SEGS, symbols);
+    std::vector<MapFile::MAPSection> sections;
+    MapFile::scanSections(map.addr, map.addr + map.size, MapFile::DEFAULT_MIN_LINE_LEN, sections);
+    MapFile::LineTable lineTable;
+    MapFile::parseLineNumbers(map.addr, map.addr + map.size, sections, lineTable);
+    MapFile::closeMAP(map);
+
+    notFound = SourceGen::buildWorkList(symbols, lineTable, backend, fileNames, funcs);
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Generates sources from the recording at 1 and 4 threads, and
+///     compares them with the golden ones.
+////////////////////////////////////////////////////////////////////////////////
+void testReplay(const std::filesystem::path &dataFolder, const std::filesystem::path &workFolder)
+{
+    SourceGen::ReplayBackend backend;
+    if (!backend.load((dataFolder / "pipeline.pseudocode").string().c_str()))
+    {
+        check(false, "load recording");
+        return;
+    }
+    std::vector<std::string> fileNames;
+    std::vector<SourceGen::FunctionWork> funcs;
+    size_t notFound = 0;
+    if (!makeWorkList((dataFolder / "pipeline.map").string(), backend, fileNames, funcs, notFound))
+    {
+        check(false, "read MAP");
+        return;
+    }
+    // _unknown is not in the recording; _memcpy is not from a source file
+    check((funcs.size() == 6) && (fileNames.size() == 3) && (notFound == 1), "work list of the MAP");
+
+    const std::filesystem::path oneThread = workFolder / "replay1";
+    const std::filesystem::path fourThreads = workFolder / "replay4";
+    std::filesystem::create_directories(oneThread);
+    std::filesystem::create_directories(fourThreads);
+    const SourceGen::PipelineStats stats = SourceGen::runPipeline(funcs, fileNames,
+        oneThread.string() + "/", backend, 1);
+    const SourceGen::PipelineStats stats4 = SourceGen::runPipeline(funcs, fileNames,
+        fourThreads.string() + "/", backend, 4);
+    // _blend is not decompiled in the recording
+    check((stats.generated == 5) && (stats.failed == 1) && (stats.unwritten == 0) && (stats.files == 3),
+        "totals of replay");
+    check(sameStats(stats, stats4), "totals of replay do not depend on threads");
+    checkSameFiles(oneThread, fourThreads, "replay at 4 threads");
+    checkSameFiles(dataFolder / "pipeline_golden", oneThread, "replay against golden files");
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Generates many stub functions, interleaved between files, with
+///     several thread counts; the files must be the same each time.
+////////////////////////////////////////////////////////////////////////////////
+void testStub(const std::filesystem::path &workFolder)
+{
+    const unsigned NUM_FILES = 7;
+    const unsigned NUM_FUNCS = 5000;
+    std::vector<std::string> fileNames;
+    for (unsigned i = 0; i < NUM_FILES; i++)
+        fileNames.push_back("stub" + std::to_string(i) + ".c");
+    std::vector<SourceGen::FunctionWork> funcs(NUM_FUNCS);
+    for (unsigned i = 0; i < NUM_FUNCS; i++)
+    {
+        funcs[i].ea = 0x401000 + 16ULL * i;
+        funcs[i].fileId = (i * 5 + i / 3) % NUM_FILES;
+        if ((i % 4) == 0)
+            funcs[i].marker = "// stub" + std::to_string(funcs[i].fileId) + ".c:" + std::to_string(i);
+    }
+
+    SourceGen::StubBackend backend;
+    const unsigned THREADS[] = { 1, 2, 4, 8 };
+    SourceGen::PipelineStats firstStats;
+    for (unsigned numThreads : THREADS)
+    {
+        for (int backgroundIO = 1; backgroundIO >= 0; backgroundIO--)
+        {
+            const std::filesystem::path folder = workFolder /
+                ("stub" + std::to_string(numThreads) + (backgroundIO ? "" : "fg"));
+            std::filesystem::create_directories(folder);
+            const SourceGen::PipelineStats stats = SourceGen::runPipeline(funcs, fileNames,
+                folder.string() + "/", backend, numThreads, (backgroundIO != 0));
+            if (numThreads == 1 && backgroundIO)
+            {
+                firstStats = stats;
+                check((stats.generated == NUM_FUNCS) && (stats.files == NUM_FILES), "totals of stub");
+                continue;
+            }
+            check(sameStats(firstStats, stats), "totals of stub do not depend on threads");
+            checkSameFiles(workFolder / "stub1", folder, "stub functions");
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Makes a copy of the recording in which a function is renamed.
+///     Only the names change; function bytes stay the same, like after
+///     renaming in the database.
+/// @return False if the recording could not be read or written
+////////////////////////////////////////////////////////////////////////////////
+bool writeRenamed(const std::filesystem::path &fileName, const std::filesystem::path &newFileName,
+    const std::string &name, const std::string &newName, const std::string &settings)
+{
+    static const char HEX_DIGITS[] = "0123456789ABCDEF";
+    std::string hexName, hexNewName;
+    for (size_t i = 0; i < name.size(); i++)
+    {
+        hexName += HEX_DIGITS[(unsigned char)name[i] >> 4];
+        hexName += HEX_DIGITS[name[i] & 0xF];
+        hexNewName += HEX_DIGITS[(unsigned char)newName[i] >> 4];
+        hexNewName += HEX_DIGITS[newName[i] & 0xF];
+    }
+    std::ifstream in(fileName, std::ios::in | std::ios::binary);
+    std::ofstream out(newFileName, std::ios::out | std::ios::binary);
+    if (!in || !out)
+        return false;
+    std::string line;
+    while (std::getline(in, line))
+    {
+        // Normalized code holds names of the function and its targets
+        const bool isCode = (line.compare(0, 2, "N ") == 0);
+        const std::string &from = isCode ? hexName : name;
+        const std::string &to = isCode ? hexNewName : newName;
+        if (line.compare(0, 2, "V ") == 0)
+            line = "V " + settings;
+        else if (isCode || (line.compare(0, 2, "L ") == 0))
+        {
+            for (size_t pos = line.find(from); pos != std::string::npos; pos = line.find(from, pos + to.size()))
+                line.replace(pos, from.size(), to);
+        }
+        out << line << '\n';
+    }
+    return (bool)out;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Renames a callee between two runs, and checks that an incremental
+///     run gives the same files as a full one. The caller must be decompiled
+///     again, though its bytes did not change; other files are kept.
+///     Another decompiler version must not reuse anything.
+////////////////////////////////////////////////////////////////////////////////
+void testRenamedCallee(const std::filesystem::path &dataFolder, const std::filesystem::path &workFolder)
+{
+    const std::filesystem::path renamedFile = workFolder / "renamed.pseudocode";
+    const std::filesystem::path upgradedFile = workFolder / "upgraded.pseudocode";
+    if (!writeRenamed(dataFolder / "pipeline.pseudocode", renamedFile, "helper", "assist", "hexrays 7.0.0.170914") ||
+        !writeRenamed(dataFolder / "pipeline.pseudocode", upgradedFile, "helper", "assist", "hexrays 7.5.0.201028"))
+    {
+        check(false, "write renamed recording");
+        return;
+    }
+    SourceGen::ReplayBackend backend, renamedBackend, upgradedBackend;
+    if (!backend.load((dataFolder / "pipeline.pseudocode").string().c_str()) ||
+        !renamedBackend.load(renamedFile.string().c_str()) || !upgradedBackend.load(upgradedFile.string().c_str()))
+    {
+        check(false, "load renamed recording");
+        return;
+    }
+    const std::string mapFileName = (dataFolder / "pipeline.map").string();
+    std::vector<std::string> fileNames, renamedFileNames;
+    std::vector<SourceGen::FunctionWork> funcs, renamedFuncs;
+    size_t notFound = 0;
+    if (!makeWorkList(mapFileName, backend, fileNames, funcs, notFound) ||
+        !makeWorkList(mapFileName, renamedBackend, renamedFileNames, renamedFuncs, notFound))
+    {
+        check(false, "read MAP");
+        return;
+    }
+
+    const std::string full = (workFolder / "renamed_full").string() + "/";
+    const std::string incremental = (workFolder / "renamed_incremental").string() + "/";
+    std::filesystem::create_directories(full);
+    std::filesystem::create_directories(incremental);
+    SourceGen::generateSources(renamedFuncs, renamedFileNames, full, renamedBackend, 1, false);
+    SourceGen::generateSources(funcs, fileNames, incremental, backend, 1, false);
+    const SourceGen::PipelineStats stats = SourceGen::generateSources(renamedFuncs, renamedFileNames,
+        incremental, renamedBackend, 4, true);
+    // main() and helper() are decompiled again; game.cpp and render.c are kept
+    check((stats.reused == 4) && (stats.keptFiles == 2), "incremental run after rename");
+    checkSameFiles(full, incremental, "incremental run after rename");
+
+    const SourceGen::PipelineStats upgradedStats = SourceGen::generateSources(renamedFuncs, renamedFileNames,
+        incremental, upgradedBackend, 4, true);
+    check((upgradedStats.reused == 0) && (upgradedStats.keptFiles == 0), "incremental run with other settings");
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    if (argc < 3)
+    {
+        printf("Usage: %s data_folder work_folder\n", argv[0]);
+        return 2;
+    }
+    const std::filesystem::path dataFolder(argv[1]);
+    const std::filesystem::path workFolder(argv[2]);
+    std::error_code err;
+    std::filesystem::remove_all(workFolder, err);
+    std::filesystem::create_directories(workFolder, err);
+
+    testReplay(dataFolder, workFolder);
+    testStub(workFolder);
+    testRenamedCallee(dataFolder, workFolder);
+
+    printf("%lu failures\n", failures);
+    return (failures == 0) ? 0 : 1;
+}
@@ -0,0 +1,323 @@
+////////////////////////////////////////////////////////////////////////////////
+/// @file SymbolCacheTest.cpp
+///     Tests of the binary symbol cache.
+/// @par Purpose:
+///     Checks that MapFile::loadSymbolCache() gives back the symbols stored by
+///     saveSymbolCache(), and that it rejects caches of changed MAP files,
+///     caches made with other parsing parameters, and damaged cache files.
+///     Symbols which depend on the host program must not be cached at all.
+/// @par  Copying and copyrights:
+///     This program is free software; you can redistribute it and/or modify
+///     it under the terms of the GNU General Public License as published by
+///     the Free Software Foundation; either version 2 of the License, or
+///     (at your option) any later version.
+////////////////////////////////////////////////////////////////////////////////
+
+#include  <chrono>
+#include  <cstdio>
+#include  <cstring>
+#include  <filesystem>
+#include  <fstream>
+#include  <iterator>
+#include  <string>
+
+#include  "../src/MAPReader.h"
+
+/// Puts all GCC symbols into the first segment
+void linearAddressToSymbolAddr(MapFile::MAPSymbol &sym, unsigned long linear_addr)
+{
+    sym.seg = 0;
+    sym.addr = linear_addr;
+}
+
+namespace {
+
+unsigned long failures = 0;
+
+void check(bool passed, const char * what)
+{
+    if (!passed)
+    {
+        printf("FAILED: %s\n", what);
+        failures++;
+    }
+}
+
+std::string readFile(const std::string &fileName)
+{
+    std::ifstream file(fileName, std::ios::in | std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+void writeFile(const std::string &fileName, const std::string &content)
+{
+    std::ofstream file(fileName, std::ios::out | std::ios::binary | std::ios::trunc);
+    file << content;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Compares two symbol tables and parsing totals.
+////////////////////////////////////////////////////////////////////////////////
+bool sameSymbols(const MapFile::SymbolTable &expected, const MapFile::ParseStats &expectedStats,
+    const MapFile::SymbolTable &symbols, const MapFile::ParseStats &stats)
+{
+    if ((expected.size() != symbols.size()) || (expected.getNumObjects() != symbols.getNumObjects()) ||
+        (expectedStats.sections != stats.sections) || (expectedStats.symbols != stats.symbols) ||
+        (expectedStats.invalidSyms != stats.invalidSyms))
+    {
+        return false;
+    }
+    for (size_t i = 0; i < expected.size(); i++)
+    {
+        if ((expected.getSeg(i) != symbols.getSeg(i)) || (expected.getAddr(i) != symbols.getAddr(i)) ||
+            (expected.getType(i) != symbols.getType(i)) ||
+            (expected.getObjectId(i) != symbols.getObjectId(i)) ||
+            (strcmp(expected.getName(i), symbols.getName(i)) != 0) ||
+            (strcmp(expected.getLibname(i), symbols.getLibname(i)) != 0))
+        {
+            return false;
+        }
+    }
+    for (unsigned id = 0; id < expected.getNumObjects(); id++)
+    {
+        if (strcmp(expected.getObjectName(id), symbols.getObjectName(id)) != 0)
+            return false;
+    }
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Maps a MAP file and parses it without the cache.
+/// @return False if the file could not be opened
+////////////////////////////////////////////////////////////////////////////////
+bool parseMap(const std::string &mapFileName, MapFile::MAPView &map, MapFile::SymbolTable &symbols,
+    MapFile::ParseStats &stats)
+{
+    if (MapFile::openView(mapFileName.c_str(), map) != MapFile::OPEN_NO_ERROR)
+        return false;
+    symbols.clear();
+    stats = MapFile::parseSymbols(map.addr, map.addr + map.size,
+        MapFile::DEFAULT_MIN_LINE_LEN, MapFile::DEFAULT_NUM_OF_SEGS, symbols);
+    return true;
+}
+
+bool loadCache(const std::string &cacheFileName, const std::string &mapFileName, const MapFile::MAPView &map,
+    size_t minLineLen = MapFile::DEFAULT_MIN_LINE_LEN, size_t numOfSegs = MapFile::DEFAULT_NUM_OF_SEGS)
+{
+    MapFile::SymbolTable symbols;
+    MapFile::ParseStats stats;
+    return MapFile::loadSymbolCache(cacheFileName.c_str(), mapFileName.c_str(), map,
+        minLineLen, numOfSegs, symbols, stats);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Checks that the cache is loaded back as it was saved.
+////////////////////////////////////////////////////////////////////////////////
+void testRoundTrip(const std::string &mapFileName, const std::string &cacheFileName)
+{
+    MapFile::MAPView map;
+    MapFile::SymbolTable parsed;
+    MapFile::ParseStats parsedStats;
+    if (!parseMap(mapFileName, map, parsed, parsedStats))
+    {
+        check(false, "open MSVC MAP");
+        return;
+    }
+    check(!parsed.empty() && (parsedStats.invalidSyms > 0) && (parsedStats.sections > 0),
+        "MSVC MAP has symbols and invalid lines");
+    check(!loadCache(cacheFileName, mapFileName, map), "no cache before saving");
+    check(MapFile::saveSymbolCache(cacheFileName.c_str(), mapFileName.c_str(), map,
+        MapFile::DEFAULT_MIN_LINE_LEN, MapFile::DEFAULT_NUM_OF_SEGS, parsed, parsedStats), "save cache");
+
+    MapFile::SymbolTable loaded;
+    MapFile::ParseStats loadedStats;
+    check(MapFile::loadSymbolCache(cacheFileName.c_str(), mapFileName.c_str(), map,
+        MapFile::DEFAULT_MIN_LINE_LEN, MapFile::DEFAULT_NUM_OF_SEGS, loaded, loadedStats), "load cache");
+    check(sameSymbols(parsed, parsedStats, loaded, loadedStats), "loaded symbols equal parsed ones");
+
+    // Loading replaces symbols which were in the table
+    loaded.append(1, 2, 'f', "_extra", 6, "extra.obj", 9);
+    check(MapFile::loadSymbolCache(cacheFileName.c_str(), mapFileName.c_str(), map,
+        MapFile::DEFAULT_MIN_LINE_LEN, MapFile::DEFAULT_NUM_OF_SEGS, loaded, loadedStats) &&
+        sameSymbols(parsed, parsedStats, loaded, loadedStats), "load cache into used table");
+
+    check(!loadCache(cacheFileName, mapFileName, map, MapFile::DEFAULT_MIN_LINE_LEN + 1),
+        "reject other minLineLen");
+    check(!loadCache(cacheFileName, mapFileName, map, MapFile::DEFAULT_MIN_LINE_LEN,
+        MapFile::DEFAULT_NUM_OF_SEGS + 1), "reject other numOfSegs");
+    MapFile::closeMAP(map);
+
+    // parseSymbolsCached() writes the cache next to the MAP, then uses it
+    const std::string autoCacheName = mapFileName + SYMBOL_CACHE_SUFFIX;
+    if (MapFile::openView(mapFileName.c_str(), map) == MapFile::OPEN_NO_ERROR)
+    {
+        for (int pass = 0; pass < 2; pass++)
+        {
+            MapFile::SymbolTable symbols;
+            const MapFile::ParseStats stats = MapFile::parseSymbolsCached(mapFileName.c_str(), map,
+                MapFile::DEFAULT_MIN_LINE_LEN, MapFile::DEFAULT_NUM_OF_SEGS, symbols);
+            check(std::filesystem::exists(autoCacheName), "parseSymbolsCached() writes cache");
+            check(sameSymbols(parsed, parsedStats, symbols, stats), "parseSymbolsCached() gives parsed symbols");
+        }
+        MapFile::closeMAP(map);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Checks that the cache is not used after the MAP file changed.
+///     One change keeps size and modification time of the MAP, so that only
+///     the content hash can tell.
+////////////////////////////////////////////////////////////////////////////////
+void testChangedMap(const std::string &mapFileName, const std::string &cacheFileName)
+{
+    const std::string original = readFile(mapFileName);
+    const auto mtime = std::filesystem::last_write_time(mapFileName);
+
+    std::string sameSize = original;
+    const size_t pos = sameSize.find("_g_state");
+    check(pos != std::string::npos, "MSVC MAP has _g_state");
+    if (pos != std::string::npos)
+        sameSize[pos + 3] = 'S';
+    writeFile(mapFileName, sameSize);
+    std::filesystem::last_write_time(mapFileName, mtime);
+    MapFile::MAPView map;
+    if (MapFile::openView(mapFileName.c_str(), map) == MapFile::OPEN_NO_ERROR)
+    {
+        check(!loadCache(cacheFileName, mapFileName, map), "reject MAP changed in place");
+        MapFile::closeMAP(map);
+    }
+
+    writeFile(mapFileName, original + " 0003:00000020       _g_added                   00013020     main.obj\r\n");
+    if (MapFile::openView(mapFileName.c_str(), map) == MapFile::OPEN_NO_ERROR)
+    {
+        check(!loadCache(cacheFileName, mapFileName, map), "reject MAP with added line");
+        MapFile::closeMAP(map);
+    }
+
+    // Same content, but written again
+    writeFile(mapFileName, original);
+    std::filesystem::last_write_time(mapFileName, mtime + std::chrono::seconds(10));
+    if (MapFile::openView(mapFileName.c_str(), map) == MapFile::OPEN_NO_ERROR)
+    {
+        check(!loadCache(cacheFileName, mapFileName, map), "reject MAP with other modification time");
+        MapFile::closeMAP(map);
+    }
+
+    std::filesystem::last_write_time(mapFileName, mtime);
+    if (MapFile::openView(mapFileName.c_str(), map) == MapFile::OPEN_NO_ERROR)
+    {
+        check(loadCache(cacheFileName, mapFileName, map), "accept restored MAP");
+        MapFile::closeMAP(map);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Checks that truncated or corrupted cache files are rejected.
+////////////////////////////////////////////////////////////////////////////////
+void testDamagedCache(const std::string &mapFileName, const std::string &cacheFileName)
+{
+    MapFile::MAPView map;
+    if (MapFile::openView(mapFileName.c_str(), map) != MapFile::OPEN_NO_ERROR)
+    {
+        check(false, "open MSVC MAP");
+        return;
+    }
+    const std::string cache = readFile(cacheFileName);
+    check(cache.size() > 64, "cache file was written");
+
+    const size_t cuts[] = { cache.size() - 1, cache.size() / 2, 16, 0 };
+    for (size_t cut : cuts)
+    {
+        writeFile(cacheFileName, cache.substr(0, cut));
+        check(!loadCache(cacheFileName, mapFileName, map), "reject truncated cache");
+    }
+
+    writeFile(cacheFileName, cache + std::string(8, '\0'));
+    check(!loadCache(cacheFileName, mapFileName, map), "reject cache with extra bytes");
+
+    std::string damaged = cache;
+    damaged[0] ^= 0x20;
+    writeFile(cacheFileName, damaged);
+    check(!loadCache(cacheFileName, mapFileName, map), "reject cache with bad magic");
+
+    // Version follows the magic
+    damaged = cache;
+    damaged[8] ^= 0x01;
+    writeFile(cacheFileName, damaged);
+    check(!loadCache(cacheFileName, mapFileName, map), "reject cache of other version");
+
+    // Offsets and object IDs out of range, names not terminated
+    damaged = cache;
+    for (size_t i = 128; i < damaged.size(); i++)
+        damaged[i] = (char)0xFF;
+    writeFile(cacheFileName, damaged);
+    check(!loadCache(cacheFileName, mapFileName, map), "reject cache with corrupted blocks");
+
+    writeFile(cacheFileName, cache);
+    check(loadCache(cacheFileName, mapFileName, map), "accept restored cache");
+    MapFile::closeMAP(map);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Checks that symbols which went through linearAddressToSymbolAddr()
+///     are never cached.
+////////////////////////////////////////////////////////////////////////////////
+void testHostSegments(const std::string &mapFileName)
+{
+    MapFile::MAPView map;
+    MapFile::SymbolTable parsed;
+    MapFile::ParseStats parsedStats;
+    if (!parseMap(mapFileName, map, parsed, parsedStats))
+    {
+        check(false, "open GCC MAP");
+        return;
+    }
+    check(parsedStats.usesHostSegments && !parsed.empty(), "GCC MAP uses host segments");
+
+    const std::string cacheFileName = mapFileName + SYMBOL_CACHE_SUFFIX;
+    check(!MapFile::saveSymbolCache(cacheFileName.c_str(), mapFileName.c_str(), map,
+        MapFile::DEFAULT_MIN_LINE_LEN, MapFile::DEFAULT_NUM_OF_SEGS, parsed, parsedStats),
+        "saving host segment symbols fails");
+    check(!std::filesystem::exists(cacheFileName), "no cache of host segment symbols");
+
+    MapFile::SymbolTable symbols;
+    const MapFile::ParseStats stats = MapFile::parseSymbolsCached(mapFileName.c_str(), map,
+        MapFile::DEFAULT_MIN_LINE_LEN, MapFile::DEFAULT_NUM_OF_SEGS, symbols);
+    check(sameSymbols(parsed, parsedStats, symbols, stats), "parseSymbolsCached() parses GCC MAP");
+    check(!std::filesystem::exists(cacheFileName), "parseSymbolsCached() writes no cache of host segment symbols");
+    check(!std::filesystem::exists(cacheFileName + ".tmp"), "no temporary cache left");
+    MapFile::closeMAP(map);
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    if (argc < 3)
+    {
+        printf("Usage: %s data_folder work_folder\n", argv[0]);
+        return 2;
+    }
+    const std::filesystem::path dataFolder(argv[1]);
+    const std::filesystem::path workFolder(argv[2]);
+    std::error_code err;
+    std::filesystem::remove_all(workFolder, err);
+    std::filesystem::create_directories(workFolder, err);
+    const std::string msvcMap = (workFolder / "msvc.map").string();
+    const std::string gccMap = (workFolder / "gcc.map").string();
+    const std::string cacheFileName = (workFolder / "msvc.cache").string();
+    if (!std::filesystem::copy_file(dataFolder / "cache_msvc.map", msvcMap, err) ||
+        !std::filesystem::copy_file(dataFolder / "cache_gcc.map", gccMap, err))
+    {
+        printf("Could not copy MAP files from '%s' to '%s'\n", argv[1], argv[2]);
+        return 2;
+    }
+
+    testRoundTrip(msvcMap, cacheFileName);
+    testChangedMap(msvcMap, cacheFileName);
+    testDamagedCache(msvcMap, cacheFileName);
+    testHostSegments(gccMap);
+
+    printf("%lu failures\n", failures);
+    return (failures == 0) ? 0 : 1;
+}
@@ -0,0 +1,308 @@
+////////////////////////////////////////////////////////////////////////////////
+/// @file WatcomGccSymbolLineTest.cpp
+///     Differential test of Watcom and GCC symbol line parsers.
+/// @par Purpose:
+///     Compares MapFile::parseWatcomSymbolLine() and parseGccSymbolLine()
+///     with the sscanf based parsers they replaced, on corpora of MAP lines
+///     and on random lines and mutated corpus lines.
+/// @par  Copying and copyrights:
+///     This program is free software; you can redistribute it and/or modify
+///     it under the terms of the GNU General Public License as published by
+///     the Free Software Foundation; either version 2 of the License, or
+///     (at your option) any later version.
+////////////////////////////////////////////////////////////////////////////////
+
+#include  <cstdio>
+#include  <cstdlib>
+#include  <cstring>
+#include  <fstream>
+#include  <string>
+#include  <vector>
+
+#include  "../src/MAPReader.h"
+#include  "../src/stdafx.h"
+
+void linearAddressToSymbolAddr(MapFile::MAPSymbol &sym, unsigned long linear_addr)
+{
+    sym.addr = linear_addr;
+}
+
+namespace {
+
+const char WATCOM_MEMMAP_SKIP[]    = "=======        ======";
+const char WATCOM_MEMMAP_COMMENT[] = "Module: ";
+const char GCC_MEMMAP_SKIP1[]      = ".";
+const char GCC_MEMMAP_SKIP2[]      = " .";
+const char GCC_MEMMAP_SKIP3[]      = "*";
+const char GCC_MEMMAP_SKIP4[]      = " *";
+const char GCC_MEMMAP_LOAD[]       = "LOAD ";
+
+/// Symbol read by the old parsers; the name buffer is large enough for
+/// any cut line, as the old parsers could overflow MAPSymbol::name
+typedef struct {
+    unsigned long seg = 0;
+    unsigned long addr = 0;
+    char name[MAXNAMELEN + MapFile::DEFAULT_MIN_LINE_LEN + 1] = {};
+} OldSymbol;
+
+typedef MapFile::ParseResult (*NewParser)(MapFile::MAPSymbol &sym, const char *pLine, size_t lineLen, size_t minLineLen, size_t numOfSegs);
+typedef MapFile::ParseResult (*OldParser)(OldSymbol &sym, const char *pLine, size_t lineLen, size_t minLineLen, size_t numOfSegs);
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief parseWatcomSymbolLine() as it was before the scanners.
+///     Numbers are scanned into 32-bit variables, which %X requires; the
+///     old code gave it unsigned long, which only worked on Windows.
+////////////////////////////////////////////////////////////////////////////////
+MapFile::ParseResult oldParseWatcomSymbolLine(OldSymbol &sym, const char *pLine, size_t lineLen, size_t minLineLen, size_t numOfSegs)
+{
+    size_t lineCut = lineLen;
+    if (lineCut > MAXNAMELEN + minLineLen)
+        lineCut = MAXNAMELEN + minLineLen;
+    char * dupLine = (char *)std::malloc(lineCut+1);
+    strncpy(dupLine,pLine,lineCut);
+    dupLine[lineCut] = '\0';
+    if (strncasecmp(dupLine, ";", 1) == 0)
+    {
+        strncpy(sym.name,dupLine+1,MAXNAMELEN-1);
+        sym.name[MAXNAMELEN] = '\0';
+        std::free(dupLine);
+        return MapFile::COMMENT_LINE;
+    }
+    if (strncasecmp(dupLine, WATCOM_MEMMAP_SKIP, std::strlen(WATCOM_MEMMAP_SKIP)) == 0)
+    {
+        std::free(dupLine);
+        return MapFile::SKIP_LINE;
+    }
+    if (strncasecmp(dupLine, WATCOM_MEMMAP_COMMENT, std::strlen(WATCOM_MEMMAP_COMMENT)) == 0)
+    {
+        strncpy(sym.name,dupLine+std::strlen(WATCOM_MEMMAP_COMMENT),MAXNAMELEN-1);
+        sym.name[MAXNAMELEN] = '\0';
+        std::free(dupLine);
+        return MapFile::COMMENT_LINE;
+    }
+    unsigned int seg;
+    unsigned int addr;
+    int ret = sscanf(dupLine, " %04X : %08X%*c %[^\t\n;]", &seg, &addr, sym.name);
+    std::free(dupLine);
+    if (3 != ret)
+    {
+        // we have parsed to end of value/name symbols table or reached EOF
+        return MapFile::FINISHING_LINE;
+    }
+    sym.seg = seg;
+    sym.addr = addr;
+    if ((0 == sym.seg) || (--sym.seg >= numOfSegs) ||
+            ((unsigned int)-1 == addr) || (std::strlen(sym.name) == 0) )
+    {
+        return MapFile::INVALID_LINE;
+    }
+    // Ensure name is NULL terminated
+    sym.name[MAXNAMELEN] = '\0';
+    return MapFile::SYMBOL_LINE;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief parseGccSymbolLine() as it was before the scanners.
+///     The address is scanned into a 32-bit variable, as for Watcom; it is
+///     converted like linearAddressToSymbolAddr() of this test does.
+////////////////////////////////////////////////////////////////////////////////
+MapFile::ParseResult oldParseGccSymbolLine(OldSymbol &sym, const char *pLine, size_t lineLen, size_t minLineLen, size_t numOfSegs)
+{
+    size_t lineCut = lineLen;
+    if (lineCut > MAXNAMELEN + minLineLen)
+        lineCut = MAXNAMELEN + minLineLen;
+    char * dupLine = (char *)std::malloc(lineCut+1);
+    strncpy(dupLine,pLine,lineCut);
+    dupLine[lineCut] = '\0';
+    if (strncasecmp(dupLine, ";", 1) == 0)
+    {
+        strncpy(sym.name,dupLine+1,MAXNAMELEN-1);
+        sym.name[MAXNAMELEN] = '\0';
+        std::free(dupLine);
+        return MapFile::COMMENT_LINE;
+    }
+    if ( (strncasecmp(dupLine, GCC_MEMMAP_SKIP1, std::strlen(GCC_MEMMAP_SKIP1)) == 0) ||
+         (strncasecmp(dupLine, GCC_MEMMAP_SKIP2, std::strlen(GCC_MEMMAP_SKIP2)) == 0) )
+    {
+        std::free(dupLine);
+        return MapFile::SKIP_LINE;
+    }
+    if ( (strncasecmp(dupLine, GCC_MEMMAP_SKIP3, std::strlen(GCC_MEMMAP_SKIP3)) == 0) ||
+         (strncasecmp(dupLine, GCC_MEMMAP_SKIP4, std::strlen(GCC_MEMMAP_SKIP4)) == 0) )
+    {
+        std::free(dupLine);
+        return MapFile::SKIP_LINE;
+    }
+    if (strncasecmp(dupLine, GCC_MEMMAP_LOAD, std::strlen(GCC_MEMMAP_LOAD)) == 0)
+    {
+        strncpy(sym.name,dupLine,MAXNAMELEN-1);
+        sym.name[MAXNAMELEN] = '\0';
+        std::free(dupLine);
+        return MapFile::COMMENT_LINE;
+    }
+    unsigned int linear_addr;
+    int ret = sscanf(dupLine, " 0x%08X%*c %[^\t\n;]", &linear_addr, sym.name);
+    std::free(dupLine);
+    if (2 != ret)
+    {
+        // we have parsed to end of value/name symbols table or reached EOF
+        return MapFile::FINISHING_LINE;
+    }
+    sym.addr = linear_addr;
+    if ((sym.seg >= numOfSegs) || ((unsigned long)-1 == sym.addr) || (std::strlen(sym.name) == 0) )
+    {
+        return MapFile::INVALID_LINE;
+    }
+    // Ensure name is NULL terminated
+    sym.name[MAXNAMELEN] = '\0';
+    return MapFile::SYMBOL_LINE;
+}
+
+/// Totals of the comparison
+typedef struct {
+    unsigned long lines = 0;
+    unsigned long symbols = 0;
+    unsigned long comments = 0;
+    unsigned long failures = 0;
+} TestStats;
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Runs both parsers on a line and compares their results.
+/// @param what Where the line comes from, for messages
+////////////////////////////////////////////////////////////////////////////////
+void checkLine(NewParser parser, OldParser oldParser, const std::string &line, const char * what, TestStats &stats)
+{
+    stats.lines++;
+    MapFile::MAPSymbol sym;
+    const MapFile::ParseResult result = parser(sym, line.c_str(), line.size(),
+        MapFile::DEFAULT_MIN_LINE_LEN, MapFile::DEFAULT_NUM_OF_SEGS);
+    OldSymbol oldSym;
+    const MapFile::ParseResult oldResult = oldParser(oldSym, line.c_str(), line.size(),
+        MapFile::DEFAULT_MIN_LINE_LEN, MapFile::DEFAULT_NUM_OF_SEGS);
+
+    bool same = (result == oldResult);
+    if (same && ((result == MapFile::SYMBOL_LINE) || (result == MapFile::INVALID_LINE)))
+    {
+        if (result == MapFile::SYMBOL_LINE)
+            stats.symbols++;
+        same = (sym.seg == oldSym.seg) && (sym.addr == oldSym.addr);
+    }
+    if (same && ((result == MapFile::SYMBOL_LINE) || (result == MapFile::COMMENT_LINE)))
+    {
+        if (result == MapFile::COMMENT_LINE)
+            stats.comments++;
+        // Names are cut to the buffer of MAPSymbol
+        same = (strncmp(sym.name, oldSym.name, MAXNAMELEN) == 0);
+    }
+    if (!same)
+    {
+        printf("%s: results differ (%d vs old %d): '%s'\n", what, (int)result, (int)oldResult, line.c_str());
+        stats.failures++;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Makes a random line of given characters.
+////////////////////////////////////////////////////////////////////////////////
+std::string randomLine(unsigned long long &seed, const char * chars)
+{
+    const size_t numChars = std::strlen(chars);
+    seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+    const size_t length = (size_t)(seed >> 58);
+    std::string line;
+    for (size_t i = 0; i < length; i++)
+    {
+        seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+        line += chars[(seed >> 33) % numChars];
+    }
+    return line;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Changes, inserts or removes a few characters of a line.
+////////////////////////////////////////////////////////////////////////////////
+std::string mutateLine(unsigned long long &seed, std::string line, const char * chars)
+{
+    const size_t numChars = std::strlen(chars);
+    seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+    const unsigned numEdits = 1 + (unsigned)((seed >> 60) & 3);
+    for (unsigned i = 0; i < numEdits; i++)
+    {
+        seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+        const size_t pos = (size_t)((seed >> 33) % (line.size() + 1));
+        const char c = chars[(seed >> 20) % numChars];
+        switch ((seed >> 61) % 3)
+        {
+        case 0:
+            if (pos < line.size())
+                line[pos] = c;
+            break;
+        case 1:
+            line.insert(pos, 1, c);
+            break;
+        default:
+            if (pos < line.size())
+                line.erase(pos, 1);
+            break;
+        }
+    }
+    return line;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Compares parsers of one dialect on a corpus and on random lines.
+/// @return False if the corpus could not be read
+////////////////////////////////////////////////////////////////////////////////
+bool checkDialect(const char * corpusName, NewParser parser, OldParser oldParser,
+    const char * randomChars, TestStats &stats)
+{
+    std::ifstream corpus(corpusName, std::ios::in | std::ios::binary);
+    if (!corpus.is_open())
+    {
+        printf("Could not open corpus '%s'\n", corpusName);
+        return false;
+    }
+    std::vector<std::string> lines;
+    std::string line;
+    while (std::getline(corpus, line))
+    {
+        if (!line.empty() && (line.back() == '\r'))
+            line.pop_back();
+        checkLine(parser, oldParser, line, corpusName, stats);
+        lines.push_back(line);
+    }
+
+    unsigned long long seed = 1;
+    for (unsigned long i = 0; i < 200000; i++)
+        checkLine(parser, oldParser, randomLine(seed, randomChars), "random", stats);
+    for (unsigned long i = 0; (i < 200000) && !lines.empty(); i++)
+    {
+        const std::string &sample = lines[(size_t)(seed >> 33) % lines.size()];
+        checkLine(parser, oldParser, mutateLine(seed, sample, randomChars), "mutated", stats);
+    }
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    if (argc < 3)
+    {
+        printf("Usage: %s watcom_corpus gcc_corpus\n", argv[0]);
+        return 2;
+    }
+
+    TestStats stats;
+    if (!checkDialect(argv[1], MapFile::parseWatcomSymbolLine, oldParseWatcomSymbolLine,
+            "0123456789ABCDEFabcdefxX:+-  \t;_$@?*.M", stats) ||
+        !checkDialect(argv[2], MapFile::parseGccSymbolLine, oldParseGccSymbolLine,
+            "0123456789ABCDEFabcdefx00xx+-  \t;_$@?*.L", stats))
+    {
+        return 2;
+    }
+
+    printf("%lu lines, %lu symbols, %lu comments, %lu failures\n",
+        stats.lines, stats.symbols, stats.comments, stats.failures);
+    return (stats.failures == 0) ? 0 : 1;
+}
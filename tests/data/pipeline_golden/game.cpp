@@ -0,0 +1,13 @@
+void __thiscall CGame::Update(CGame *this, float a2)
+{
+  if ( a2 > 0.0 )
+    Render();
+}
+
+CGame *__thiscall CGame::CGame(CGame *this)
+{
+  *(_DWORD *)this = &CGame::vftable;
+  *((_DWORD *)this + 1) = 0;
+  return this;
+}
+
@@ -0,0 +1,13 @@
+// c:\src\main.cpp:10
+int __cdecl main(int argc, const char **argv, const char **envp)
+{
+  g_state = helper();
+  return 0;
+}
+
+// c:\src\main.cpp:30
+int __cdecl helper()
+{
+  return 1;
+}
+
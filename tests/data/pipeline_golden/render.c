@@ -0,0 +1,6 @@
+// c:\src\render.c:5
+void __cdecl Render()
+{
+  ++g_state;
+}
+